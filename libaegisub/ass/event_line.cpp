@@ -0,0 +1,152 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/ass/event_line.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace {
+using iterator = std::string::const_iterator;
+
+bool is_space(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+bool starts_with(iterator begin, iterator end, const char *prefix) {
+	for (; *prefix; ++prefix, ++begin) {
+		if (begin == end || *begin != *prefix)
+			return false;
+	}
+	return true;
+}
+
+bool starts_with_nocase(iterator begin, iterator end, const char *prefix) {
+	for (; *prefix; ++prefix, ++begin) {
+		if (begin == end || (*begin | 0x20) != *prefix)
+			return false;
+	}
+	return true;
+}
+
+agi::StringRange trim(agi::StringRange str) {
+	auto begin = str.begin(), end = str.end();
+	while (begin != end && is_space(*begin)) ++begin;
+	while (begin != end && is_space(*(end - 1))) --end;
+	return {begin, end};
+}
+
+agi::Time parse_time(std::string const& line, agi::StringRange field) {
+	const char *begin = line.data() + (field.begin() - line.begin());
+	return agi::Time(begin, begin + field.size());
+}
+
+/// Parse a field containing only an integer and optional surrounding
+/// whitespace. Out of range values are clamped rather than rejected.
+bool parse_int(agi::StringRange field, int &out) {
+	auto str = trim(field);
+	auto it = str.begin(), end = str.end();
+	bool negative = false;
+	if (it != end && (*it == '-' || *it == '+'))
+		negative = *it++ == '-';
+	if (it == end) return false;
+
+	long long value = 0;
+	for (; it != end; ++it) {
+		if (!is_digit(*it)) return false;
+		if (value <= INT_MAX)
+			value = value * 10 + (*it - '0');
+	}
+	if (negative) value = -value;
+	out = value < INT_MIN ? INT_MIN : value > INT_MAX ? INT_MAX : (int)value;
+	return true;
+}
+
+/// Parse a {=1=2...} block at the start of text into ids
+/// @return Start of the text after the block, or begin if there isn't one
+iterator parse_extradata(iterator begin, iterator end, std::vector<uint32_t> &ids) {
+	ids.clear();
+	if (end - begin < 2 || begin[0] != '{' || begin[1] != '=')
+		return begin;
+
+	for (auto it = begin + 1; it != end; ) {
+		if (*it == '}' && !ids.empty())
+			return it + 1;
+		if (*it != '=') break;
+		++it;
+
+		if (it == end || !is_digit(*it)) break;
+		uint64_t id = 0;
+		for (; it != end && is_digit(*it); ++it) {
+			id = id * 10 + (*it - '0');
+			if (id > UINT32_MAX) break;
+		}
+		if (id > UINT32_MAX) break;
+		ids.push_back((uint32_t)id);
+	}
+
+	ids.clear();
+	return begin;
+}
+}
+
+namespace agi { namespace ass {
+bool ParseEventLine(std::string const& line, EventLine &out) {
+	auto it = line.begin(), end = line.end();
+	if (starts_with(it, end, "Dialogue:")) {
+		out.comment = false;
+		it += 9;
+	}
+	else if (starts_with(it, end, "Comment:")) {
+		out.comment = true;
+		it += 8;
+	}
+	else
+		return false;
+
+	// Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect and
+	// then the text, which is everything after the ninth comma
+	StringRange fields[9];
+	for (auto& field : fields) {
+		auto field_end = std::find(it, end, ',');
+		if (field_end == end) return false;
+		field = {it, field_end};
+		it = field_end + 1;
+	}
+
+	auto layer = trim(fields[0]);
+	if (starts_with_nocase(layer.begin(), layer.end(), "marked="))
+		out.layer = 0;
+	else if (!parse_int(layer, out.layer))
+		return false;
+
+	out.start = parse_time(line, fields[1]);
+	out.end = parse_time(line, fields[2]);
+	out.style = trim(fields[3]);
+	out.actor = trim(fields[4]);
+	for (size_t i = 0; i < 3; ++i) {
+		if (!parse_int(fields[5 + i], out.margin[i]))
+			return false;
+	}
+	out.effect = trim(fields[8]);
+	out.text = {parse_extradata(it, end, out.extradata_ids), end};
+	return true;
+}
+} }
@@ -26,10 +26,13 @@
 namespace agi {
 Time::Time(int time) : time(util::mid(0, time, 10 * 60 * 60 * 1000 - 6)) { }
 
-Time::Time(std::string const& text) {
+Time::Time(std::string const& text) : Time(text.data(), text.data() + text.size()) { }
+
+Time::Time(const char *begin, const char *end) {
 	int after_decimal = -1;
 	int current = 0;
-	for (char c : text) {
+	for (; begin != end; ++begin) {
+		char c = *begin;
 		if (c == ':') {
 			time = time * 60 + current;
 			current = 0;
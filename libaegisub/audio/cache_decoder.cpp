@@ -0,0 +1,201 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "cache_decoder.h"
+
+#include "libaegisub/audio/provider.h"
+#include "libaegisub/log.h"
+
+#include <algorithm>
+
+namespace {
+const size_t npos = static_cast<size_t>(-1);
+
+/// Upper limit on decoder threads, as each one needs its own source and
+/// beyond this the decoders mostly just compete for disk bandwidth
+const unsigned max_threads = 8;
+}
+
+namespace agi {
+static_assert(static_cast<size_t>(AudioProvider::DecodeHint::Count) <= AudioCacheDecoder::priority_slots,
+	"Not enough priority slots for the provider's decode hints");
+
+AudioCacheDecoder::AudioCacheDecoder(AudioProvider const& source, int64_t block_size, std::atomic<int64_t>& decoded_samples, DecodeFunc decode, DoneFunc done)
+: source(source)
+, block_size(block_size)
+, block_count(static_cast<size_t>((source.GetNumSamples() + block_size - 1) / block_size))
+, decoded_samples(decoded_samples)
+, decode(std::move(decode))
+, done(std::move(done))
+, state(new std::atomic<uint8_t>[block_count]())
+{
+}
+
+AudioCacheDecoder::~AudioCacheDecoder() {
+	Stop();
+}
+
+void AudioCacheDecoder::MarkDecoded(size_t block) {
+	state[block] = Decoded;
+}
+
+void AudioCacheDecoder::Start() {
+	size_t pending = 0;
+	std::vector<size_t> restored;
+	for (size_t i = 0; i < block_count; ++i) {
+		if (state[i] == Pending)
+			++pending;
+		else if (done)
+			restored.push_back(i);
+	}
+
+	if (!restored.empty()) {
+		workers.emplace_back([this, restored] {
+			const int64_t num_samples = source.GetNumSamples();
+			for (size_t i = 0; i < restored.size() && !cancelled; ++i) {
+				const int64_t start = restored[i] * block_size;
+				done(start, std::min(block_size, num_samples - start));
+			}
+		});
+	}
+
+	if (!pending) return;
+
+	size_t thread_count = std::min<size_t>({std::max(1u, std::thread::hardware_concurrency()), max_threads, pending});
+
+	workers.emplace_back([this] { Work(source); });
+	for (size_t i = 1; i < thread_count; ++i) {
+		workers.emplace_back([this] {
+			std::unique_ptr<AudioProvider> decoder;
+			try {
+				decoder = source.Clone();
+			}
+			catch (agi::Exception const& e) {
+				LOG_E("audio_provider/cache") << "Failed to open additional decoder: " << e.GetMessage();
+			}
+			// The remaining threads will pick up the slack
+			if (decoder)
+				Work(*decoder);
+		});
+	}
+}
+
+void AudioCacheDecoder::Stop() {
+	cancelled = true;
+	for (auto& worker : workers) {
+		if (worker.joinable())
+			worker.join();
+	}
+	workers.clear();
+}
+
+bool AudioCacheDecoder::IsDecoded(int64_t start, int64_t count) const {
+	start = std::max<int64_t>(start, 0);
+	int64_t end = std::min(start + count, source.GetNumSamples());
+	if (end <= start) return true;
+	for (size_t i = start / block_size, last = (end - 1) / block_size; i <= last; ++i) {
+		if (state[i] != Decoded)
+			return false;
+	}
+	return true;
+}
+
+size_t AudioCacheDecoder::SplitLargestGap(size_t begin, size_t end) const {
+	size_t best_start = npos, best_length = 0;
+	for (size_t i = begin; i < end; ) {
+		if (state[i] != Pending) {
+			++i;
+			continue;
+		}
+		size_t j = i;
+		while (j < end && state[j] == Pending) ++j;
+		if (j - i > best_length) {
+			best_start = i;
+			best_length = j - i;
+		}
+		i = j;
+	}
+
+	if (best_start == npos) return npos;
+	// If some other thread is currently decoding the block before the gap
+	// it'll get to the start of it without seeking, so begin in the middle
+	if (best_start > 0 && state[best_start - 1] == Claimed)
+		return best_start + best_length / 2;
+	return best_start;
+}
+
+size_t AudioCacheDecoder::FirstPending(size_t begin, size_t end) const {
+	size_t first = npos;
+	for (size_t i = begin; i < end; ++i) {
+		if (state[i] != Pending) continue;
+		// A block right after one being decoded will be reached without a
+		// seek by that thread, so prefer the next one which won't be
+		if (i == 0 || state[i - 1] != Claimed)
+			return i;
+		if (first == npos)
+			first = i;
+	}
+	return first;
+}
+
+void AudioCacheDecoder::Prioritize(size_t slot, int64_t start, int64_t count) {
+	start = std::max<int64_t>(start, 0);
+	int64_t end = std::min(start + count, source.GetNumSamples());
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (end <= start)
+		priority[slot] = {0, 0};
+	else
+		priority[slot] = {static_cast<size_t>(start / block_size), static_cast<size_t>((end - 1) / block_size + 1)};
+}
+
+size_t AudioCacheDecoder::NextBlock(size_t last) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t next = npos;
+	for (auto const& range : priority) {
+		if (last != npos && last + 1 >= range.first && last + 1 < range.second && state[last + 1] == Pending)
+			next = last + 1;
+		else
+			next = FirstPending(range.first, range.second);
+		if (next != npos) break;
+	}
+
+	if (next == npos) {
+		if (last != npos && last + 1 < block_count && state[last + 1] == Pending)
+			next = last + 1;
+		else
+			next = SplitLargestGap(0, block_count);
+	}
+
+	if (next != npos)
+		state[next] = Claimed;
+	return next;
+}
+
+void AudioCacheDecoder::Work(AudioProvider const& decoder) {
+	const int64_t num_samples = source.GetNumSamples();
+	for (size_t block = NextBlock(npos); block != npos && !cancelled; block = NextBlock(block)) {
+		const int64_t start = block * block_size;
+		const int64_t count = std::min(block_size, num_samples - start);
+		decode(decoder, block, start, count);
+		state[block] = Decoded;
+		decoded_samples += count;
+		if (done)
+			done(start, count);
+	}
+}
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace agi {
+class AudioProvider;
+
+/// Fills an audio cache in the background, one fixed-size block at a time
+///
+/// The timeline is split into blocks which are decoded by several threads
+/// at once, each with its own instance of the source provider obtained from
+/// AudioProvider::Clone(). Each thread keeps reading sequentially for as long
+/// as it can and only seeks when it runs into a block which someone else has
+/// already done, at which point it takes the middle of the largest remaining
+/// gap. Providers which can't be cloned are decoded front-to-back on a single
+/// thread as before.
+///
+/// Ranges which are needed right away (such as the part being played) can be
+/// moved to the front of the queue with Prioritize(). Whenever a thread
+/// finishes a block it goes to the earliest pending block in the most urgent
+/// range before doing anything else, so a seek only has to wait for the blocks
+/// already in progress to finish.
+class AudioCacheDecoder {
+public:
+	/// Decode the samples [start, start + count) using the given provider
+	/// and store them in the cache. Called on the worker threads, but never
+	/// concurrently for the same block.
+	using DecodeFunc = std::function<void(AudioProvider const& decoder, size_t block, int64_t start, int64_t count)>;
+
+	/// Called on a worker thread once the samples [start, start + count) are
+	/// readable from the cache, including blocks restored with MarkDecoded()
+	using DoneFunc = std::function<void(int64_t start, int64_t count)>;
+
+	/// Number of independent priority ranges, with lower slots more urgent
+	static const size_t priority_slots = 2;
+
+private:
+	enum : uint8_t { Pending, Claimed, Decoded };
+
+	AudioProvider const& source;
+	int64_t block_size;
+	size_t block_count;
+	std::atomic<int64_t>& decoded_samples;
+	DecodeFunc decode;
+	DoneFunc done;
+
+	std::unique_ptr<std::atomic<uint8_t>[]> state;
+	std::mutex mutex;
+	/// Block ranges [first, second) to decode first, by slot. Guarded by mutex.
+	std::array<std::pair<size_t, size_t>, priority_slots> priority{};
+	std::atomic<bool> cancelled{false};
+	std::vector<std::thread> workers;
+
+	size_t NextBlock(size_t last);
+	size_t SplitLargestGap(size_t begin, size_t end) const;
+	size_t FirstPending(size_t begin, size_t end) const;
+	void Work(AudioProvider const& decoder);
+
+public:
+	/// @param source Provider to decode from
+	/// @param block_size Number of samples per channel in each block
+	/// @param decoded_samples Counter to add the size of each finished block to
+	/// @param decode Function which decodes a single block into the cache
+	/// @param done Optional function to call after each block is finished
+	AudioCacheDecoder(AudioProvider const& source, int64_t block_size, std::atomic<int64_t>& decoded_samples, DecodeFunc decode, DoneFunc done = nullptr);
+	~AudioCacheDecoder();
+
+	size_t BlockCount() const { return block_count; }
+	int64_t BlockSize() const { return block_size; }
+
+	/// Mark a block as already present in the cache. Only valid before Start().
+	void MarkDecoded(size_t block);
+
+	/// Start decoding everything which has not been marked as decoded
+	void Start();
+
+	/// Cancel decoding and wait for the worker threads to exit. Must be called
+	/// before anything used by the decode function is destroyed.
+	void Stop();
+
+	/// Decode the samples in [start, start + count) before anything in a
+	/// lower-priority slot or outside of any priority range. A count of zero
+	/// clears the slot. May be called from any thread at any time.
+	void Prioritize(size_t slot, int64_t start, int64_t count);
+
+	/// Has the given block finished decoding?
+	bool IsBlockDecoded(size_t block) const { return state[block] == Decoded; }
+
+	/// Have all of the samples in [start, start + count) been decoded?
+	bool IsDecoded(int64_t start, int64_t count) const;
+};
+}
@@ -0,0 +1,269 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/peak_index.h"
+
+#include "libaegisub/audio/provider.h"
+#include "libaegisub/fs.h"
+#include "libaegisub/io.h"
+#include "libaegisub/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace {
+/// Written at the start of a saved index, followed by the source's path, one
+/// byte per span saying whether it is complete and then the buckets of each
+/// level in order
+struct PeakFileHeader {
+	char magic[8] = {'A', 'G', 'I', 'P', 'E', 'A', 'K', 'S'};
+	uint32_t version = 2;
+	int32_t sample_rate = 0;
+	int64_t num_samples = 0;
+	uint64_t source_size = 0;
+	int64_t source_mtime = 0;
+	uint32_t fingerprint = 0;
+	uint32_t path_length = 0;
+};
+
+PeakFileHeader MakeHeader(int sample_rate, int64_t num_samples, agi::AudioPeakSource const& source) {
+	PeakFileHeader header;
+	header.sample_rate = sample_rate;
+	header.num_samples = num_samples;
+	header.source_size = source.size;
+	header.source_mtime = source.mtime;
+	header.fingerprint = source.fingerprint;
+	header.path_length = source.path.size();
+	return header;
+}
+}
+
+namespace agi {
+const int AudioPeakIndex::level_bits[] = {8, 12, 16};
+const int64_t AudioPeakIndex::span_size = int64_t(1) << level_bits[level_count - 1];
+
+AudioPeakIndex::AudioPeakIndex(AudioProvider const& provider)
+: num_samples(provider.GetNumSamples())
+, sample_rate(provider.GetSampleRate())
+, complete(new std::atomic<bool>[(num_samples + span_size - 1) / span_size]())
+, claimed((num_samples + span_size - 1) / span_size)
+{
+	for (int i = 0; i < level_count; ++i)
+		levels[i].resize((num_samples + (int64_t(1) << level_bits[i]) - 1) >> level_bits[i]);
+}
+
+void AudioPeakIndex::ComputeSpan(AudioProvider const& provider, size_t span) {
+	static_assert(sizeof(level_bits) / sizeof(level_bits[0]) == level_count, "Wrong number of levels");
+
+	const int64_t start = span * span_size;
+	const int64_t count = std::min(span_size, num_samples - start);
+
+	thread_local std::vector<int16_t> buffer;
+	buffer.resize(count);
+	provider.GetInt16MonoAudio(buffer.data(), start, count);
+
+	for (int level = 0; level < level_count; ++level) {
+		const int64_t bucket_size = int64_t(1) << level_bits[level];
+		for (int64_t bucket = 0; bucket * bucket_size < count; ++bucket) {
+			const int64_t begin = bucket * bucket_size;
+			const int64_t end = std::min(begin + bucket_size, count);
+
+			int min = 0, max = 0;
+			int64_t sum_min = 0, sum_max = 0;
+			for (int64_t i = begin; i < end; ++i) {
+				int sample = buffer[i];
+				if (sample > 0) {
+					max = std::max(max, sample);
+					sum_max += sample;
+				}
+				else {
+					min = std::min(min, sample);
+					sum_min += sample;
+				}
+			}
+
+			AudioPeak& peak = levels[level][(start + begin) >> level_bits[level]];
+			peak.min = min;
+			peak.max = max;
+			peak.avg_min = static_cast<int16_t>(sum_min / (end - begin));
+			peak.avg_max = static_cast<int16_t>(sum_max / (end - begin));
+		}
+	}
+}
+
+void AudioPeakIndex::Update(AudioProvider const& provider, int64_t start, int64_t count) {
+	start = std::max<int64_t>(start, 0);
+	const int64_t end = std::min(start + count, num_samples);
+	if (end <= start) return;
+
+	// Only claim the spans while holding the lock so that the decoder threads
+	// can compute their spans in parallel
+	std::vector<size_t> spans;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t span = start / span_size, last = (end - 1) / span_size; span <= last; ++span) {
+			if (claimed[span]) continue;
+
+			// Spans can straddle the cache's blocks, in which case whichever
+			// block finishes last fills it in
+			const int64_t span_start = span * span_size;
+			if (!provider.IsRangeDecoded(span_start, std::min(span_size, num_samples - span_start)))
+				continue;
+
+			claimed[span] = true;
+			spans.push_back(span);
+		}
+	}
+	if (spans.empty()) return;
+
+	for (size_t span : spans) {
+		ComputeSpan(provider, span);
+		complete[span] = true;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	modified = true;
+}
+
+bool AudioPeakIndex::IsComplete(int64_t start, int64_t count) const {
+	start = std::max<int64_t>(start, 0);
+	const int64_t end = std::min(start + count, num_samples);
+	if (end <= start) return false;
+
+	for (size_t span = start / span_size, last = (end - 1) / span_size; span <= last; ++span) {
+		if (!complete[span])
+			return false;
+	}
+	return true;
+}
+
+void AudioPeakIndex::SetFile(fs::path const& file, AudioPeakSource const& source) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->file = file;
+	this->source = source;
+	try {
+		if (Load())
+			LOG_D("audio/peak_index") << "Loaded " << file;
+	}
+	catch (agi::Exception const& e) {
+		LOG_E("audio/peak_index") << "Failed to load " << file << ": " << e.GetMessage();
+	}
+}
+
+bool AudioPeakIndex::Load() {
+	if (!fs::FileExists(file)) return false;
+
+	auto stream = io::Open(file, true);
+	auto expected = MakeHeader(sample_rate, num_samples, source);
+	PeakFileHeader header;
+	if (!stream->read(reinterpret_cast<char *>(&header), sizeof header) || memcmp(&header, &expected, sizeof header))
+		return false;
+
+	std::string path(header.path_length, 0);
+	if (!stream->read(&path[0], path.size()) || path != source.path)
+		return false;
+
+	const size_t span_count = (num_samples + span_size - 1) / span_size;
+	std::vector<char> saved(span_count);
+	std::vector<AudioPeak> buckets[level_count];
+	if (!stream->read(saved.data(), span_count))
+		return false;
+	for (int i = 0; i < level_count; ++i) {
+		buckets[i].resize(levels[i].size());
+		if (!stream->read(reinterpret_cast<char *>(buckets[i].data()), buckets[i].size() * sizeof(AudioPeak)))
+			return false;
+	}
+
+	for (size_t span = 0; span < span_count; ++span) {
+		if (!saved[span] || claimed[span]) continue;
+		claimed[span] = true;
+		for (int i = 0; i < level_count; ++i) {
+			const size_t per_span = size_t(1) << (level_bits[level_count - 1] - level_bits[i]);
+			const size_t first = span * per_span, last = std::min(first + per_span, levels[i].size());
+			std::copy(&buckets[i][first], &buckets[i][0] + last, &levels[i][first]);
+		}
+		complete[span] = true;
+	}
+	return true;
+}
+
+void AudioPeakIndex::Save() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (file.empty() || !modified) return;
+
+	try {
+		io::Save out(file, true);
+		auto header = MakeHeader(sample_rate, num_samples, source);
+		out.Get().write(reinterpret_cast<const char *>(&header), sizeof header);
+		out.Get().write(source.path.data(), source.path.size());
+
+		// Spans may still be being filled in by other threads, so only write
+		// the buckets of the ones which were complete to begin with
+		const size_t span_count = (num_samples + span_size - 1) / span_size;
+		std::vector<char> saved(span_count);
+		for (size_t span = 0; span < span_count; ++span) {
+			saved[span] = complete[span] ? 1 : 0;
+			out.Get().put(saved[span]);
+		}
+		for (int i = 0; i < level_count; ++i) {
+			const size_t per_span = size_t(1) << (level_bits[level_count - 1] - level_bits[i]);
+			const std::vector<AudioPeak> empty(per_span);
+			for (size_t span = 0; span < span_count; ++span) {
+				const size_t first = span * per_span, last = std::min(first + per_span, levels[i].size());
+				auto const& buckets = saved[span] ? levels[i][first] : empty[0];
+				out.Get().write(reinterpret_cast<const char *>(&buckets), (last - first) * sizeof(AudioPeak));
+			}
+		}
+		out.Close();
+		modified = false;
+	}
+	catch (agi::Exception const& e) {
+		LOG_E("audio/peak_index") << "Failed to save " << file << ": " << e.GetMessage();
+	}
+}
+
+bool AudioPeakIndex::Get(int64_t start, int64_t count, int64_t max_bucket, AudioPeak &out) const {
+	start = std::max<int64_t>(start, 0);
+	const int64_t end = std::min(start + count, num_samples);
+	if (end <= start) return false;
+
+	int level = level_count - 1;
+	while (level >= 0 && (int64_t(1) << level_bits[level]) > max_bucket)
+		--level;
+	if (level < 0 || !IsComplete(start, end - start)) return false;
+
+	const int bits = level_bits[level];
+	const size_t first = start >> bits, last = (end - 1) >> bits;
+	int min = 0, max = 0;
+	int64_t sum_min = 0, sum_max = 0;
+	for (size_t i = first; i <= last; ++i) {
+		AudioPeak const& peak = levels[level][i];
+		min = std::min<int>(min, peak.min);
+		max = std::max<int>(max, peak.max);
+		sum_min += peak.avg_min;
+		sum_max += peak.avg_max;
+	}
+
+	const int64_t buckets = last - first + 1;
+	out.min = min;
+	out.max = max;
+	out.avg_min = static_cast<int16_t>(sum_min / buckets);
+	out.avg_max = static_cast<int16_t>(sum_max / buckets);
+	return true;
+}
+}
@@ -16,108 +16,27 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "libaegisub/audio/sample_convert.h"
 #include "libaegisub/fs.h"
 #include "libaegisub/io.h"
 #include "libaegisub/log.h"
 #include "libaegisub/util.h"
 
-namespace {
-
-template<typename Source>
-class ConvertFloatToInt16 {
-	Source* src;
-public:
-	ConvertFloatToInt16(Source* src) :src(src) {}
-	int16_t operator[](size_t idx) const {
-		Source expanded = src[idx] * 32768;
-		return expanded < -32768 ? -32768 :
-			expanded > 32767 ? 32767 :
-			static_cast<int16_t>(expanded);
-	}
-};
-
-// 8 bits per sample is assumed to be unsigned with a bias of 128,
-// while everything else is assumed to be signed with zero bias
-class ConvertIntToInt16 {
-	void* src;
-	int bytes_per_sample;
-public:
-	ConvertIntToInt16(void* src, int bytes_per_sample) :src(src), bytes_per_sample(bytes_per_sample) {}
-	const int16_t& operator[](size_t idx) const {
-		return *reinterpret_cast<int16_t*>(reinterpret_cast<char*>(src) + (idx + 1) * bytes_per_sample - sizeof(int16_t));
-	}
-};
-class ConvertUInt8ToInt16 {
-	uint8_t* src;
-public:
-	ConvertUInt8ToInt16(uint8_t* src) :src(src) {}
-	int16_t operator[](size_t idx) const {
-		return int16_t(src[idx]-128) << 8;
-	}
-};
-
-template<typename Source>
-class DownmixToMono {
-	Source src;
-	int channels;
-	bool asAmplitudeEnv;
-public:
-	DownmixToMono(Source src, int channels, bool asAmpEnv = false) :src(src), channels(channels), asAmplitudeEnv(asAmpEnv) {}
-	int16_t operator[](size_t idx) const {
-		int ret = 0;
-		// Just average the channels together
-		for (int i = 0; i < channels; ++i)
-			ret += src[idx * channels + i];
-		return ret / channels;
-	}
-};
-}
+#include <boost/crc.hpp>
 
 namespace agi {
-void AudioProvider::FillBufferInt16Mono(int16_t* buf, int64_t start, int64_t count, bool asAmplitude) const {
+void AudioProvider::FillBufferInt16Mono(int16_t* buf, int64_t start, int64_t count, bool) const {
 	if (!float_samples && bytes_per_sample == 2 && channels == 1) {
 		FillBuffer(buf, start, count);
 		return;
 	}
-	void* buff = malloc(bytes_per_sample * count * channels);
-	FillBuffer(buff, start, count);
-	if (channels == 1) {
-		if (float_samples) {
-			if (bytes_per_sample == sizeof(float))
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = ConvertFloatToInt16<float>(reinterpret_cast<float*>(buff))[i];
-			else if (bytes_per_sample == sizeof(double))
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = ConvertFloatToInt16<double>(reinterpret_cast<double*>(buff))[i];
-		}
-		else {
-			if (bytes_per_sample == sizeof(uint8_t))
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = ConvertUInt8ToInt16(reinterpret_cast<uint8_t*>(buff))[i];
-			else
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = ConvertIntToInt16(buff, bytes_per_sample)[i];
-		}
-	}
-	else {
-		if (float_samples) {
-			if (bytes_per_sample == sizeof(float))
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = DownmixToMono<ConvertFloatToInt16<float> >(ConvertFloatToInt16<float>(reinterpret_cast<float*>(buff)), channels, asAmplitude)[i];
-			else if (bytes_per_sample == sizeof(double))
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = DownmixToMono<ConvertFloatToInt16<double> >(ConvertFloatToInt16<double>(reinterpret_cast<double*>(buff)), channels, asAmplitude)[i];
-		}
-		else {
-			if (bytes_per_sample == sizeof(uint8_t))
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = DownmixToMono<ConvertUInt8ToInt16>(ConvertUInt8ToInt16(reinterpret_cast<uint8_t*>(buff)), channels, asAmplitude)[i];
-			else
-				for (int64_t i = 0; i < count; ++i)
-					buf[i] = DownmixToMono<ConvertIntToInt16>(ConvertIntToInt16(buff, bytes_per_sample), channels, asAmplitude)[i];
-		}
-	}
-	free(buff);
+
+	// Reused between calls as this is run for every block of audio which is
+	// drawn or played
+	thread_local std::vector<char> scratch;
+	scratch.resize(bytes_per_sample * count * channels);
+	FillBuffer(scratch.data(), start, count);
+	ConvertToInt16Mono(buf, scratch.data(), count, channels, bytes_per_sample, float_samples);
 }
 
 void AudioProvider::GetInt16MonoAudioWithVolume(int16_t *buf, int64_t start, int64_t count, double volume) const {
@@ -228,6 +147,21 @@ public:
 };
 }
 
+uint32_t FingerprintAudio(AudioProvider const& provider) {
+	const int64_t span = 4096;
+	const size_t frame_size = provider.GetBytesPerSample() * provider.GetChannels();
+	std::vector<char> buf(span * frame_size);
+
+	boost::crc_32_type hash;
+	const int64_t num_samples = provider.GetNumSamples();
+	for (int64_t start : {int64_t(0), num_samples / 2, num_samples - span}) {
+		start = std::max<int64_t>(0, start);
+		provider.GetAudio(buf.data(), start, span);
+		hash.process_bytes(buf.data(), buf.size());
+	}
+	return hash.checksum();
+}
+
 void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int start_time, int end_time) {
 	const auto max_samples = provider.GetNumSamples();
 	const auto start_sample = std::min(max_samples, ((int64_t)start_time * provider.GetSampleRate() + 999) / 1000);
@@ -36,6 +36,11 @@ public:
 	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
 		source->GetInt16MonoAudio(reinterpret_cast<int16_t*>(buf), start, count);
 	}
+
+	std::unique_ptr<AudioProvider> Clone() const override {
+		auto src = source->Clone();
+		return src ? agi::make_unique<ConvertAudioProvider>(std::move(src)) : nullptr;
+	}
 };
 
 /// Sample doubler with linear interpolation for the samples provider
@@ -72,6 +77,11 @@ public:
 				dst[i] = src[src_index];
 		}
 	}
+
+	std::unique_ptr<AudioProvider> Clone() const override {
+		auto src = source->Clone();
+		return src ? agi::make_unique<SampleDoublingAudioProvider>(std::move(src)) : nullptr;
+	}
 };
 }
 
@@ -98,4 +108,12 @@ std::unique_ptr<AudioProvider> CreateConvertAudioProvider(std::unique_ptr<AudioP
 
 	return provider;
 }
+
+std::unique_ptr<AudioProvider> CreateDownmixAudioProvider(std::unique_ptr<AudioProvider> provider) {
+	if (!provider->AreSamplesFloat() && provider->GetBytesPerSample() == 2 && provider->GetChannels() == 1)
+		return provider;
+
+	LOG_D("audio_provider") << "Caching " << provider->GetChannels() << " channel audio as S16 mono";
+	return agi::make_unique<ConvertAudioProvider>(std::move(provider));
+}
 }
@@ -16,77 +16,238 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "cache_decoder.h"
+
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/file_mapping.h>
 #include <libaegisub/format.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/path.h>
 #include <libaegisub/make_unique.h>
 
+#include <boost/crc.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/detail/os_thread_functions.hpp>
 #include <ctime>
-#include <thread>
+#include <mutex>
 
 
 namespace {
 using namespace agi;
 
+/// Bumped whenever the layout of the cache file changes so that old caches
+/// are discarded rather than misread
+const uint32_t cache_version = 2;
+
+/// Space reserved for the header at the start of the cache file
+const int64_t header_size = 4096;
+
+/// Number of samples per channel in each independently decoded block
+const int64_t block_size = 65536;
+
+/// Number of blocks decoded between updates of the header and block map
+const int sync_interval = 64;
+
+/// Stored at the start of the cache file. Everything but decoded_samples has to
+/// match for the cached samples to be reused.
+struct CacheHeader {
+	char magic[8] = {'A', 'G', 'I', 'A', 'U', 'D', 'I', 'O'};
+	uint32_t version = cache_version;
+	int32_t channels = 0;
+	int32_t sample_rate = 0;
+	int32_t bytes_per_sample = 0;
+	int32_t float_samples = 0;
+	uint32_t fingerprint = 0;
+	int64_t num_samples = 0;
+	uint64_t source_size = 0;
+	int64_t source_mtime = 0;
+	int64_t decoded_samples = 0;
+
+	bool Matches(CacheHeader const& other) const {
+		return memcmp(this, &other, offsetof(CacheHeader, decoded_samples)) == 0;
+	}
+};
+static_assert(sizeof(CacheHeader) <= header_size, "Cache header does not fit in the reserved space");
+
+/// The header is followed by one byte per block recording whether it has been
+/// decoded, and then the samples themselves, starting on a page boundary
+int64_t DataOffset(int64_t num_samples) {
+	int64_t blocks = (num_samples + block_size - 1) / block_size;
+	return header_size + (blocks + 4095) / 4096 * 4096;
+}
+
+/// temp_file_mapping never has anything in it which could be reused
+uint64_t previous_size(temp_file_mapping const&) { return 0; }
+uint64_t previous_size(persistent_file_mapping const& file) { return file.previous_size(); }
+
+template<typename Mapping>
 class HDAudioProvider final : public AudioProviderWrapper {
-	mutable temp_file_mapping file;
-	std::atomic<bool> cancelled = {false};
-	std::thread decoder;
+	mutable Mapping file;
+	CacheHeader header;
+	const int64_t data_offset;
+	std::mutex write_mutex;
+	/// The mapping only has one read window, so readers on different threads
+	/// (the renderer, the player, the peak index) have to take turns
+	mutable std::mutex read_mutex;
+	int blocks_since_sync = 0;
+	AudioPeakIndex peaks{*this};
+	std::unique_ptr<AudioCacheDecoder> decoder;
 
 	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
-		auto missing = std::min(count, start + count - decoded_samples);
-		if (missing > 0) {
-			memset(static_cast<int16_t*>(buf) + count - missing, 0, missing * bytes_per_sample * channels);
-			count -= missing;
+		const int64_t frame_size = bytes_per_sample * channels;
+		auto out = static_cast<char *>(buf);
+		while (count > 0) {
+			const size_t block = start / block_size;
+			const int64_t read = std::min(count, (int64_t)(block + 1) * block_size - start);
+			if (decoder->IsBlockDecoded(block)) {
+				std::lock_guard<std::mutex> lock(read_mutex);
+				memcpy(out, file.read(data_offset + start * frame_size, read * frame_size), read * frame_size);
+			}
+			else
+				memset(out, 0, read * frame_size);
+			out += read * frame_size;
+			start += read;
+			count -= read;
 		}
+	}
 
-		if (count > 0) {
-			start *= bytes_per_sample * channels;
-			count *= bytes_per_sample * channels;
-			memcpy(buf, file.read(start, count), count);
-		}
+	void DecodeBlock(AudioProvider const& source, int64_t start, int64_t count) {
+		const int64_t frame_size = bytes_per_sample * channels;
+		thread_local std::vector<char> buf;
+		buf.resize(count * frame_size);
+		source.GetAudio(buf.data(), start, count);
+
+		std::lock_guard<std::mutex> lock(write_mutex);
+		memcpy(file.write(data_offset + start * frame_size, buf.size()), buf.data(), buf.size());
+		if (++blocks_since_sync == sync_interval)
+			Sync();
 	}
 
-	fs::path CacheFilename(fs::path dir, int hash) {
-		// Check free space
-		if ((uint64_t)num_samples * bytes_per_sample * channels > fs::FreeSpace(dir))
-			throw AudioProviderError("Not enough free disk space in " + dir.string() + " to cache the audio");
-		std::stringstream hexstream;
-		hexstream << std::hex << hash;
-		if (!fs::DirectoryExists(dir))
-			fs::CreateDirectory(dir);
-		return std::string("aegisub-audio-") + hexstream.str() + ".cache";
+	/// Write the header and block map to the file. write_mutex must be held
+	/// if the decoder is running.
+	void Sync() {
+		blocks_since_sync = 0;
+		header.decoded_samples = decoded_samples;
+		memcpy(file.write(0, sizeof header), &header, sizeof header);
+
+		auto map = file.write(header_size, decoder->BlockCount());
+		for (size_t i = 0; i < decoder->BlockCount(); ++i)
+			map[i] = decoder->IsBlockDecoded(i);
 	}
 
 public:
-	HDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir)
+	HDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& filename, CacheHeader const& key)
 	: AudioProviderWrapper(std::move(src))
-	, file(dir / CacheFilename(dir, this->GetHash()), num_samples* bytes_per_sample* channels)
+	, file(filename, DataOffset(num_samples) + num_samples * bytes_per_sample * channels)
+	, header(key)
+	, data_offset(DataOffset(num_samples))
 	{
 		decoded_samples = 0;
-		decoder = std::thread([&] {
-			int64_t block = 65536;
-			for (int64_t i = 0; i < num_samples; i += block) {
-				if (cancelled) break;
-				block = std::min(block, num_samples - i);
-				source->GetAudio(file.write(i * bytes_per_sample * channels, block * bytes_per_sample * channels), i, block);
-				decoded_samples += block;
+		decoder = agi::make_unique<AudioCacheDecoder>(*source, block_size, decoded_samples,
+			[&](AudioProvider const& source, size_t, int64_t start, int64_t count) {
+				DecodeBlock(source, start, count);
+			},
+			[&](int64_t start, int64_t count) { peaks.Update(*this, start, count); });
+
+		// Reuse whatever a previous session managed to decode if the cache
+		// file was written for the same source
+		if (previous_size(file) == data_offset + (uint64_t)num_samples * bytes_per_sample * channels) {
+			CacheHeader existing;
+			memcpy(&existing, file.read(0, sizeof existing), sizeof existing);
+			if (existing.Matches(header)) {
+				auto map = file.read(header_size, decoder->BlockCount());
+				for (size_t i = 0; i < decoder->BlockCount(); ++i) {
+					if (map[i]) {
+						decoder->MarkDecoded(i);
+						decoded_samples += std::min(block_size, num_samples - (int64_t)i * block_size);
+					}
+				}
 			}
-		});
+		}
+		Sync();
+
+		decoder->Start();
 	}
 
 	~HDAudioProvider() {
-		cancelled = true;
-		decoder.join();
+		decoder->Stop();
+		Sync();
+		peaks.Save();
+	}
+
+	bool IsRangeDecoded(int64_t start, int64_t count) const override {
+		return decoder->IsDecoded(start, count);
+	}
+
+	AudioPeakIndex const* GetPeakIndex() const override { return &peaks; }
+
+	void SetPeakIndexFile(fs::path const& file, AudioPeakSource const& source) override {
+		peaks.SetFile(file, source);
+	}
+
+	void SetDecodePriority(DecodeHint hint, int64_t start, int64_t count) override {
+		decoder->Prioritize(static_cast<size_t>(hint), start, count);
 	}
 };
+
+/// Fill in the format fields of a cache header from the provider
+CacheHeader MakeHeader(AudioProvider const& src) {
+	CacheHeader header;
+	header.channels = src.GetChannels();
+	header.sample_rate = src.GetSampleRate();
+	header.bytes_per_sample = src.GetBytesPerSample();
+	header.float_samples = src.AreSamplesFloat();
+	header.num_samples = src.GetNumSamples();
+	return header;
+}
+
+fs::path CacheDirectory(fs::path const& dir, uint64_t required) {
+	if (!fs::DirectoryExists(dir))
+		fs::CreateDirectory(dir);
+	// Check free space
+	if (required > fs::FreeSpace(dir))
+		throw AudioProviderError("Not enough free disk space in " + dir.string() + " to cache the audio");
+	return dir;
+}
+
+uint64_t CacheSize(AudioProvider const& src) {
+	return DataOffset(src.GetNumSamples()) + (uint64_t)src.GetNumSamples() * src.GetBytesPerSample() * src.GetChannels();
+}
 }
 
 namespace agi {
 std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir) {
-	return agi::make_unique<HDAudioProvider>(std::move(src), dir);
+	auto filename = CacheDirectory(dir, CacheSize(*src)) / agi::format("aegisub-audio-%x.cache", (unsigned)src->GetHash());
+	auto header = MakeHeader(*src);
+	return agi::make_unique<HDAudioProvider<temp_file_mapping>>(std::move(src), filename, header);
+}
+
+std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir, agi::fs::path const& source_file) {
+	auto header = MakeHeader(*src);
+	try {
+		header.source_size = fs::Size(source_file);
+		header.source_mtime = fs::ModifiedTime(source_file);
+	}
+	catch (fs::FileSystemError const&) {
+		// Not something on disk which we can check for modifications
+		return CreateHDAudioProvider(std::move(src), dir);
+	}
+	header.fingerprint = FingerprintAudio(*src);
+
+	boost::crc_32_type path_hash;
+	path_hash.process_bytes(source_file.string().c_str(), source_file.string().size());
+
+	auto filename = dir / agi::format("aegisub-audio-%08x-%08x.cache", path_hash.checksum(), header.fingerprint);
+	// Only need space for the parts which haven't already been cached
+	uint64_t required = CacheSize(*src);
+	if (fs::FileExists(filename))
+		required -= std::min<uint64_t>(required, fs::Size(filename));
+	CacheDirectory(dir, required);
+
+	std::unique_ptr<AudioProvider> provider = agi::make_unique<HDAudioProvider<persistent_file_mapping>>(std::move(src), filename, header);
+	// Bump the modification time so that the least recently used caches are
+	// the ones which get cleaned up
+	fs::Touch(filename);
+	return provider;
 }
 }
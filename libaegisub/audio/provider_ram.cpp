@@ -16,11 +16,13 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "cache_decoder.h"
+
+#include "libaegisub/audio/peak_index.h"
 #include "libaegisub/make_unique.h"
 
 #include <array>
 #include <boost/container/stable_vector.hpp>
-#include <thread>
 
 namespace {
 using namespace agi;
@@ -34,8 +36,8 @@ class RAMAudioProvider final : public AudioProviderWrapper {
 #else
 	boost::container::stable_vector<std::array<char, CacheBlockSize>> blockcache;
 #endif
-	std::atomic<bool> cancelled = {false};
-	std::thread decoder;
+	AudioPeakIndex peaks{*this};
+	std::unique_ptr<AudioCacheDecoder> decoder;
 
 	void FillBuffer(void *buf, int64_t start, int64_t count) const override;
 
@@ -45,45 +47,56 @@ public:
 	{
 		decoded_samples = 0;
 
+		// Each decoder block fills exactly one cache block
+		const int64_t samples_per_block = CacheBlockSize / bytes_per_sample / channels;
 		try {
-			blockcache.resize((num_samples * bytes_per_sample * channels + CacheBlockSize - 1) >> CacheBits);
+			blockcache.resize((num_samples + samples_per_block - 1) / samples_per_block);
 		}
 		catch (std::bad_alloc const&) {
 			throw AudioProviderError("Not enough memory available to cache in RAM");
 		}
 
-		decoder = std::thread([&] {
-			int64_t readsize = CacheBlockSize / bytes_per_sample / channels;
-			for (size_t i = 0; i < blockcache.size(); i++) {
-				if (cancelled) break;
-				auto actual_read = std::min<int64_t>(readsize, num_samples - i * readsize);
-				source->GetAudio(&blockcache[i][0], i * readsize, actual_read);
-				decoded_samples += actual_read;
-			}
-		});
+		decoder = agi::make_unique<AudioCacheDecoder>(*source, samples_per_block, decoded_samples,
+			[&](AudioProvider const& decoder, size_t block, int64_t start, int64_t count) {
+				decoder.GetAudio(&blockcache[block][0], start, count);
+			},
+			[&](int64_t start, int64_t count) { peaks.Update(*this, start, count); });
+		decoder->Start();
 	}
 
 	~RAMAudioProvider() {
-		cancelled = true;
-		decoder.join();
+		decoder->Stop();
+		peaks.Save();
+	}
+
+	bool IsRangeDecoded(int64_t start, int64_t count) const override {
+		return decoder->IsDecoded(start, count);
+	}
+
+	AudioPeakIndex const* GetPeakIndex() const override { return &peaks; }
+
+	void SetPeakIndexFile(fs::path const& file, AudioPeakSource const& source) override {
+		peaks.SetFile(file, source);
+	}
+
+	void SetDecodePriority(DecodeHint hint, int64_t start, int64_t count) override {
+		decoder->Prioritize(static_cast<size_t>(hint), start, count);
 	}
 };
 
 void RAMAudioProvider::FillBuffer(void *buf, int64_t start, int64_t count) const {
 	auto charbuf = static_cast<char *>(buf);
 	for (int64_t bytes_remaining = count * bytes_per_sample * channels; bytes_remaining; ) {
-		if (start >= decoded_samples) {
-			memset(charbuf, 0, bytes_remaining);
-			break;
-		}
-
 		const int64_t samples_per_block = CacheBlockSize / bytes_per_sample / channels;
 
 		const size_t i = start / samples_per_block;
 		const int start_offset = (start % samples_per_block) * bytes_per_sample * channels;
 		const int read_size = std::min<int>(bytes_remaining, samples_per_block * bytes_per_sample * channels - start_offset);
 
-		memcpy(charbuf, &blockcache[i][start_offset], read_size);
+		if (decoder->IsBlockDecoded(i))
+			memcpy(charbuf, &blockcache[i][start_offset], read_size);
+		else
+			memset(charbuf, 0, read_size);
 		charbuf += read_size;
 		bytes_remaining -= read_size;
 		start += read_size / bytes_per_sample / channels;
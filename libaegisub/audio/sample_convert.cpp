@@ -0,0 +1,307 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/sample_convert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef AGI_X86
+#include <immintrin.h>
+#endif
+
+// Conversion is done in two steps: first each sample is converted to int16,
+// and then the channels are averaged. Each step has a scalar version which
+// defines the exact results, and SSE2/AVX2 versions which do the bulk of the
+// work and leave the remainder to the scalar version.
+
+namespace {
+using agi::cpu::SimdLevel;
+
+template<typename Source>
+void FloatToInt16(int16_t *dst, const Source *src, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		Source expanded = src[i] * 32768;
+		dst[i] = expanded < -32768 ? -32768 :
+			expanded > 32767 ? 32767 :
+			static_cast<int16_t>(expanded);
+	}
+}
+
+// 8 bits per sample is assumed to be unsigned with a bias of 128,
+// while everything else is assumed to be signed with zero bias
+void UInt8ToInt16(int16_t *dst, const uint8_t *src, size_t count) {
+	for (size_t i = 0; i < count; ++i)
+		dst[i] = int16_t(src[i] - 128) << 8;
+}
+
+void IntToInt16(int16_t *dst, const char *src, size_t count, int bytes_per_sample) {
+	for (size_t i = 0; i < count; ++i)
+		memcpy(&dst[i], src + (i + 1) * bytes_per_sample - sizeof(int16_t), sizeof(int16_t));
+}
+
+void Downmix(int16_t *dst, const int16_t *src, size_t count, int channels) {
+	if (channels > 256) {
+		for (size_t i = 0; i < count; ++i) {
+			int sum = 0;
+			for (int c = 0; c < channels; ++c)
+				sum += src[i * channels + c];
+			dst[i] = sum / channels;
+		}
+		return;
+	}
+
+	// For sums of up to 256 channels, multiplying the magnitude by the
+	// rounded-up reciprocal gives exactly the same results as dividing
+	const uint64_t reciprocal = ((uint64_t(1) << 32) + channels - 1) / channels;
+	for (size_t i = 0; i < count; ++i) {
+		int sum = 0;
+		for (int c = 0; c < channels; ++c)
+			sum += src[i * channels + c];
+		const int quotient = static_cast<int>((uint64_t(sum < 0 ? -sum : sum) * reciprocal) >> 32);
+		dst[i] = sum < 0 ? -quotient : quotient;
+	}
+}
+
+#ifdef AGI_X86
+AGI_TARGET("sse2")
+void FloatToInt16SSE2(int16_t *dst, const float *src, size_t count) {
+	const __m128 scale = _mm_set1_ps(32768.f), lo = _mm_set1_ps(-32768.f), hi = _mm_set1_ps(32767.f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), lo), hi));
+		__m128i b = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), lo), hi));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+	}
+	FloatToInt16(dst + i, src + i, count - i);
+}
+
+AGI_TARGET("sse2")
+__m128i DoubleToInt32SSE2(const double *src) {
+	const __m128d scale = _mm_set1_pd(32768.), lo = _mm_set1_pd(-32768.), hi = _mm_set1_pd(32767.);
+	__m128i a = _mm_cvttpd_epi32(_mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(src), scale), lo), hi));
+	__m128i b = _mm_cvttpd_epi32(_mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(src + 2), scale), lo), hi));
+	return _mm_unpacklo_epi64(a, b);
+}
+
+AGI_TARGET("sse2")
+void DoubleToInt16SSE2(int16_t *dst, const double *src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(DoubleToInt32SSE2(src + i), DoubleToInt32SSE2(src + i + 4)));
+	FloatToInt16(dst + i, src + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void UInt8ToInt16SSE2(int16_t *dst, const uint8_t *src, size_t count) {
+	// (x - 128) << 8 is x << 8 with the sign bit flipped
+	const __m128i zero = _mm_setzero_si128(), bias = _mm_set1_epi16(-0x8000);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_xor_si128(_mm_unpacklo_epi8(zero, v), bias));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_xor_si128(_mm_unpackhi_epi8(zero, v), bias));
+	}
+	UInt8ToInt16(dst + i, src + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void Int32ToInt16SSE2(int16_t *dst, const char *src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4)), 16);
+		__m128i b = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4 + 16)), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+	}
+	IntToInt16(dst + i, src + i * 4, count - i, 4);
+}
+
+/// Divide by two, rounding towards zero like integer division does
+AGI_TARGET("sse2")
+__m128i HalveSSE2(__m128i v) {
+	return _mm_srai_epi32(_mm_add_epi32(v, _mm_srli_epi32(v, 31)), 1);
+}
+
+AGI_TARGET("sse2")
+void DownmixStereoSSE2(int16_t *dst, const int16_t *src, size_t count) {
+	const __m128i ones = _mm_set1_epi16(1);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2)), ones);
+		__m128i b = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2 + 8)), ones);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(HalveSSE2(a), HalveSSE2(b)));
+	}
+	Downmix(dst + i, src + i * 2, count - i, 2);
+}
+
+AGI_TARGET("avx2")
+void FloatToInt16AVX2(int16_t *dst, const float *src, size_t count) {
+	const __m256 scale = _mm256_set1_ps(32768.f), lo = _mm256_set1_ps(-32768.f), hi = _mm256_set1_ps(32767.f);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i a = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), lo), hi));
+		__m256i b = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale), lo), hi));
+		// packs works within each 128-bit lane, so put the quarters back in order
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+	}
+	FloatToInt16(dst + i, src + i, count - i);
+}
+
+AGI_TARGET("avx2")
+__m128i DoubleToInt32AVX2(const double *src) {
+	const __m256d scale = _mm256_set1_pd(32768.), lo = _mm256_set1_pd(-32768.), hi = _mm256_set1_pd(32767.);
+	return _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(_mm256_loadu_pd(src), scale), lo), hi));
+}
+
+AGI_TARGET("avx2")
+void DoubleToInt16AVX2(int16_t *dst, const double *src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(DoubleToInt32AVX2(src + i), DoubleToInt32AVX2(src + i + 4)));
+	FloatToInt16(dst + i, src + i, count - i);
+}
+
+AGI_TARGET("avx2")
+void UInt8ToInt16AVX2(int16_t *dst, const uint8_t *src, size_t count) {
+	const __m256i zero = _mm256_setzero_si256(), bias = _mm256_set1_epi16(-0x8000);
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i v = _mm256_permute4x64_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)), 0xD8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_xor_si256(_mm256_unpacklo_epi8(zero, v), bias));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i + 16), _mm256_xor_si256(_mm256_unpackhi_epi8(zero, v), bias));
+	}
+	UInt8ToInt16(dst + i, src + i, count - i);
+}
+
+AGI_TARGET("avx2")
+void Int24ToInt16AVX2(int16_t *dst, const char *src, size_t count) {
+	// Pick the top two bytes of each of four packed 24-bit samples
+	const __m128i shuffle = _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+	size_t i = 0;
+	// Each load reads four bytes past the samples it uses, so stop early
+	// enough to never read past the end of the buffer
+	for (; i + 10 <= count; i += 8) {
+		__m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3)), shuffle);
+		__m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3 + 12)), shuffle);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi64(a, b));
+	}
+	IntToInt16(dst + i, src + i * 3, count - i, 3);
+}
+
+AGI_TARGET("avx2")
+void Int32ToInt16AVX2(int16_t *dst, const char *src, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i a = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4)), 16);
+		__m256i b = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4 + 32)), 16);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+	}
+	IntToInt16(dst + i, src + i * 4, count - i, 4);
+}
+
+AGI_TARGET("avx2")
+__m256i HalveAVX2(__m256i v) {
+	return _mm256_srai_epi32(_mm256_add_epi32(v, _mm256_srli_epi32(v, 31)), 1);
+}
+
+AGI_TARGET("avx2")
+void DownmixStereoAVX2(int16_t *dst, const int16_t *src, size_t count) {
+	const __m256i ones = _mm256_set1_epi16(1);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i a = _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2)), ones);
+		__m256i b = _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2 + 16)), ones);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(HalveAVX2(a), HalveAVX2(b)), 0xD8));
+	}
+	Downmix(dst + i, src + i * 2, count - i, 2);
+}
+#endif
+
+/// Convert count samples to int16 without touching the channel layout
+void ToInt16(int16_t *dst, const void *src, size_t count, int bytes_per_sample, bool float_samples, SimdLevel level) {
+	auto bytes = static_cast<const char *>(src);
+	if (float_samples) {
+		if (bytes_per_sample == sizeof(float)) {
+			auto samples = static_cast<const float *>(src);
+#ifdef AGI_X86
+			if (level == SimdLevel::AVX2) return FloatToInt16AVX2(dst, samples, count);
+			if (level == SimdLevel::SSE2) return FloatToInt16SSE2(dst, samples, count);
+#endif
+			return FloatToInt16(dst, samples, count);
+		}
+		if (bytes_per_sample == sizeof(double)) {
+			auto samples = static_cast<const double *>(src);
+#ifdef AGI_X86
+			if (level == SimdLevel::AVX2) return DoubleToInt16AVX2(dst, samples, count);
+			if (level == SimdLevel::SSE2) return DoubleToInt16SSE2(dst, samples, count);
+#endif
+			return FloatToInt16(dst, samples, count);
+		}
+		std::fill_n(dst, count, 0);
+		return;
+	}
+
+	switch (bytes_per_sample) {
+		case 1: {
+			auto samples = static_cast<const uint8_t *>(src);
+#ifdef AGI_X86
+			if (level == SimdLevel::AVX2) return UInt8ToInt16AVX2(dst, samples, count);
+			if (level == SimdLevel::SSE2) return UInt8ToInt16SSE2(dst, samples, count);
+#endif
+			return UInt8ToInt16(dst, samples, count);
+		}
+		case 2:
+			memcpy(dst, src, count * sizeof(int16_t));
+			return;
+#ifdef AGI_X86
+		case 3:
+			if (level == SimdLevel::AVX2) return Int24ToInt16AVX2(dst, bytes, count);
+			break;
+		case 4:
+			if (level == SimdLevel::AVX2) return Int32ToInt16AVX2(dst, bytes, count);
+			if (level == SimdLevel::SSE2) return Int32ToInt16SSE2(dst, bytes, count);
+			break;
+#endif
+	}
+	IntToInt16(dst, bytes, count, bytes_per_sample);
+}
+
+void Downmix(int16_t *dst, const int16_t *src, size_t count, int channels, SimdLevel level) {
+#ifdef AGI_X86
+	if (channels == 2 && level == SimdLevel::AVX2) return DownmixStereoAVX2(dst, src, count);
+	if (channels == 2 && level == SimdLevel::SSE2) return DownmixStereoSSE2(dst, src, count);
+#endif
+	Downmix(dst, src, count, channels);
+}
+}
+
+namespace agi {
+void ConvertToInt16Mono(int16_t *dst, const void *src, int64_t count, int channels, int bytes_per_sample, bool float_samples, cpu::SimdLevel level) {
+	level = std::min(level, cpu::BestSimdLevel());
+
+	if (channels == 1)
+		return ToInt16(dst, src, count, bytes_per_sample, float_samples, level);
+
+	if (bytes_per_sample == 2 && !float_samples)
+		return Downmix(dst, static_cast<const int16_t *>(src), count, channels, level);
+
+	thread_local std::vector<int16_t> interleaved;
+	interleaved.resize(count * channels);
+	ToInt16(interleaved.data(), src, count * channels, bytes_per_sample, float_samples, level);
+	Downmix(dst, interleaved.data(), count, channels, level);
+}
+}
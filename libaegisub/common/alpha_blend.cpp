@@ -0,0 +1,211 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/alpha_blend.h"
+
+#include "libaegisub/dispatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#ifdef AGI_X86
+#include <immintrin.h>
+#endif
+
+// The divisions by 255 are done as (x + 1 + (x >> 8)) >> 8, which is exact
+// for everything up to 255 * 255, so every implementation gives the same
+// result. The vector versions work on eight pixels at a time, with each
+// channel widened to 16 bits, and skip any group of eight whose mask is
+// entirely zero, which is most of them for outlined and blurred text.
+//
+// blend_masks splits the image into horizontal bands and gives each band
+// every mask which overlaps it, clipped to the band's rows. The bands don't
+// share any pixels, so they can be blended in parallel, and each one still
+// sees the masks in their original order.
+
+namespace {
+using agi::cpu::SimdLevel;
+
+/// Fewest rows worth giving a band of their own
+const int min_band_rows = 32;
+
+/// Fewest mask pixels worth splitting into bands at all, as waking up the
+/// background threads costs more than blending a few lines of text
+const size_t min_parallel_pixels = 256 * 1024;
+
+struct Colour {
+	unsigned b, g, r, opacity;
+};
+
+/// x / 255 rounded down, for x <= 255 * 255
+inline unsigned Div255(unsigned x) {
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+/// Blend pixels [x, width) of a row one at a time
+void BlendRow(const uint8_t *mask, uint8_t *dst, size_t x, size_t width, Colour c) {
+	for (; x < width; ++x) {
+		if (!mask[x]) continue;
+		const unsigned k = Div255(mask[x] * c.opacity);
+		const unsigned ck = 255 - k;
+		uint8_t *px = dst + x * 4;
+		px[0] = Div255(k * c.b + ck * px[0]);
+		px[1] = Div255(k * c.g + ck * px[1]);
+		px[2] = Div255(k * c.r + ck * px[2]);
+	}
+}
+
+/// Is the mask zero for all eight pixels starting at p?
+inline bool Transparent8(const uint8_t *p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+	return !v;
+}
+
+#ifdef AGI_X86
+AGI_TARGET("sse2")
+inline __m128i Div255SSE2(__m128i x) {
+	x = _mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8));
+	return _mm_srli_epi16(x, 8);
+}
+
+/// Blend two widened pixels, each with its k repeated in all four channels
+AGI_TARGET("sse2")
+inline __m128i BlendSSE2(__m128i px, __m128i k, __m128i colour) {
+	const __m128i ck = _mm_sub_epi16(_mm_set1_epi16(255), k);
+	return Div255SSE2(_mm_add_epi16(_mm_mullo_epi16(k, colour), _mm_mullo_epi16(ck, px)));
+}
+
+/// Blend four pixels with the k values in the low four 16-bit lanes of k
+AGI_TARGET("sse2")
+inline void Blend4SSE2(uint8_t *p, __m128i k, __m128i colour) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	const __m128i d = _mm_loadu_si128((const __m128i *)p);
+	k = _mm_unpacklo_epi16(k, k);
+	const __m128i lo = BlendSSE2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi32(k, k), colour);
+	const __m128i hi = BlendSSE2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi32(k, k), colour);
+	const __m128i out = _mm_packus_epi16(lo, hi);
+	_mm_storeu_si128((__m128i *)p, _mm_or_si128(_mm_andnot_si128(alpha, out), _mm_and_si128(alpha, d)));
+}
+
+AGI_TARGET("sse2")
+size_t BlendRowSSE2(const uint8_t *mask, uint8_t *dst, size_t width, Colour c) {
+	const __m128i colour = _mm_set_epi16(0, c.r, c.g, c.b, 0, c.r, c.g, c.b);
+	const __m128i opacity = _mm_set1_epi16(c.opacity);
+	size_t x = 0;
+	for (; x + 8 <= width; x += 8) {
+		if (Transparent8(mask + x)) continue;
+		const __m128i m = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(mask + x)), _mm_setzero_si128());
+		const __m128i k = Div255SSE2(_mm_mullo_epi16(m, opacity));
+		Blend4SSE2(dst + x * 4, k, colour);
+		Blend4SSE2(dst + x * 4 + 16, _mm_unpackhi_epi64(k, k), colour);
+	}
+	return x;
+}
+
+AGI_TARGET("avx2")
+inline __m256i Div255AVX2(__m256i x) {
+	x = _mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8));
+	return _mm256_srli_epi16(x, 8);
+}
+
+AGI_TARGET("avx2")
+inline __m256i BlendAVX2(__m256i px, __m256i k, __m256i colour) {
+	const __m256i ck = _mm256_sub_epi16(_mm256_set1_epi16(255), k);
+	return Div255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(k, colour), _mm256_mullo_epi16(ck, px)));
+}
+
+AGI_TARGET("avx2")
+size_t BlendRowAVX2(const uint8_t *mask, uint8_t *dst, size_t width, Colour c) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+	const __m256i colour = _mm256_broadcastsi128_si256(_mm_set_epi16(0, c.r, c.g, c.b, 0, c.r, c.g, c.b));
+	const __m256i opacity = _mm256_set1_epi32(c.opacity);
+	size_t x = 0;
+	for (; x + 8 <= width; x += 8) {
+		if (Transparent8(mask + x)) continue;
+		// One k per 32-bit lane, whose upper half stays zero, then copied
+		// into both halves so that unpacking gives one per channel
+		const __m256i m = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(mask + x)));
+		__m256i k = Div255AVX2(_mm256_mullo_epi16(m, opacity));
+		k = _mm256_or_si256(k, _mm256_slli_epi32(k, 16));
+
+		uint8_t *p = dst + x * 4;
+		const __m256i d = _mm256_loadu_si256((const __m256i *)p);
+		const __m256i lo = BlendAVX2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi32(k, k), colour);
+		const __m256i hi = BlendAVX2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi32(k, k), colour);
+		const __m256i out = _mm256_packus_epi16(lo, hi);
+		_mm256_storeu_si256((__m256i *)p, _mm256_or_si256(_mm256_andnot_si256(alpha, out), _mm256_and_si256(alpha, d)));
+	}
+	return x;
+}
+#endif
+}
+
+namespace agi {
+void blend_mask(const uint8_t *mask, size_t mask_stride, size_t width, size_t height,
+                uint8_t *dst, ptrdiff_t dst_pitch, uint8_t r, uint8_t g, uint8_t b, uint8_t opacity,
+                cpu::SimdLevel level) {
+	// Nothing changes if k is always zero
+	if (!opacity) return;
+
+	level = std::min(level, cpu::BestSimdLevel());
+	const Colour c{b, g, r, opacity};
+	for (size_t y = 0; y < height; ++y) {
+		const uint8_t *row = mask + y * mask_stride;
+		uint8_t *out = dst + (ptrdiff_t)y * dst_pitch;
+
+		size_t x = 0;
+#ifdef AGI_X86
+		if (level >= SimdLevel::AVX2)
+			x = BlendRowAVX2(row, out, width, c);
+		else if (level >= SimdLevel::SSE2)
+			x = BlendRowSSE2(row, out, width, c);
+#endif
+		BlendRow(row, out, x, width, c);
+	}
+}
+
+void blend_masks_rows(std::vector<alpha_mask> const& masks, uint8_t *image, ptrdiff_t pitch,
+                      int first, int last, cpu::SimdLevel level) {
+	for (auto const& m : masks) {
+		const int top = std::max(first, m.y);
+		const int bottom = std::min(last, m.y + m.height);
+		if (top >= bottom || m.width <= 0) continue;
+		blend_mask(m.bitmap + (top - m.y) * m.stride, m.stride, m.width, bottom - top,
+			image + top * pitch + m.x * 4, pitch, m.r, m.g, m.b, m.opacity, level);
+	}
+}
+
+void blend_masks(std::vector<alpha_mask> const& masks, uint8_t *image, ptrdiff_t pitch, int height) {
+	size_t pixels = 0;
+	for (auto const& m : masks)
+		pixels += (size_t)std::max(0, m.width) * std::max(0, m.height);
+
+	const int threads = std::max(1u, std::thread::hardware_concurrency());
+	const int bands = pixels < min_parallel_pixels ? 1 : std::max(1, std::min(threads, height / min_band_rows));
+	if (bands == 1)
+		return blend_masks_rows(masks, image, pitch, 0, height);
+
+	const int band_rows = (height + bands - 1) / bands;
+	dispatch::ParallelFor(bands, [&](size_t band) {
+		const int first = (int)band * band_rows;
+		blend_masks_rows(masks, image, pitch, first, std::min(height, first + band_rows));
+	});
+}
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/buffer_pool.h"
+
+#include <cstdint>
+
+namespace agi {
+void *BufferPool::NewBuffer(size_t size) {
+	// Over-allocate to make room for aligning the buffer and for a pointer
+	// to the start of the allocation just before it
+	if (size > size_t(-1) - alignment) throw std::bad_alloc();
+	auto raw = static_cast<char *>(::operator new(size + alignment));
+	auto aligned = reinterpret_cast<char *>(
+		(reinterpret_cast<uintptr_t>(raw) + sizeof(void *) + alignment - 1) & ~uintptr_t(alignment - 1));
+	reinterpret_cast<void **>(aligned)[-1] = raw;
+	return aligned;
+}
+
+void BufferPool::DeleteBuffer(void *buffer) {
+	::operator delete(static_cast<void **>(buffer)[-1]);
+}
+
+BufferPool::~BufferPool() {
+	for (auto& size_class : free_buffers) {
+		for (auto buffer : size_class.second)
+			DeleteBuffer(buffer);
+	}
+}
+
+size_t BufferPool::SizeClass(size_t size) {
+	const size_t min_size = 4096;
+	if (size <= min_size) return min_size;
+
+	// Round up to a multiple of an eighth of the largest power of two below
+	// the size, which wastes at most an eighth of the buffer
+	int bits = 0;
+	for (size_t v = size - 1; v > 1; v >>= 1) ++bits;
+	const size_t step = size_t(1) << (bits - 3);
+	return (size + step - 1) & ~(step - 1);
+}
+
+void *BufferPool::Allocate(size_t size) {
+	const size_t size_class = SizeClass(size);
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto it = free_buffers.find(size_class);
+		if (it != free_buffers.end() && !it->second.empty()) {
+			void *buffer = it->second.back();
+			it->second.pop_back();
+			pooled_size -= size_class;
+			return buffer;
+		}
+	}
+	return NewBuffer(size_class);
+}
+
+std::vector<void *> BufferPool::Trim(size_t extra, size_t keep_class) {
+	std::vector<void *> released;
+	// Sizes in use change rarely, so buffers of other sizes are less likely
+	// to be needed again
+	for (int pass = 0; pass < 2 && pooled_size + extra > max_size; ++pass) {
+		for (auto& size_class : free_buffers) {
+			if (pass == 0 && size_class.first == keep_class) continue;
+			while (!size_class.second.empty() && pooled_size + extra > max_size) {
+				released.push_back(size_class.second.back());
+				size_class.second.pop_back();
+				pooled_size -= size_class.first;
+			}
+		}
+	}
+	return released;
+}
+
+void BufferPool::Free(void *buffer, size_t size) {
+	if (!buffer) return;
+
+	const size_t size_class = SizeClass(size);
+	std::vector<void *> released;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (size_class <= max_size) {
+			released = Trim(size_class, size_class);
+			free_buffers[size_class].push_back(buffer);
+			pooled_size += size_class;
+			buffer = nullptr;
+		}
+	}
+
+	for (auto b : released)
+		DeleteBuffer(b);
+	if (buffer)
+		DeleteBuffer(buffer);
+}
+
+void BufferPool::SetMaxSize(size_t new_max_size) {
+	std::vector<void *> released;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		max_size = new_max_size;
+		released = Trim(0, 0);
+	}
+	for (auto b : released)
+		DeleteBuffer(b);
+}
+
+size_t BufferPool::GetPooledSize() {
+	std::lock_guard<std::mutex> guard(lock);
+	return pooled_size;
+}
+}
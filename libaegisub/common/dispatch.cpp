@@ -23,6 +23,7 @@
 
 #include "libaegisub/util.h"
 
+#include <algorithm>
 #include <atomic>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/strand.hpp>
@@ -142,4 +143,35 @@ std::unique_ptr<Queue> Create() {
 	return std::unique_ptr<Queue>(new SerialQueue);
 }
 
+void ParallelFor(size_t count, std::function<void (size_t)> const& fn) {
+	if (count == 0) return;
+
+	struct State {
+		std::atomic<size_t> next{0};
+		size_t done = 0;
+		std::mutex m;
+		std::condition_variable cv;
+	};
+	auto state = std::make_shared<State>();
+
+	// Helpers which start after everything has been claimed exit without
+	// touching fn, so it only needs to outlive the items which were claimed
+	auto work = [state, count, &fn] {
+		for (size_t i; (i = state->next++) < count; ) {
+			fn(i);
+			std::lock_guard<std::mutex> lock(state->m);
+			if (++state->done == count)
+				state->cv.notify_all();
+		}
+	};
+
+	const size_t threads = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+	for (size_t i = 1; i < threads; ++i)
+		Background().Async(work);
+	work();
+
+	std::unique_lock<std::mutex> lock(state->m);
+	state->cv.wait(lock, [&]{ return state->done == count; });
+}
+
 } }
@@ -0,0 +1,226 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/fft.h"
+
+#include "libaegisub/exception.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef AGI_X86
+#include <immintrin.h>
+#endif
+
+// The n real samples are packed into n/2 complex values (even samples in the
+// real parts, odd in the imaginary parts), which are transformed in place in
+// the output arrays by an iterative decimation-in-time FFT. The first two
+// passes have trivial twiddle factors and are done together as a radix-4
+// pass; the rest are radix-2 passes, vectorized across the butterflies of
+// each block once the blocks are wide enough. The spectrum of the real input
+// is then separated out of the complex result.
+
+namespace {
+using agi::cpu::SimdLevel;
+
+const double pi = 3.14159265358979323846;
+
+/// Combine pairs of blocks of size h into blocks of size 2h
+void Pass(float *re, float *im, size_t m, size_t h, const float *wr, const float *wi) {
+	for (size_t start = 0; start < m; start += 2 * h) {
+		float *ar = re + start, *ai = im + start;
+		float *br = ar + h, *bi = ai + h;
+		for (size_t k = 0; k < h; ++k) {
+			const float tr = wr[k] * br[k] - wi[k] * bi[k];
+			const float ti = wr[k] * bi[k] + wi[k] * br[k];
+			br[k] = ar[k] - tr;
+			bi[k] = ai[k] - ti;
+			ar[k] += tr;
+			ai[k] += ti;
+		}
+	}
+}
+
+#ifdef AGI_X86
+AGI_TARGET("sse2")
+void PassSSE2(float *re, float *im, size_t m, size_t h, const float *wr, const float *wi) {
+	for (size_t start = 0; start < m; start += 2 * h) {
+		float *ar = re + start, *ai = im + start;
+		float *br = ar + h, *bi = ai + h;
+		for (size_t k = 0; k < h; k += 4) {
+			const __m128 w_r = _mm_loadu_ps(wr + k), w_i = _mm_loadu_ps(wi + k);
+			const __m128 b_r = _mm_loadu_ps(br + k), b_i = _mm_loadu_ps(bi + k);
+			const __m128 a_r = _mm_loadu_ps(ar + k), a_i = _mm_loadu_ps(ai + k);
+			const __m128 tr = _mm_sub_ps(_mm_mul_ps(w_r, b_r), _mm_mul_ps(w_i, b_i));
+			const __m128 ti = _mm_add_ps(_mm_mul_ps(w_r, b_i), _mm_mul_ps(w_i, b_r));
+			_mm_storeu_ps(br + k, _mm_sub_ps(a_r, tr));
+			_mm_storeu_ps(bi + k, _mm_sub_ps(a_i, ti));
+			_mm_storeu_ps(ar + k, _mm_add_ps(a_r, tr));
+			_mm_storeu_ps(ai + k, _mm_add_ps(a_i, ti));
+		}
+	}
+}
+
+AGI_TARGET("avx2")
+void PassAVX2(float *re, float *im, size_t m, size_t h, const float *wr, const float *wi) {
+	for (size_t start = 0; start < m; start += 2 * h) {
+		float *ar = re + start, *ai = im + start;
+		float *br = ar + h, *bi = ai + h;
+		for (size_t k = 0; k < h; k += 8) {
+			const __m256 w_r = _mm256_loadu_ps(wr + k), w_i = _mm256_loadu_ps(wi + k);
+			const __m256 b_r = _mm256_loadu_ps(br + k), b_i = _mm256_loadu_ps(bi + k);
+			const __m256 a_r = _mm256_loadu_ps(ar + k), a_i = _mm256_loadu_ps(ai + k);
+			const __m256 tr = _mm256_sub_ps(_mm256_mul_ps(w_r, b_r), _mm256_mul_ps(w_i, b_i));
+			const __m256 ti = _mm256_add_ps(_mm256_mul_ps(w_r, b_i), _mm256_mul_ps(w_i, b_r));
+			_mm256_storeu_ps(br + k, _mm256_sub_ps(a_r, tr));
+			_mm256_storeu_ps(bi + k, _mm256_sub_ps(a_i, ti));
+			_mm256_storeu_ps(ar + k, _mm256_add_ps(a_r, tr));
+			_mm256_storeu_ps(ai + k, _mm256_add_ps(a_i, ti));
+		}
+	}
+}
+#endif
+
+/// The first two passes, where the twiddle factors are 1 and -i
+void Radix4Pass(float *re, float *im, size_t m) {
+	for (size_t i = 0; i < m; i += 4) {
+		const float r0 = re[i] + re[i + 1], i0 = im[i] + im[i + 1];
+		const float r1 = re[i] - re[i + 1], i1 = im[i] - im[i + 1];
+		const float r2 = re[i + 2] + re[i + 3], i2 = im[i + 2] + im[i + 3];
+		const float r3 = re[i + 2] - re[i + 3], i3 = im[i + 2] - im[i + 3];
+		re[i] = r0 + r2;
+		im[i] = i0 + i2;
+		re[i + 2] = r0 - r2;
+		im[i + 2] = i0 - i2;
+		// Multiplying by -i swaps the parts and negates the new imaginary one
+		re[i + 1] = r1 + i3;
+		im[i + 1] = i1 - r3;
+		re[i + 3] = r1 - i3;
+		im[i + 3] = i1 + r3;
+	}
+}
+}
+
+namespace agi {
+RealFFT::RealFFT(size_t n, cpu::SimdLevel level)
+: n(n)
+, level(std::min(level, cpu::BestSimdLevel()))
+{
+	if (n < 4 || (n & (n - 1)))
+		throw InternalError("FFT requires power of two input.");
+
+	const size_t m = n / 2;
+	int bits = 0;
+	while ((size_t(1) << bits) < m) ++bits;
+
+	bitrev.resize(m);
+	for (size_t i = 0; i < m; ++i) {
+		uint32_t rev = 0;
+		for (int b = 0; b < bits; ++b)
+			rev |= ((i >> b) & 1) << (bits - 1 - b);
+		bitrev[i] = rev;
+	}
+
+	twiddle_re.resize(m);
+	twiddle_im.resize(m);
+	for (size_t h = 1; h < m; h *= 2) {
+		for (size_t k = 0; k < h; ++k) {
+			twiddle_re[h + k] = (float)cos(pi * k / h);
+			twiddle_im[h + k] = (float)-sin(pi * k / h);
+		}
+	}
+
+	split_re.resize(m / 2 + 1);
+	split_im.resize(m / 2 + 1);
+	for (size_t k = 0; k <= m / 2; ++k) {
+		split_re[k] = (float)cos(2 * pi * k / n);
+		split_im[k] = (float)-sin(2 * pi * k / n);
+	}
+}
+
+void RealFFT::Transform(const float *input, float *re, float *im, const float *window) const {
+	const size_t m = n / 2;
+
+	// Pack the samples into complex values in bit-reversed order
+	if (window) {
+		for (size_t i = 0; i < m; ++i) {
+			const size_t j = bitrev[i];
+			re[i] = input[2 * j] * window[2 * j];
+			im[i] = input[2 * j + 1] * window[2 * j + 1];
+		}
+	}
+	else {
+		for (size_t i = 0; i < m; ++i) {
+			const size_t j = bitrev[i];
+			re[i] = input[2 * j];
+			im[i] = input[2 * j + 1];
+		}
+	}
+
+	// Half-size complex transform
+	size_t h = 1;
+	if (m >= 4) {
+		Radix4Pass(re, im, m);
+		h = 4;
+	}
+	for (; h < m; h *= 2) {
+		const float *wr = &twiddle_re[h], *wi = &twiddle_im[h];
+#ifdef AGI_X86
+		if (level >= SimdLevel::AVX2 && h >= 8)
+			PassAVX2(re, im, m, h, wr, wi);
+		else if (level >= SimdLevel::SSE2 && h >= 4)
+			PassSSE2(re, im, m, h, wr, wi);
+		else
+#endif
+			Pass(re, im, m, h, wr, wi);
+	}
+
+	// Separate the spectra of the even and odd samples, Fe and Fo, and combine
+	// them into the spectrum of the whole input: X[k] = Fe[k] + w^k Fo[k].
+	// Each step reads Z[k] and Z[m - k] and writes X[k] and X[m - k], so this
+	// can be done in place.
+	const float z0r = re[0], z0i = im[0];
+	re[0] = z0r + z0i;
+	im[0] = 0;
+	re[m] = z0r - z0i;
+	im[m] = 0;
+
+	for (size_t k = 1; k <= m / 2; ++k) {
+		const float ar = re[k], ai = im[k];
+		const float cr = re[m - k], ci = im[m - k];
+
+		const float er = (ar + cr) / 2, ei = (ai - ci) / 2;
+		const float or_ = (ai + ci) / 2, oi = (cr - ar) / 2;
+		const float wr = split_re[k], wi = split_im[k];
+		const float tr = wr * or_ - wi * oi;
+		const float ti = wr * oi + wi * or_;
+
+		// X[m - k] uses the conjugates of Fe[k] and Fo[k], with the twiddle
+		// factor w^(m-k) = -conj(w^k)
+		re[m - k] = er - tr;
+		im[m - k] = ti - ei;
+		re[k] = er + tr;
+		im[k] = ei + ti;
+	}
+}
+
+std::vector<float> HannWindow(size_t n) {
+	std::vector<float> window(n);
+	for (size_t i = 0; i < n; ++i)
+		window[i] = (float)(0.5 - 0.5 * cos(2 * pi * i / n));
+	return window;
+}
+}
@@ -71,6 +71,32 @@ char *map(int64_t s_offset, uint64_t length, boost::interprocess::mode_t mode,
 	return static_cast<char *>(region->get_address()) + offset - mapping_start;
 }
 
+uint64_t get_size(agi::file_mapping const& file) {
+	offset_t size = 0;
+	ipcdetail::get_file_size(file.get_mapping_handle().handle, size);
+	return static_cast<uint64_t>(size);
+}
+
+void resize(agi::file_mapping const& file, agi::fs::path const& filename, uint64_t size) {
+	auto handle = file.get_mapping_handle().handle;
+#ifdef _WIN32
+	LARGE_INTEGER li;
+	li.QuadPart = size;
+	SetFilePointerEx(handle, li, nullptr, FILE_BEGIN);
+	SetEndOfFile(handle);
+#else
+	if (ftruncate(handle, size) == -1) {
+		switch (errno) {
+		case EBADF:  throw agi::InternalError("Error opening file " + filename.string() + " not handled");
+		case EFBIG:  throw agi::fs::DriveFull(filename);
+		case EINVAL: throw agi::InternalError("File opened incorrectly: " + filename.string());
+		case EROFS:  throw agi::fs::WriteDenied(filename);
+		default: throw agi::fs::FileSystemUnknownError("Unknown error opening file: " + filename.string());
+		}
+	}
+#endif
+}
+
 }
 
 namespace agi {
@@ -124,10 +150,8 @@ file_mapping::~file_mapping() {
 
 read_file_mapping::read_file_mapping(fs::path const& filename)
 : file(filename, false)
+, file_size(get_size(file))
 {
-	offset_t size = 0;
-	ipcdetail::get_file_size(file.get_mapping_handle().handle, size);
-	file_size = static_cast<uint64_t>(size);
 }
 
 read_file_mapping::~read_file_mapping() { }
@@ -144,24 +168,10 @@ temp_file_mapping::temp_file_mapping(fs::path const& filename, uint64_t size)
 : file(filename, true)
 , file_size(size)
 {
-	auto handle = file.get_mapping_handle().handle;
-#ifdef _WIN32
-	LARGE_INTEGER li;
-	li.QuadPart = size;
-	SetFilePointerEx(handle, li, nullptr, FILE_BEGIN);
-	SetEndOfFile(handle);
-#else
+#ifndef _WIN32
 	unlink(filename.string().c_str());
-	if (ftruncate(handle, size) == -1) {
-		switch (errno) {
-		case EBADF:  throw InternalError("Error opening file " + filename.string() + " not handled");
-		case EFBIG:  throw fs::DriveFull(filename);
-		case EINVAL: throw InternalError("File opened incorrectly: " + filename.string());
-		case EROFS:  throw fs::WriteDenied(filename);
-		default: throw fs::FileSystemUnknownError("Unknown error opening file: " + filename.string());
-		}
-	}
 #endif
+	resize(file, filename, size);
 }
 
 temp_file_mapping::~temp_file_mapping() { }
@@ -173,4 +183,23 @@ const char *temp_file_mapping::read(int64_t offset, uint64_t length) {
 char *temp_file_mapping::write(int64_t offset, uint64_t length) {
 	return map(offset, length, read_write, file_size, file, write_region, write_mapping_start);
 }
+
+persistent_file_mapping::persistent_file_mapping(fs::path const& filename, uint64_t size)
+: file(filename, true)
+, file_size(size)
+, existing_size(get_size(file))
+{
+	if (existing_size != size)
+		resize(file, filename, size);
+}
+
+persistent_file_mapping::~persistent_file_mapping() { }
+
+const char *persistent_file_mapping::read(int64_t offset, uint64_t length) {
+	return map(offset, length, read_only, file_size, file, read_region, read_mapping_start);
+}
+
+char *persistent_file_mapping::write(int64_t offset, uint64_t length) {
+	return map(offset, length, read_write, file_size, file, write_region, write_mapping_start);
+}
 }
@@ -0,0 +1,266 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/image_transform.h"
+
+#include "libaegisub/exception.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef AGI_X86
+#include <immintrin.h>
+#endif
+
+// Without a transpose, each output row is one source row, copied either as
+// is or with its pixels reversed. With one, the output is written in square
+// tiles small enough that the source rows they read stay in cache, and each
+// tile is transposed a 4x4 (SSE2) or 8x8 (AVX2) block of pixels at a time,
+// with source rows read in reverse order for flip_y and each loaded group of
+// pixels reversed for flip_x.
+
+namespace {
+using agi::cpu::SimdLevel;
+
+/// Width and height of the tiles, in pixels
+const size_t tile_size = 32;
+
+inline uint32_t LoadPixel(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+inline void StorePixel(uint8_t *p, uint32_t v) {
+	memcpy(p, &v, 4);
+}
+
+/// Source coordinates for the output rows and columns of a transposed image
+struct Mirror {
+	size_t size;
+	bool flip;
+	size_t operator()(size_t i) const { return flip ? size - 1 - i : i; }
+};
+
+/// Reverse the order of the pixels in a row
+size_t ReverseRow(const uint8_t *src, uint8_t *dst, size_t width, size_t x) {
+	for (; x < width; ++x)
+		StorePixel(dst + x * 4, LoadPixel(src + (width - 1 - x) * 4));
+	return x;
+}
+
+/// Transpose the output rectangle [x0, x1) x [y0, y1) a pixel at a time
+void TransposeRect(const uint8_t *src, size_t src_pitch, uint8_t *dst, size_t dst_pitch,
+                   Mirror sx, Mirror sy, size_t x0, size_t x1, size_t y0, size_t y1) {
+	for (size_t y = y0; y < y1; ++y) {
+		const uint8_t *col = src + sx(y) * 4;
+		uint8_t *out = dst + y * dst_pitch;
+		for (size_t x = x0; x < x1; ++x)
+			StorePixel(out + x * 4, LoadPixel(col + sy(x) * src_pitch));
+	}
+}
+
+#ifdef AGI_X86
+AGI_TARGET("sse2")
+size_t ReverseRowSSE2(const uint8_t *src, uint8_t *dst, size_t width) {
+	size_t x = 0;
+	for (; x + 4 <= width; x += 4) {
+		const __m128i v = _mm_loadu_si128((const __m128i *)(src + (width - 4 - x) * 4));
+		_mm_storeu_si128((__m128i *)(dst + x * 4), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+	}
+	return x;
+}
+
+AGI_TARGET("avx2")
+size_t ReverseRowAVX2(const uint8_t *src, uint8_t *dst, size_t width) {
+	const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	size_t x = 0;
+	for (; x + 8 <= width; x += 8) {
+		const __m256i v = _mm256_loadu_si256((const __m256i *)(src + (width - 8 - x) * 4));
+		_mm256_storeu_si256((__m256i *)(dst + x * 4), _mm256_permutevar8x32_epi32(v, reverse));
+	}
+	return x;
+}
+
+/// Transpose the output rectangle [x0, x1) x [y0, y1) in 4x4 blocks,
+/// returning the first row not done
+template<bool FlipX>
+AGI_TARGET("sse2")
+size_t TileSSE2(const uint8_t *src, size_t src_pitch, uint8_t *dst, size_t dst_pitch,
+                Mirror sx, Mirror sy, size_t x0, size_t x1, size_t y0, size_t y1) {
+	size_t y = y0;
+	for (; y + 4 <= y1; y += 4) {
+		// Row k of each block is the source row for output column x + k, and
+		// holds the pixels for output rows y to y + 3
+		const uint8_t *col = src + (FlipX ? sx(y + 3) : sx(y)) * 4;
+		uint8_t *out = dst + y * dst_pitch;
+		size_t x = x0;
+		for (; x + 4 <= x1; x += 4) {
+			__m128i r0 = _mm_loadu_si128((const __m128i *)(col + sy(x) * src_pitch));
+			__m128i r1 = _mm_loadu_si128((const __m128i *)(col + sy(x + 1) * src_pitch));
+			__m128i r2 = _mm_loadu_si128((const __m128i *)(col + sy(x + 2) * src_pitch));
+			__m128i r3 = _mm_loadu_si128((const __m128i *)(col + sy(x + 3) * src_pitch));
+			if (FlipX) {
+				r0 = _mm_shuffle_epi32(r0, _MM_SHUFFLE(0, 1, 2, 3));
+				r1 = _mm_shuffle_epi32(r1, _MM_SHUFFLE(0, 1, 2, 3));
+				r2 = _mm_shuffle_epi32(r2, _MM_SHUFFLE(0, 1, 2, 3));
+				r3 = _mm_shuffle_epi32(r3, _MM_SHUFFLE(0, 1, 2, 3));
+			}
+
+			const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+			const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+			const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+			const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+			uint8_t *p = out + x * 4;
+			_mm_storeu_si128((__m128i *)p, _mm_unpacklo_epi64(t0, t1));
+			_mm_storeu_si128((__m128i *)(p + dst_pitch), _mm_unpackhi_epi64(t0, t1));
+			_mm_storeu_si128((__m128i *)(p + dst_pitch * 2), _mm_unpacklo_epi64(t2, t3));
+			_mm_storeu_si128((__m128i *)(p + dst_pitch * 3), _mm_unpackhi_epi64(t2, t3));
+		}
+		TransposeRect(src, src_pitch, dst, dst_pitch, sx, sy, x, x1, y, y + 4);
+	}
+	return y;
+}
+
+AGI_TARGET("avx2")
+inline __m256i LoadAVX2(const uint8_t *p, bool flip) {
+	const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+	return flip ? _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)) : v;
+}
+
+/// Transpose the output rectangle [x0, x1) x [y0, y1) in 8x8 blocks,
+/// returning the first row not done
+template<bool FlipX>
+AGI_TARGET("avx2")
+size_t TileAVX2(const uint8_t *src, size_t src_pitch, uint8_t *dst, size_t dst_pitch,
+                Mirror sx, Mirror sy, size_t x0, size_t x1, size_t y0, size_t y1) {
+	size_t y = y0;
+	for (; y + 8 <= y1; y += 8) {
+		const uint8_t *col = src + (FlipX ? sx(y + 7) : sx(y)) * 4;
+		uint8_t *out = dst + y * dst_pitch;
+		size_t x = x0;
+		for (; x + 8 <= x1; x += 8) {
+			const __m256i r0 = LoadAVX2(col + sy(x) * src_pitch, FlipX);
+			const __m256i r1 = LoadAVX2(col + sy(x + 1) * src_pitch, FlipX);
+			const __m256i r2 = LoadAVX2(col + sy(x + 2) * src_pitch, FlipX);
+			const __m256i r3 = LoadAVX2(col + sy(x + 3) * src_pitch, FlipX);
+			const __m256i r4 = LoadAVX2(col + sy(x + 4) * src_pitch, FlipX);
+			const __m256i r5 = LoadAVX2(col + sy(x + 5) * src_pitch, FlipX);
+			const __m256i r6 = LoadAVX2(col + sy(x + 6) * src_pitch, FlipX);
+			const __m256i r7 = LoadAVX2(col + sy(x + 7) * src_pitch, FlipX);
+
+			// Transpose the 4x4 blocks within each lane, then swap the
+			// off-diagonal blocks between the lanes
+			const __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+			const __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+			const __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+			const __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+			const __m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+			const __m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+			const __m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+			const __m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+			const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+			const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+			const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+			const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+			const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+			const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+			const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+			const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+			uint8_t *p = out + x * 4;
+			_mm256_storeu_si256((__m256i *)p, _mm256_permute2x128_si256(u0, u4, 0x20));
+			_mm256_storeu_si256((__m256i *)(p + dst_pitch), _mm256_permute2x128_si256(u1, u5, 0x20));
+			_mm256_storeu_si256((__m256i *)(p + dst_pitch * 2), _mm256_permute2x128_si256(u2, u6, 0x20));
+			_mm256_storeu_si256((__m256i *)(p + dst_pitch * 3), _mm256_permute2x128_si256(u3, u7, 0x20));
+			_mm256_storeu_si256((__m256i *)(p + dst_pitch * 4), _mm256_permute2x128_si256(u0, u4, 0x31));
+			_mm256_storeu_si256((__m256i *)(p + dst_pitch * 5), _mm256_permute2x128_si256(u1, u5, 0x31));
+			_mm256_storeu_si256((__m256i *)(p + dst_pitch * 6), _mm256_permute2x128_si256(u2, u6, 0x31));
+			_mm256_storeu_si256((__m256i *)(p + dst_pitch * 7), _mm256_permute2x128_si256(u3, u7, 0x31));
+		}
+		TransposeRect(src, src_pitch, dst, dst_pitch, sx, sy, x, x1, y, y + 8);
+	}
+	return y;
+}
+#endif
+
+typedef size_t (*TransposeTile)(const uint8_t *, size_t, uint8_t *, size_t, Mirror, Mirror, size_t, size_t, size_t, size_t);
+
+void Transpose(const uint8_t *src, size_t src_pitch, size_t width, size_t height,
+               uint8_t *dst, size_t dst_pitch, agi::image_transform t, SimdLevel level) {
+	const size_t out_w = height, out_h = width;
+	const Mirror sx{width, t.flip_x}, sy{height, t.flip_y};
+
+	TransposeTile tile = nullptr;
+#ifdef AGI_X86
+	if (level >= SimdLevel::AVX2)
+		tile = t.flip_x ? TileAVX2<true> : TileAVX2<false>;
+	else if (level >= SimdLevel::SSE2)
+		tile = t.flip_x ? TileSSE2<true> : TileSSE2<false>;
+#endif
+
+	for (size_t ty = 0; ty < out_h; ty += tile_size) {
+		const size_t y_end = std::min(ty + tile_size, out_h);
+		for (size_t tx = 0; tx < out_w; tx += tile_size) {
+			const size_t x_end = std::min(tx + tile_size, out_w);
+			const size_t y = tile ? tile(src, src_pitch, dst, dst_pitch, sx, sy, tx, x_end, ty, y_end) : ty;
+			TransposeRect(src, src_pitch, dst, dst_pitch, sx, sy, tx, x_end, y, y_end);
+		}
+	}
+}
+}
+
+namespace agi {
+image_transform image_transform::rotation(int degrees) {
+	image_transform t;
+	switch ((degrees % 360 + 360) % 360) {
+		case 0: break;
+		case 90:  t.transpose = true; t.flip_y = true; break;
+		case 180: t.flip_x = true;    t.flip_y = true; break;
+		case 270: t.transpose = true; t.flip_x = true; break;
+		default: throw InternalError("Rotation must be a multiple of 90 degrees");
+	}
+	return t;
+}
+
+void transform_bgra(const uint8_t *src, size_t src_pitch, size_t width, size_t height,
+                    uint8_t *dst, size_t dst_pitch, image_transform t, cpu::SimdLevel level) {
+	level = std::min(level, cpu::BestSimdLevel());
+
+	if (t.transpose) {
+		Transpose(src, src_pitch, width, height, dst, dst_pitch, t, level);
+		return;
+	}
+
+	for (size_t y = 0; y < height; ++y) {
+		const uint8_t *row = src + (t.flip_y ? height - 1 - y : y) * src_pitch;
+		uint8_t *out = dst + y * dst_pitch;
+		if (!t.flip_x) {
+			memcpy(out, row, width * 4);
+			continue;
+		}
+
+		size_t x = 0;
+#ifdef AGI_X86
+		if (level >= SimdLevel::AVX2)
+			x = ReverseRowAVX2(row, out, width);
+		else if (level >= SimdLevel::SSE2)
+			x = ReverseRowSSE2(row, out, width);
+#endif
+		ReverseRow(row, out, width, x);
+	}
+}
+}
@@ -0,0 +1,361 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/ycbcr_conv.h"
+
+#include "libaegisub/dispatch.h"
+#include "libaegisub/exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#ifdef AGI_X86
+#include <immintrin.h>
+#endif
+
+// Each output channel is a weighted sum of at most two of the input samples
+// plus a constant: R = y*Y + r_cr*Cr + r_k, and so on. The weights are
+// scaled by 2^13 so that they fit in 16 bits and samples of up to 14 bits
+// can be multiplied by them in pairs with pmaddwd without overflowing, and
+// the constants fold in the range offsets and the rounding. Deeper samples
+// are shifted down to 14 bits first, which is still far more precision than
+// the 8-bit output needs.
+
+namespace {
+using agi::cpu::SimdLevel;
+using coefficients = agi::ycbcr_planar_converter::coefficients;
+
+const int weight_bits = 13;
+const int max_depth = 14;
+
+/// Convert rows in groups of at least this many when converting in parallel
+const int min_band_rows = 16;
+
+inline uint16_t Load16(const uint8_t *p) {
+	uint16_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+inline int32_t Load32(const uint8_t *p) {
+	int32_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+inline uint8_t Clamp(int v) {
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+template<bool Wide>
+inline int Sample(const uint8_t *row, int i, int in_shift) {
+	return Wide ? Load16(row + i * 2) >> in_shift : row[i];
+}
+
+/// Convert pixels [x, width) of a row
+template<bool Wide>
+void Row(coefficients const& c, int shift_x, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dst, int x, int width) {
+	for (; x < width; ++x) {
+		const int Y = Sample<Wide>(y, x, c.in_shift);
+		const int Cb = cb ? Sample<Wide>(cb, x >> shift_x, c.in_shift) : c.neutral;
+		const int Cr = cr ? Sample<Wide>(cr, x >> shift_x, c.in_shift) : c.neutral;
+		dst[x * 4 + 0] = Clamp((c.y * Y + c.b_cb * Cb + c.b_k) >> c.shift);
+		dst[x * 4 + 1] = Clamp((c.y * Y + c.g_cb * Cb + c.g_cr * Cr + c.g_k) >> c.shift);
+		dst[x * 4 + 2] = Clamp((c.y * Y + c.r_cr * Cr + c.r_k) >> c.shift);
+		dst[x * 4 + 3] = 0;
+	}
+}
+
+/// Convert as many pixels of a row as can be done with vectors
+/// @return Number of pixels converted
+typedef int (*VectorRow)(coefficients const& c, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dst, int width);
+
+/// Two 16-bit weights packed for pmaddwd, with lo applied to the even lanes
+inline int32_t Pair(int16_t lo, int16_t hi) {
+	return (int32_t)(((uint32_t)(uint16_t)hi << 16) | (uint16_t)lo);
+}
+
+#ifdef AGI_X86
+/// Load the samples of one plane for eight pixels starting at x as 16-bit
+/// values, repeating each subsampled chroma sample for each pixel it covers
+template<bool Wide, int ShiftX>
+AGI_TARGET("sse2")
+__m128i LoadSSE2(const uint8_t *row, int x, __m128i in_shift) {
+	const uint8_t *p = row + (x >> ShiftX) * (Wide ? 2 : 1);
+	__m128i v;
+	if (Wide) {
+		if (ShiftX == 0) v = _mm_loadu_si128((const __m128i *)p);
+		else if (ShiftX == 1) v = _mm_loadl_epi64((const __m128i *)p);
+		else v = _mm_cvtsi32_si128(Load32(p));
+		v = _mm_srl_epi16(v, in_shift);
+	}
+	else {
+		if (ShiftX == 0) v = _mm_loadl_epi64((const __m128i *)p);
+		else if (ShiftX == 1) v = _mm_cvtsi32_si128(Load32(p));
+		else v = _mm_cvtsi32_si128(Load16(p));
+		v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+	}
+	if (ShiftX >= 1) v = _mm_unpacklo_epi16(v, v);
+	if (ShiftX >= 2) v = _mm_unpacklo_epi32(v, v);
+	return v;
+}
+
+/// Add the constant to the weighted sums and scale them down to 8 bits
+AGI_TARGET("sse2")
+inline __m128i SumSSE2(__m128i shift, __m128i sums, __m128i k) {
+	return _mm_sra_epi32(_mm_add_epi32(sums, k), shift);
+}
+
+/// ShiftX is negative for greyscale images
+template<bool Wide, int ShiftX>
+AGI_TARGET("sse2")
+int RowSSE2(coefficients const& c, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dst, int width) {
+	const __m128i in_shift = _mm_cvtsi32_si128(c.in_shift);
+	const __m128i shift = _mm_cvtsi32_si128(c.shift);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i neutral = _mm_set1_epi16(c.neutral);
+	const __m128i r_w = _mm_set1_epi32(Pair(c.y, c.r_cr));
+	const __m128i g_w1 = _mm_set1_epi32(Pair(c.y, c.g_cb));
+	const __m128i g_w2 = _mm_set1_epi32(Pair(0, c.g_cr));
+	const __m128i b_w = _mm_set1_epi32(Pair(c.y, c.b_cb));
+	const __m128i r_k = _mm_set1_epi32(c.r_k);
+	const __m128i g_k = _mm_set1_epi32(c.g_k);
+	const __m128i b_k = _mm_set1_epi32(c.b_k);
+
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		const __m128i Y = LoadSSE2<Wide, 0>(y, x, in_shift);
+		const __m128i Cb = ShiftX < 0 ? neutral : LoadSSE2<Wide, (ShiftX < 0 ? 0 : ShiftX)>(cb, x, in_shift);
+		const __m128i Cr = ShiftX < 0 ? neutral : LoadSSE2<Wide, (ShiftX < 0 ? 0 : ShiftX)>(cr, x, in_shift);
+
+		const __m128i ycb_lo = _mm_unpacklo_epi16(Y, Cb), ycb_hi = _mm_unpackhi_epi16(Y, Cb);
+		const __m128i ycr_lo = _mm_unpacklo_epi16(Y, Cr), ycr_hi = _mm_unpackhi_epi16(Y, Cr);
+
+		const __m128i R = _mm_packs_epi32(
+			SumSSE2(shift, _mm_madd_epi16(ycr_lo, r_w), r_k),
+			SumSSE2(shift, _mm_madd_epi16(ycr_hi, r_w), r_k));
+		const __m128i G = _mm_packs_epi32(
+			SumSSE2(shift, _mm_add_epi32(_mm_madd_epi16(ycb_lo, g_w1), _mm_madd_epi16(ycr_lo, g_w2)), g_k),
+			SumSSE2(shift, _mm_add_epi32(_mm_madd_epi16(ycb_hi, g_w1), _mm_madd_epi16(ycr_hi, g_w2)), g_k));
+		const __m128i B = _mm_packs_epi32(
+			SumSSE2(shift, _mm_madd_epi16(ycb_lo, b_w), b_k),
+			SumSSE2(shift, _mm_madd_epi16(ycb_hi, b_w), b_k));
+
+		// Interleave into BGRA, saturating to 0-255 on the way
+		const __m128i br = _mm_packus_epi16(B, R);
+		const __m128i g0 = _mm_packus_epi16(G, zero);
+		const __m128i bg = _mm_unpacklo_epi8(br, g0);
+		const __m128i r0 = _mm_unpackhi_epi8(br, g0);
+		_mm_storeu_si128((__m128i *)(dst + x * 4), _mm_unpacklo_epi16(bg, r0));
+		_mm_storeu_si128((__m128i *)(dst + x * 4 + 16), _mm_unpackhi_epi16(bg, r0));
+	}
+	return x;
+}
+
+/// Sixteen pixel version of LoadSSE2
+template<bool Wide, int ShiftX>
+AGI_TARGET("avx2")
+__m256i LoadAVX2(const uint8_t *row, int x, __m128i in_shift) {
+	const uint8_t *p = row + (x >> ShiftX) * (Wide ? 2 : 1);
+	if (Wide) {
+		__m256i v;
+		if (ShiftX == 0)
+			v = _mm256_loadu_si256((const __m256i *)p);
+		else {
+			__m128i lo, hi;
+			if (ShiftX == 1) {
+				const __m128i s = _mm_loadu_si128((const __m128i *)p);
+				lo = _mm_unpacklo_epi16(s, s);
+				hi = _mm_unpackhi_epi16(s, s);
+			}
+			else {
+				__m128i s = _mm_loadl_epi64((const __m128i *)p);
+				s = _mm_unpacklo_epi16(s, s);
+				lo = _mm_unpacklo_epi32(s, s);
+				hi = _mm_unpackhi_epi32(s, s);
+			}
+			v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+		}
+		return _mm256_srl_epi16(v, in_shift);
+	}
+
+	__m128i s;
+	if (ShiftX == 0)
+		s = _mm_loadu_si128((const __m128i *)p);
+	else if (ShiftX == 1) {
+		s = _mm_loadl_epi64((const __m128i *)p);
+		s = _mm_unpacklo_epi8(s, s);
+	}
+	else {
+		s = _mm_cvtsi32_si128(Load32(p));
+		s = _mm_unpacklo_epi8(s, s);
+		s = _mm_unpacklo_epi16(s, s);
+	}
+	return _mm256_cvtepu8_epi16(s);
+}
+
+AGI_TARGET("avx2")
+inline __m256i SumAVX2(__m128i shift, __m256i sums, __m256i k) {
+	return _mm256_sra_epi32(_mm256_add_epi32(sums, k), shift);
+}
+
+template<bool Wide, int ShiftX>
+AGI_TARGET("avx2")
+int RowAVX2(coefficients const& c, const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dst, int width) {
+	const __m128i in_shift = _mm_cvtsi32_si128(c.in_shift);
+	const __m128i shift = _mm_cvtsi32_si128(c.shift);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i neutral = _mm256_set1_epi16(c.neutral);
+	const __m256i r_w = _mm256_set1_epi32(Pair(c.y, c.r_cr));
+	const __m256i g_w1 = _mm256_set1_epi32(Pair(c.y, c.g_cb));
+	const __m256i g_w2 = _mm256_set1_epi32(Pair(0, c.g_cr));
+	const __m256i b_w = _mm256_set1_epi32(Pair(c.y, c.b_cb));
+	const __m256i r_k = _mm256_set1_epi32(c.r_k);
+	const __m256i g_k = _mm256_set1_epi32(c.g_k);
+	const __m256i b_k = _mm256_set1_epi32(c.b_k);
+
+	// The unpacks and packs work within each 128-bit lane, so the pixels stay
+	// in order until the final interleave, where lane 0 holds pixels 0-3 and
+	// 4-7 and lane 1 holds pixels 8-11 and 12-15
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		const __m256i Y = LoadAVX2<Wide, 0>(y, x, in_shift);
+		const __m256i Cb = ShiftX < 0 ? neutral : LoadAVX2<Wide, (ShiftX < 0 ? 0 : ShiftX)>(cb, x, in_shift);
+		const __m256i Cr = ShiftX < 0 ? neutral : LoadAVX2<Wide, (ShiftX < 0 ? 0 : ShiftX)>(cr, x, in_shift);
+
+		const __m256i ycb_lo = _mm256_unpacklo_epi16(Y, Cb), ycb_hi = _mm256_unpackhi_epi16(Y, Cb);
+		const __m256i ycr_lo = _mm256_unpacklo_epi16(Y, Cr), ycr_hi = _mm256_unpackhi_epi16(Y, Cr);
+
+		const __m256i R = _mm256_packs_epi32(
+			SumAVX2(shift, _mm256_madd_epi16(ycr_lo, r_w), r_k),
+			SumAVX2(shift, _mm256_madd_epi16(ycr_hi, r_w), r_k));
+		const __m256i G = _mm256_packs_epi32(
+			SumAVX2(shift, _mm256_add_epi32(_mm256_madd_epi16(ycb_lo, g_w1), _mm256_madd_epi16(ycr_lo, g_w2)), g_k),
+			SumAVX2(shift, _mm256_add_epi32(_mm256_madd_epi16(ycb_hi, g_w1), _mm256_madd_epi16(ycr_hi, g_w2)), g_k));
+		const __m256i B = _mm256_packs_epi32(
+			SumAVX2(shift, _mm256_madd_epi16(ycb_lo, b_w), b_k),
+			SumAVX2(shift, _mm256_madd_epi16(ycb_hi, b_w), b_k));
+
+		const __m256i br = _mm256_packus_epi16(B, R);
+		const __m256i g0 = _mm256_packus_epi16(G, zero);
+		const __m256i bg = _mm256_unpacklo_epi8(br, g0);
+		const __m256i r0 = _mm256_unpackhi_epi8(br, g0);
+		const __m256i lo = _mm256_unpacklo_epi16(bg, r0);
+		const __m256i hi = _mm256_unpackhi_epi16(bg, r0);
+		_mm256_storeu_si256((__m256i *)(dst + x * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst + x * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	return x;
+}
+
+template<bool Wide>
+VectorRow PickRow(SimdLevel level, int shift_x) {
+	if (level >= SimdLevel::AVX2) {
+		switch (shift_x) {
+			case 0: return RowAVX2<Wide, 0>;
+			case 1: return RowAVX2<Wide, 1>;
+			case 2: return RowAVX2<Wide, 2>;
+			default: return RowAVX2<Wide, -1>;
+		}
+	}
+	if (level >= SimdLevel::SSE2) {
+		switch (shift_x) {
+			case 0: return RowSSE2<Wide, 0>;
+			case 1: return RowSSE2<Wide, 1>;
+			case 2: return RowSSE2<Wide, 2>;
+			default: return RowSSE2<Wide, -1>;
+		}
+	}
+	return nullptr;
+}
+#endif
+}
+
+namespace agi {
+ycbcr_planar_converter::ycbcr_planar_converter(ycbcr_matrix mat, ycbcr_range range, int bit_depth, cpu::SimdLevel level)
+: level(std::min(level, cpu::BestSimdLevel()))
+{
+	if (bit_depth < 8 || bit_depth > 16)
+		throw InternalError("Unsupported YCbCr bit depth");
+
+	// Reuse the matrix of the floating-point converter, which works with
+	// 8-bit samples
+	ycbcr_converter conv(mat, range);
+	auto const& m = conv.from_ycbcr;
+	auto const& offset = conv.shift_from;
+
+	const int depth = std::min(bit_depth, max_depth);
+	c.in_shift = bit_depth - depth;
+	c.shift = weight_bits + depth - 8;
+	c.neutral = 128 << (depth - 8);
+	c.wide = bit_depth > 8;
+
+	auto weight = [](double v) { return (int16_t)std::lround(v * (1 << weight_bits)); };
+	c.y = weight(m[0]);
+	c.r_cr = weight(m[2]);
+	c.g_cb = weight(m[4]);
+	c.g_cr = weight(m[5]);
+	c.b_cb = weight(m[7]);
+
+	auto constant = [&](int row) {
+		double sum = 0;
+		for (int i = 0; i < 3; ++i)
+			sum += m[row * 3 + i] * offset[i];
+		return (int32_t)std::lround(sum * (1 << c.shift)) + (1 << (c.shift - 1));
+	};
+	c.r_k = constant(0);
+	c.g_k = constant(1);
+	c.b_k = constant(2);
+}
+
+void ycbcr_planar_converter::convert_rows(ycbcr_planes const& src, int width, int first, int last, uint8_t *dst, size_t dst_stride) const {
+	const bool wide = c.wide;
+	const int shift_x = src.cb && src.cr ? src.chroma_shift_x : -1;
+
+	VectorRow vector_row = nullptr;
+#ifdef AGI_X86
+	vector_row = wide ? PickRow<true>(level, shift_x) : PickRow<false>(level, shift_x);
+#endif
+
+	for (int row = first; row < last; ++row) {
+		const uint8_t *y = src.y + row * src.y_stride;
+		const uint8_t *cb = nullptr, *cr = nullptr;
+		if (shift_x >= 0) {
+			cb = src.cb + (row >> src.chroma_shift_y) * src.c_stride;
+			cr = src.cr + (row >> src.chroma_shift_y) * src.c_stride;
+		}
+		uint8_t *out = dst + row * dst_stride;
+
+		const int x = vector_row ? vector_row(c, y, cb, cr, out, width) : 0;
+		if (wide)
+			Row<true>(c, shift_x, y, cb, cr, out, x, width);
+		else
+			Row<false>(c, shift_x, y, cb, cr, out, x, width);
+	}
+}
+
+void ycbcr_planar_converter::convert(ycbcr_planes const& src, int width, int height, uint8_t *dst, size_t dst_stride) const {
+	const int threads = std::max(1u, std::thread::hardware_concurrency());
+	const int bands = std::max(1, std::min(threads, height / min_band_rows));
+	const int band_rows = (height + bands - 1) / bands;
+	dispatch::ParallelFor(bands, [&](size_t band) {
+		const int first = (int)band * band_rows;
+		convert_rows(src, width, first, std::min(height, first + band_rows), dst, dst_stride);
+	});
+}
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/cpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace agi {
+/// Blend a single colour into part of a 32-bit BGRA image through a
+/// coverage mask, as used for the images libass renders
+///
+/// Each colour channel becomes (k * colour + (255 - k) * old) / 255, where
+/// k = mask * opacity / 255 and both divisions round down. Spans where the
+/// mask is zero are skipped without touching the image, and the fourth byte
+/// of each pixel is always left as it is.
+/// @param mask First row of the mask, one byte per pixel
+/// @param mask_stride Bytes from the start of one mask row to the next
+/// @param width Width of the mask in pixels
+/// @param height Height of the mask in pixels
+/// @param dst Pixel of the image under the top left of the mask
+/// @param dst_pitch Bytes from one image row to the next, which is negative
+///                  for images stored bottom to top
+/// @param r Red component of the colour
+/// @param g Green component of the colour
+/// @param b Blue component of the colour
+/// @param opacity Opacity of the colour, with 255 being fully opaque
+/// @param level Best instruction set to use, for comparing implementations
+void blend_mask(const uint8_t *mask, size_t mask_stride, size_t width, size_t height,
+                uint8_t *dst, ptrdiff_t dst_pitch, uint8_t r, uint8_t g, uint8_t b, uint8_t opacity,
+                cpu::SimdLevel level = cpu::BestSimdLevel());
+
+/// A coverage mask and colour to be blended by blend_masks
+struct alpha_mask {
+	const uint8_t *bitmap; ///< First row of the mask, one byte per pixel
+	size_t stride;         ///< Bytes from the start of one mask row to the next
+	int width;             ///< Width of the mask in pixels
+	int height;            ///< Height of the mask in pixels
+	int x;                 ///< Image column under the left edge of the mask
+	int y;                 ///< Image row under the top edge of the mask
+	uint8_t r, g, b, opacity;
+};
+
+/// Blend the parts of a list of masks which lie in rows [first, last) of an
+/// image, in order, with blend_mask
+/// @param masks Masks to blend, which must lie entirely within the image
+/// @param image First row of the image
+/// @param pitch Bytes from one image row to the next, which is negative for
+///              images stored bottom to top
+/// @param first First row to blend into
+/// @param last One past the last row to blend into
+/// @param level Best instruction set to use, for comparing implementations
+void blend_masks_rows(std::vector<alpha_mask> const& masks, uint8_t *image, ptrdiff_t pitch,
+                      int first, int last, cpu::SimdLevel level = cpu::BestSimdLevel());
+
+/// Blend a list of masks into a whole image, with bands of rows blended in
+/// parallel. Each band still gets the masks in order, so the result is the
+/// same as blending them one after another.
+void blend_masks(std::vector<alpha_mask> const& masks, uint8_t *image, ptrdiff_t pitch, int height);
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/ass/time.h>
+#include <libaegisub/split.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace agi { namespace ass {
+/// The fields of a Dialogue or Comment line of an ASS file
+///
+/// The strings point into the line which was parsed, so it has to outlive
+/// this. Reusing one EventLine for many lines also reuses the memory for the
+/// extradata IDs.
+struct EventLine {
+	bool comment = false;
+	int layer = 0;
+	Time start;
+	Time end;
+	StringRange style;
+	StringRange actor;
+	/// Left, right and vertical margins
+	std::array<int, 3> margin = std::array<int, 3>{{0, 0, 0}};
+	StringRange effect;
+	/// IDs from a {=1=2...} block at the start of the text, if there was one
+	std::vector<uint32_t> extradata_ids;
+	/// Text with the extradata block removed
+	StringRange text;
+};
+
+/// Parse a Dialogue or Comment line in a single pass without allocating
+/// @param line Line to parse, without the trailing newline
+/// @param[out] out Parsed fields
+/// @return false if the line isn't a valid event line
+///
+/// SSA's Marked= field in place of the layer is read as layer 0.
+bool ParseEventLine(std::string const& line, EventLine &out);
+/// The fields would point into a temporary
+bool ParseEventLine(std::string&& line, EventLine &out) = delete;
+} }
@@ -26,6 +26,7 @@ class Time {
 public:
 	Time(int ms = 0);
 	Time(std::string const& text);
+	Time(const char *begin, const char *end);
 
 	/// Get millisecond, rounded to centisecond precision
 	// Always round up for 5ms because the range is [start, stop)
@@ -0,0 +1,129 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/fs_fwd.h>
+
+#include <boost/filesystem/path.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace agi {
+class AudioProvider;
+
+/// Summary of the levels in a range of samples of the 16-bit mono audio
+struct AudioPeak {
+	/// Lowest sample, or 0 if there were no negative samples
+	int16_t min = 0;
+	/// Highest sample, or 0 if there were no positive samples
+	int16_t max = 0;
+	/// Sum of the negative samples divided by the total number of samples
+	int16_t avg_min = 0;
+	/// Sum of the positive samples divided by the total number of samples
+	int16_t avg_max = 0;
+};
+
+/// Where the audio in a saved peak index came from. Everything has to match
+/// for the saved peaks to be used.
+struct AudioPeakSource {
+	/// Full path to the source file
+	std::string path;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	/// FingerprintAudio() of the decoded audio, to tell tracks apart
+	uint32_t fingerprint = 0;
+};
+
+/// Precomputed peaks of the audio at a few fixed resolutions
+///
+/// The waveform display needs the min/max of each pixel column, which when
+/// zoomed out can be millions of samples each. The cache providers fill this
+/// in as they decode so that the renderer can instead combine a handful of
+/// precomputed buckets from the coarsest level which is still fine enough.
+///
+/// The index is built in spans of the coarsest bucket size. Each span is
+/// filled in all at once when all of its samples have been decoded, and may
+/// be read from any thread once it is complete.
+///
+/// The index can be saved to a file so that when the same audio is opened
+/// again the waveform can be drawn before anything has been decoded.
+class AudioPeakIndex {
+public:
+	/// log2 of the number of samples per bucket at each level
+	static const int level_bits[];
+	static const int level_count = 3;
+	/// Samples per span, which is the size of a bucket in the coarsest level
+	static const int64_t span_size;
+
+private:
+	int64_t num_samples;
+	int sample_rate;
+	std::vector<AudioPeak> levels[level_count];
+	/// Spans which have been filled in. Set after the buckets are written,
+	/// so readers only need to check this.
+	std::unique_ptr<std::atomic<bool>[]> complete;
+	/// Spans which a thread has started filling in, guarded by mutex
+	std::vector<bool> claimed;
+	std::mutex mutex;
+
+	/// File to load from and save to, if any
+	fs::path file;
+	/// Audio which the file is for
+	AudioPeakSource source;
+	/// Have any spans been computed since the index was loaded?
+	bool modified = false;
+
+	bool Load();
+
+	void ComputeSpan(AudioProvider const& provider, size_t span);
+
+public:
+	/// @param provider Provider whose audio is to be indexed
+	AudioPeakIndex(AudioProvider const& provider);
+
+	/// Load whatever was previously saved to the given file for the same
+	/// audio, and remember the file for Save(). Spans which have already been
+	/// computed are kept.
+	/// @param source Identity of the audio, which is saved along with the
+	///               peaks and has to match exactly for them to be loaded
+	void SetFile(fs::path const& file, AudioPeakSource const& source);
+
+	/// Write the index to the file given to SetFile() if anything has been
+	/// added to it. Failures are logged rather than thrown, as this is
+	/// typically called while closing the audio.
+	void Save();
+
+	/// Fill in every span overlapping [start, start + count) which provider
+	/// reports as fully decoded. Safe to call concurrently.
+	void Update(AudioProvider const& provider, int64_t start, int64_t count);
+
+	/// Has every span overlapping [start, start + count) been filled in?
+	bool IsComplete(int64_t start, int64_t count) const;
+
+	/// Get the combined peak of [start, start + count)
+	///
+	/// Uses the coarsest level whose buckets are no larger than max_bucket,
+	/// and rounds the range out to whole buckets of that level.
+	/// @return false if no level is fine enough or part of the range has not
+	///         been indexed yet
+	bool Get(int64_t start, int64_t count, int64_t max_bucket, AudioPeak &out) const;
+};
+}
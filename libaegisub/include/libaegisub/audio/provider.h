@@ -23,13 +23,17 @@
 #include <vector>
 
 namespace agi {
+class AudioPeakIndex;
+struct AudioPeakSource;
+
 class AudioProvider {
 protected:
 	int channels = 0;
 	/// Total number of samples per channel
 	int64_t num_samples = 0;
 	/// Samples per channel which have been decoded and can be fetched with FillBuffer
-	/// Only applicable for the cache providers
+	/// Only applicable for the cache providers, which may decode out of order,
+	/// so this is not necessarily the length of a decoded prefix
 	std::atomic<int64_t> decoded_samples{0};
 	int sample_rate = 0;
 	int bytes_per_sample = 0;
@@ -58,6 +62,30 @@ public:
 
 	/// Does this provider benefit from external caching?
 	virtual bool NeedsCache() const { return false; }
+
+	/// Have all of the samples in [start, start + count) been decoded?
+	virtual bool IsRangeDecoded(int64_t start, int64_t count) const { return start + count <= decoded_samples; }
+
+	/// Get the precomputed peaks of the audio, if this provider has them
+	virtual AudioPeakIndex const* GetPeakIndex() const { return nullptr; }
+
+	/// Keep the peak index in the given file between sessions, if this
+	/// provider has one. Whatever is already in the file for the same source
+	/// is loaded immediately.
+	virtual void SetPeakIndexFile(fs::path const&, AudioPeakSource const&) { }
+
+	/// Reasons for wanting part of the audio decoded soon, most urgent first
+	enum class DecodeHint { Playback, Viewport, Count };
+
+	/// Ask for [start, start + count) to be decoded before the rest of the
+	/// audio. Replaces the previous range given for the same hint, and a count
+	/// of zero clears it. Only the cache providers do anything with this.
+	virtual void SetDecodePriority(DecodeHint, int64_t, int64_t) { }
+
+	/// Create another provider for the same audio which can be read from at
+	/// the same time as this one on a different thread
+	/// @return The new provider, or nullptr if this provider can't be cloned
+	virtual std::unique_ptr<AudioProvider> Clone() const { return nullptr; }
 };
 
 /// Helper base class for an audio provider which wraps another provider
@@ -92,9 +120,20 @@ std::unique_ptr<AudioProvider> CreateDummyAudioProvider(fs::path const& filename
 std::unique_ptr<AudioProvider> CreatePCMAudioProvider(fs::path const& filename, BackgroundRunner *);
 
 std::unique_ptr<AudioProvider> CreateConvertAudioProvider(std::unique_ptr<AudioProvider> source_provider);
+/// Present the audio as 16-bit mono, converting it as it is read, so that a
+/// cache wrapped around the result stores only what the audio display and
+/// players use. Returns the provider unchanged if it is already 16-bit mono.
+std::unique_ptr<AudioProvider> CreateDownmixAudioProvider(std::unique_ptr<AudioProvider> source_provider);
 std::unique_ptr<AudioProvider> CreateLockAudioProvider(std::unique_ptr<AudioProvider> source_provider);
 std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& dir);
+/// Create a disk cache which is kept after the provider is destroyed, so that
+/// reopening source_file later can reuse the already-decoded audio
+std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& dir, fs::path const& source_file);
 std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> source_provider);
 
+/// Checksum a few short spans of the decoded audio, so that different audio
+/// tracks from the same file can be told apart
+uint32_t FingerprintAudio(AudioProvider const& provider);
+
 void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int start_time, int end_time);
 }
@@ -0,0 +1,42 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/cpu.h>
+
+#include <cstdint>
+
+namespace agi {
+/// Convert interleaved samples to signed 16-bit mono
+///
+/// Floating point samples are scaled from [-1, 1] and clamped, 8-bit samples
+/// are assumed to be unsigned with a bias of 128, and wider integer samples
+/// are assumed to be signed and are truncated to their top 16 bits. Multiple
+/// channels are averaged together.
+///
+/// @param dst Buffer for count samples
+/// @param src count * channels samples
+/// @param count Number of samples per channel
+/// @param channels Number of interleaved channels in src
+/// @param bytes_per_sample Size of each sample in src
+/// @param float_samples Are the samples in src float or double?
+/// @param level Best instruction set to use, for comparing implementations.
+///              Anything the CPU doesn't support is ignored.
+void ConvertToInt16Mono(int16_t *dst, const void *src, int64_t count, int channels,
+                        int bytes_per_sample, bool float_samples,
+                        cpu::SimdLevel level = cpu::BestSimdLevel());
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace agi {
+/// @class BufferPool
+/// @brief A thread-safe cache of large, aligned memory buffers
+///
+/// Freed buffers are kept to be handed out again rather than returned to the
+/// system, which for buffers as big as video frames saves both the
+/// allocation and the page faults on first touching the memory. Requested
+/// sizes are rounded up to one of eight size classes per power of two, so
+/// that buffers of slightly different sizes can be shared.
+class BufferPool {
+	std::mutex lock;
+	/// Unused buffers, by size class
+	std::map<size_t, std::vector<void *>> free_buffers;
+	/// Total size of the unused buffers
+	size_t pooled_size = 0;
+	/// Most memory to keep in unused buffers
+	size_t max_size;
+
+	/// Remove unused buffers until there's room for extra bytes, preferring
+	/// those not in the given size class
+	/// @return The removed buffers, which must be released outside of the lock
+	std::vector<void *> Trim(size_t extra, size_t keep_class);
+
+	static void *NewBuffer(size_t size);
+	static void DeleteBuffer(void *buffer);
+
+public:
+	/// Alignment of every buffer, which is enough for any SIMD load
+	static const size_t alignment = 64;
+
+	/// Constructor
+	/// @param max_size Most memory to keep in unused buffers, in bytes
+	explicit BufferPool(size_t max_size) : max_size(max_size) { }
+	~BufferPool();
+
+	BufferPool(BufferPool const&) = delete;
+	BufferPool& operator=(BufferPool const&) = delete;
+
+	/// Get an uninitialized buffer of at least size bytes
+	void *Allocate(size_t size);
+
+	/// Return a buffer from Allocate() to the pool
+	/// @param buffer Buffer to free, which may be null
+	/// @param size The size it was allocated with
+	void Free(void *buffer, size_t size);
+
+	/// Change the most memory to keep in unused buffers, releasing any
+	/// buffers which no longer fit
+	void SetMaxSize(size_t max_size);
+
+	/// Get the total size of the unused buffers
+	size_t GetPooledSize();
+
+	/// Get the size actually allocated for a request of size bytes
+	static size_t SizeClass(size_t size);
+};
+
+/// @class pool_allocator
+/// @brief A standard allocator which draws from the BufferPool returned by Pool
+///
+/// Elements constructed without a value are default-initialized rather than
+/// value-initialized, so resizing a std::vector of bytes with this allocator
+/// doesn't write to the new elements, and the pool's buffers are only ever
+/// written to by their users.
+template<typename T, BufferPool& (*Pool)()>
+struct pool_allocator {
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind { typedef pool_allocator<U, Pool> other; };
+
+	pool_allocator() = default;
+	template<typename U>
+	pool_allocator(pool_allocator<U, Pool> const&) { }
+
+	T *allocate(size_t n) {
+		if (n > size_t(-1) / sizeof(T)) throw std::bad_alloc();
+		return static_cast<T *>(Pool().Allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T *p, size_t n) {
+		Pool().Free(p, n * sizeof(T));
+	}
+
+	template<typename U>
+	void construct(U *p) { ::new(static_cast<void *>(p)) U; }
+
+	template<typename U, typename... Args>
+	void construct(U *p, Args&&... args) { ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+};
+
+template<typename T, typename U, BufferPool& (*Pool)()>
+bool operator==(pool_allocator<T, Pool> const&, pool_allocator<U, Pool> const&) { return true; }
+template<typename T, typename U, BufferPool& (*Pool)()>
+bool operator!=(pool_allocator<T, Pool> const&, pool_allocator<U, Pool> const&) { return false; }
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+/// Defined when building for a CPU which may have SSE2/AVX2
+#define AGI_X86 1
+#endif
+
+/// Mark a function as using the given instruction set, so that its
+/// intrinsics can be used without building everything for that instruction
+/// set. Such functions must only be called after checking BestSimdLevel().
+#if defined(AGI_X86) && defined(__GNUC__)
+#define AGI_TARGET(isa) __attribute__((target(isa)))
+#else
+#define AGI_TARGET(isa)
+#endif
+
+namespace agi { namespace cpu {
+	/// Vector instruction sets which code can pick between at runtime
+	enum class SimdLevel {
+		None,
+		SSE2,
+		AVX2
+	};
+
+	/// Get the best instruction set supported by both this build and the
+	/// CPU it is running on
+	SimdLevel BestSimdLevel();
+} }
@@ -46,5 +46,13 @@ namespace agi {
 
 		/// Create a new serial queue
 		std::unique_ptr<Queue> Create();
+
+		/// Call fn(i) for each i in [0, count), spreading the calls across the
+		/// background queue and the calling thread, and return once all of
+		/// them are complete. fn must not throw.
+		///
+		/// The calling thread takes part in the work rather than just waiting
+		/// for it, so this is safe to use from within background tasks.
+		void ParallelFor(size_t count, std::function<void (size_t)> const& fn);
 	}
 }
@@ -0,0 +1,68 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/cpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace agi {
+/// Forward fast Fourier transform of real input
+///
+/// The input is treated as a complex sequence of half the length, which is
+/// transformed and then separated into the spectrum of the real input. The
+/// bit-reversal order and twiddle factors for the size are computed once when
+/// constructed, so one instance should be reused for every transform of the
+/// same size. Transform() may be called from several threads at once.
+class RealFFT {
+	/// Number of real input samples
+	size_t n;
+	/// Bit-reversed order of the input pairs
+	std::vector<uint32_t> bitrev;
+	/// Twiddle factors for each pass of the half-size complex transform. The
+	/// factors for the pass combining blocks of size h start at index h.
+	std::vector<float> twiddle_re, twiddle_im;
+	/// Twiddle factors for separating the real spectrum
+	std::vector<float> split_re, split_im;
+	/// Instruction set used by the passes
+	cpu::SimdLevel level;
+
+public:
+	/// @param n Number of input samples, which must be a power of two and at least 4
+	/// @param level Best instruction set to use, for comparing implementations.
+	///              Anything the CPU doesn't support is ignored.
+	RealFFT(size_t n, cpu::SimdLevel level = cpu::BestSimdLevel());
+
+	/// Number of input samples
+	size_t Size() const { return n; }
+
+	/// Transform Size() samples
+	/// @param input Samples to transform
+	/// @param[out] out_re Real parts of the Size() / 2 + 1 non-redundant bins
+	/// @param[out] out_im Imaginary parts of the same bins
+	/// @param window If not null, Size() coefficients to multiply the input by
+	///
+	/// The output is not normalized, matching FFTW's r2c transforms.
+	void Transform(const float *input, float *out_re, float *out_im, const float *window = nullptr) const;
+};
+
+/// Get the coefficients of a periodic Hann window of n samples, for reducing
+/// spectral leakage between the bins of a transform
+std::vector<float> HannWindow(size_t n);
+}
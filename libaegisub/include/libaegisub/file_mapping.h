@@ -63,4 +63,28 @@ namespace agi {
 		const char *read(int64_t offset, uint64_t length);
 		char *write(int64_t offset, uint64_t length);
 	};
+
+	/// A read/write mapping of a file which is left on disk when closed, so
+	/// that the contents can be reused by a later session
+	class persistent_file_mapping {
+		file_mapping file;
+		uint64_t file_size = 0;
+		uint64_t existing_size = 0;
+
+		std::unique_ptr<boost::interprocess::mapped_region> read_region;
+		uint64_t read_mapping_start = 0;
+		std::unique_ptr<boost::interprocess::mapped_region> write_region;
+		uint64_t write_mapping_start = 0;
+
+	public:
+		/// Open or create the file and resize it to the given size
+		persistent_file_mapping(fs::path const& filename, uint64_t size);
+		~persistent_file_mapping();
+
+		/// Size of the file before it was opened, or zero if it was just created
+		uint64_t previous_size() const { return existing_size; }
+
+		const char *read(int64_t offset, uint64_t length);
+		char *write(int64_t offset, uint64_t length);
+	};
 }
@@ -0,0 +1,59 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/cpu.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace agi {
+/// A flip and/or rotation of an image
+///
+/// The output pixel at (x, y) is taken from the source pixel at (y, x) if
+/// transpose is set and (x, y) otherwise, with that x coordinate then
+/// mirrored if flip_x is set and the y coordinate if flip_y is set. A
+/// transposed image's width is the source's height and vice versa.
+///
+/// Every combination of rotating by a multiple of 90 degrees and mirroring
+/// is one of these, and two of them can be combined by toggling the flips of
+/// the first one.
+struct image_transform {
+	bool transpose = false;
+	bool flip_x = false;
+	bool flip_y = false;
+
+	/// Get the transform for rotating clockwise by a multiple of 90 degrees
+	static image_transform rotation(int degrees);
+
+	/// Does this transform leave the image as it is?
+	bool identity() const { return !transpose && !flip_x && !flip_y; }
+};
+
+/// Copy a 32-bit per pixel image, applying a transform
+/// @param src First row of the source image
+/// @param src_pitch Bytes from the start of one source row to the next
+/// @param width Width of the source image in pixels
+/// @param height Height of the source image in pixels
+/// @param dst First row of the output image, which must not overlap the source
+/// @param dst_pitch Bytes from the start of one output row to the next
+/// @param transform Transform to apply
+/// @param level Best instruction set to use, for comparing implementations
+void transform_bgra(const uint8_t *src, size_t src_pitch, size_t width, size_t height,
+                    uint8_t *dst, size_t dst_pitch, image_transform transform,
+                    cpu::SimdLevel level = cpu::BestSimdLevel());
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace agi {
+/// @class interval_index
+/// @brief A set of half-open time ranges, each with a value, which can be
+///        searched for the ranges containing a time or overlapping a range
+///
+/// The intervals are kept sorted by start time, along with a flat binary
+/// tree of the latest end time under each node, so a query only visits the
+/// parts of the tree which hold a match. Queries take O(log n + k) time for
+/// k matches and changes take O(n) time, so changes should be batched.
+template<typename T>
+class interval_index {
+public:
+	struct interval {
+		int start;
+		int end;
+		T value;
+	};
+
+private:
+	/// Sorted by start time
+	std::vector<interval> items;
+	/// Latest end time under each node of the tree, with node 1 as the root,
+	/// the children of node i at 2i and 2i+1, and the leaf for items[i] at
+	/// leaves + i
+	std::vector<int> max_end;
+	size_t leaves = 0;
+
+	static bool by_start(interval const& a, interval const& b) {
+		return a.start < b.start;
+	}
+
+	void rebuild() {
+		leaves = 1;
+		while (leaves < items.size()) leaves *= 2;
+		max_end.assign(leaves * 2, INT_MIN);
+		for (size_t i = 0; i < items.size(); ++i)
+			max_end[leaves + i] = items[i].end;
+		for (size_t i = leaves - 1; i > 0; --i)
+			max_end[i] = std::max(max_end[i * 2], max_end[i * 2 + 1]);
+	}
+
+	template<typename Func>
+	void visit(size_t node, size_t first, size_t count, size_t limit, int after, Func& func) const {
+		if (first >= limit || max_end[node] <= after) return;
+		if (count == 1) {
+			func(items[first]);
+			return;
+		}
+		visit(node * 2, first, count / 2, limit, after, func);
+		visit(node * 2 + 1, first + count / 2, count / 2, limit, after, func);
+	}
+
+public:
+	interval_index() { rebuild(); }
+
+	/// @param intervals Intervals to index, in any order
+	explicit interval_index(std::vector<interval> intervals)
+	: items(std::move(intervals))
+	{
+		std::stable_sort(begin(items), end(items), by_start);
+		rebuild();
+	}
+
+	size_t size() const { return items.size(); }
+	bool empty() const { return items.empty(); }
+
+	/// Add intervals to the index
+	/// @param intervals Intervals to add, in any order
+	void insert(std::vector<interval> intervals) {
+		std::stable_sort(begin(intervals), end(intervals), by_start);
+		size_t old_size = items.size();
+		items.insert(end(items),
+			std::make_move_iterator(begin(intervals)),
+			std::make_move_iterator(end(intervals)));
+		std::inplace_merge(begin(items), begin(items) + old_size, end(items), by_start);
+		rebuild();
+	}
+
+	/// Remove all intervals for which pred returns true
+	template<typename Pred>
+	void erase_if(Pred pred) {
+		items.erase(std::remove_if(begin(items), end(items), pred), end(items));
+		rebuild();
+	}
+
+	/// Call func with each interval which contains time (start <= time < end),
+	/// in order of start time
+	template<typename Func>
+	void containing(int time, Func&& func) const {
+		if (time == INT_MAX) return;
+		overlapping(time, time + 1, func);
+	}
+
+	/// Call func with each interval which overlaps [begin, end)
+	/// (start < end and end > begin), in order of start time
+	template<typename Func>
+	void overlapping(int begin, int end, Func&& func) const {
+		auto limit = std::lower_bound(items.begin(), items.end(), end,
+			[](interval const& i, int t) { return i.start < t; }) - items.begin();
+		visit(1, 0, leaves, limit, begin, func);
+	}
+};
+}
@@ -14,10 +14,14 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#pragma once
+
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 #include <libaegisub/color.h>
+#include <libaegisub/cpu.h>
 
 namespace agi {
 enum class ycbcr_matrix {
@@ -35,6 +39,8 @@ enum class ycbcr_range {
 
 /// A converter between YCbCr colorspaces and RGB
 class ycbcr_converter {
+	friend class ycbcr_planar_converter;
+
 	std::array<double, 9> from_ycbcr;
 	std::array<double, 9> to_ycbcr;
 
@@ -93,5 +99,57 @@ public:
 		return Color{arr[0], arr[1], arr[2], c.a};
 	}
 };
-}
 
+/// Layout of a planar YCbCr image
+struct ycbcr_planes {
+	const uint8_t *y;   ///< Luma plane
+	const uint8_t *cb;  ///< Blue-difference plane, or null for greyscale
+	const uint8_t *cr;  ///< Red-difference plane, or null for greyscale
+	size_t y_stride;    ///< Bytes from the start of one luma row to the next
+	size_t c_stride;    ///< Bytes from the start of one chroma row to the next
+	int chroma_shift_x; ///< log2 of the horizontal chroma subsampling; 0, 1 or 2
+	int chroma_shift_y; ///< log2 of the vertical chroma subsampling; 0 or 1
+};
+
+/// Fixed-point converter from planar YCbCr images to 8-bit BGRA
+///
+/// Gives the same results as ycbcr_converter::ycbcr_to_rgb() to within
+/// rounding, but works on whole rows at a time with SIMD where available.
+/// The alpha channel of the output is set to zero.
+class ycbcr_planar_converter {
+public:
+	/// Coefficients for the fixed-point conversion; see the constructor
+	struct coefficients {
+		int16_t y, r_cr, g_cb, g_cr, b_cb;
+		int32_t r_k, g_k, b_k;
+		int shift;    ///< Bits to shift the sums right by
+		int in_shift; ///< Bits to shift samples right by before use
+		uint16_t neutral; ///< Shifted chroma value to use for greyscale images
+		bool wide;    ///< Samples are stored as 16-bit values
+	};
+
+private:
+	coefficients c;
+	cpu::SimdLevel level;
+
+public:
+	/// @param mat Matrix the image is encoded with
+	/// @param range Range the image is encoded with
+	/// @param bit_depth Bits per sample, from 8 to 16. Samples wider than 8
+	///                  bits are stored as little-endian 16-bit values.
+	/// @param level Best instruction set to use, for comparing implementations
+	ycbcr_planar_converter(ycbcr_matrix mat, ycbcr_range range, int bit_depth = 8, cpu::SimdLevel level = cpu::BestSimdLevel());
+
+	/// Convert rows [first, last) of an image
+	/// @param src Image to convert
+	/// @param width Width of the image in pixels
+	/// @param first First row to convert
+	/// @param last One past the last row to convert
+	/// @param dst Output image; row first is written at dst + first * dst_stride
+	/// @param dst_stride Bytes from the start of one output row to the next
+	void convert_rows(ycbcr_planes const& src, int width, int first, int last, uint8_t *dst, size_t dst_stride) const;
+
+	/// Convert a whole image, with bands of rows converted in parallel
+	void convert(ycbcr_planes const& src, int width, int height, uint8_t *dst, size_t dst_stride) const;
+};
+}
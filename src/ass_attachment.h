@@ -19,6 +19,7 @@
 #include <libaegisub/fs_fwd.h>
 
 #include <boost/flyweight.hpp>
+#include <vector>
 
 /// @class AssAttachment
 class AssAttachment final : public AssEntry {
@@ -37,6 +38,9 @@ public:
 	/// Add a line of data (without newline) read from a subtitle file
 	void AddData(std::string const& data) { entry_data = entry_data.get() + data + "\r\n"; }
 
+	/// Get the decoded contents of the attached file
+	std::vector<char> GetData() const;
+
 	/// Extract the contents of this attachment to a file
 	/// @param filename Path to save the attachment to
 	void Extract(agi::fs::path const& filename) const;
@@ -46,6 +50,9 @@ public:
 	std::string GetFileName(bool raw=false) const;
 
 	std::string const& GetEntryData() const { return entry_data; }
+	/// Get the entry data as the flyweight holding it. Attachments with the
+	/// same contents share it, so these compare equal in constant time.
+	boost::flyweight<std::string> const& GetSharedEntryData() const { return entry_data; }
 	AssEntryGroup Group() const override;
 
 	AssAttachment(AssAttachment const& rgt) = default;
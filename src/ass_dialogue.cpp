@@ -35,15 +35,12 @@
 #include "subtitle_format.h"
 #include "utils.h"
 
+#include <libaegisub/ass/event_line.h>
 #include <libaegisub/of_type_adaptor.h>
 #include <libaegisub/split.h>
 #include <libaegisub/make_unique.h>
 
-#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/join.hpp>
-#include <boost/algorithm/string/trim.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/regex.hpp>
 #include <boost/spirit/include/karma_generate.hpp>
 #include <boost/spirit/include/karma_int.hpp>
 
@@ -71,79 +68,23 @@ AssDialogue::AssDialogue(std::string const& data) {
 
 AssDialogue::~AssDialogue () { }
 
-class tokenizer {
-	agi::StringRange str;
-	agi::split_iterator<agi::StringRange::const_iterator> pos;
-
-public:
-	tokenizer(agi::StringRange const& str) : str(str) , pos(agi::Split(str, ',')) { }
-
-	agi::StringRange next_tok() {
-		if (pos.eof())
-			throw SubtitleFormatParseError("Failed parsing line: " + std::string(str.begin(), str.end()));
-		return *pos++;
-	}
-
-	std::string next_str() { return agi::str(next_tok()); }
-	std::string next_str_trim() { return agi::str(boost::trim_copy(next_tok())); }
-};
-
 void AssDialogue::Parse(std::string const& raw) {
-	agi::StringRange str;
-	if (boost::starts_with(raw, "Dialogue:")) {
-		Comment = false;
-		str = agi::StringRange(raw.begin() + 10, raw.end());
-	}
-	else if (boost::starts_with(raw, "Comment:")) {
-		Comment = true;
-		str = agi::StringRange(raw.begin() + 9, raw.end());
-	}
-	else
+	agi::ass::EventLine line;
+	if (!agi::ass::ParseEventLine(raw, line))
 		throw SubtitleFormatParseError("Failed parsing line: " + raw);
 
-	tokenizer tkn(str);
-
-	// Get first token and see if it has "Marked=" in it
-	auto tmp = tkn.next_str_trim();
-	bool ssa = boost::istarts_with(tmp, "marked=");
-
-	// Get layer number
-	if (ssa)
-		Layer = 0;
-	else
-		Layer = boost::lexical_cast<int>(tmp);
-
-	Start = tkn.next_str_trim();
-	End = tkn.next_str_trim();
-	Style = tkn.next_str_trim();
-	Actor = tkn.next_str_trim();
-	for (int& margin : Margin)
-		margin = mid(-90000, boost::lexical_cast<int>(tkn.next_str()), 100000);
-	Effect = tkn.next_str_trim();
-
-	std::string text{tkn.next_tok().begin(), str.end()};
-
-	if (text.size() > 1 && text[0] == '{' && text[1] == '=') {
-		static const boost::regex extradata_test("^\\{(=\\d+)+\\}");
-		boost::match_results<std::string::iterator> rematch;
-		if (boost::regex_search(text.begin(), text.end(), rematch, extradata_test)) {
-			std::string extradata_str = rematch.str(0);
-			text = rematch.suffix().str();
-
-			static const boost::regex idmatcher("=(\\d+)");
-			auto start = extradata_str.begin();
-			auto end = extradata_str.end();
-			std::vector<uint32_t> ids;
-			while (boost::regex_search(start, end, rematch, idmatcher)) {
-				auto id = boost::lexical_cast<uint32_t>(rematch.str(1));
-				ids.push_back(id);
-				start = rematch.suffix().first;
-			}
-			ExtradataIds = ids;
-		}
-	}
-
-	Text = text;
+	Comment = line.comment;
+	Layer = line.layer;
+	Start = line.start;
+	End = line.end;
+	Style = agi::str(line.style);
+	Actor = agi::str(line.actor);
+	for (size_t i = 0; i < Margin.size(); ++i)
+		Margin[i] = mid(-90000, line.margin[i], 100000);
+	Effect = agi::str(line.effect);
+	if (!line.extradata_ids.empty())
+		ExtradataIds = line.extradata_ids;
+	Text = agi::str(line.text);
 }
 
 static void append_int(std::string &str, int v) {
@@ -166,7 +107,7 @@ static void append_unsafe_str(std::string &out, std::string const& str) {
 	out += ',';
 }
 
-std::string AssDialogue::GetEntryData() const {
+std::string AssDialogueBase::GetEntryData() const {
 	std::string str = Comment ? "Comment: " : "Dialogue: ";
 	str.reserve(51 + Style.get().size() + Actor.get().size() + Effect.get().size() + Text.get().size());
 
@@ -144,6 +144,9 @@ struct AssDialogueBase {
 	boost::flyweight<std::vector<uint32_t>> ExtradataIds;
 	/// Raw text data
 	boost::flyweight<std::string> Text;
+
+	/// Get the line as it appears in an ASS file
+	std::string GetEntryData() const;
 };
 
 class AssDialogue final : public AssEntry, public AssDialogueBase, public AssEntryListHook {
@@ -164,7 +167,6 @@ public:
 
 	/// Update the text of the line from parsed blocks
 	void UpdateText(std::vector<std::unique_ptr<AssDialogueBlock>>& blocks);
-	std::string GetEntryData() const;
 
 	/// Does this line collide with the passed line?
 	bool CollidesWith(const AssDialogue *target) const;
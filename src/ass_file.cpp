@@ -175,7 +175,7 @@ int AssFile::Commit(wxString const& desc, int type, int amend_id, AssDialogue *s
 			event.Row = i++;
 	}
 
-	PushState({desc, &amend_id, single_line});
+	PushState({desc, &amend_id, single_line, type});
 
 	AnnounceCommit(type, single_line);
 
@@ -56,6 +56,7 @@ struct AssFileCommit {
 	wxString const& message;
 	int *commit_id;
 	AssDialogue *single_line;
+	int type;
 };
 
 struct ProjectProperties {
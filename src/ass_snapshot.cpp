@@ -0,0 +1,175 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "ass_snapshot.h"
+
+#include "ass_attachment.h"
+#include "ass_dialogue.h"
+#include "ass_file.h"
+#include "ass_info.h"
+#include "ass_style.h"
+
+#include <climits>
+
+AssSnapshot::AssSnapshot(AssFile const& file, AssSnapshot const *prev)
+: Info(Share(prev ? prev->Info : nullptr, file.Info, [](AssInfo const& a, AssInfo const& b) {
+	return a.Key() == b.Key() && a.Value() == b.Value();
+}))
+, Styles(Share(prev ? prev->Styles : nullptr, file.Styles, [](AssStyle const& a, AssStyle const& b) {
+	return a.GetEntryData() == b.GetEntryData();
+}))
+, Attachments(Share(prev ? prev->Attachments : nullptr, file.Attachments, [](AssAttachment const& a, AssAttachment const& b) {
+	// The data is a flyweight, so this is a pointer comparison
+	return a.Group() == b.Group() && a.GetSharedEntryData() == b.GetSharedEntryData();
+}))
+, Events(ShareEvents(file.Events, prev ? &prev->Events : nullptr))
+{
+	for (auto const& block : Events)
+		line_count += block->size();
+	IndexTimes(prev);
+}
+
+AssDialogueBase const& AssSnapshot::Line(size_t row) const {
+	return (*Events[row / block_size])[row % block_size];
+}
+
+AssSnapshot AssSnapshot::WithLine(AssDialogueBase const& line) const {
+	AssSnapshot copy(*this);
+	auto& block = copy.Events[line.Row / block_size];
+	auto new_block = std::make_shared<Block>(*block);
+	auto& old_line = (*new_block)[line.Row % block_size];
+	const bool times_changed = !SameTimes(old_line, line);
+
+	old_line = line;
+	block = std::move(new_block);
+	if (times_changed)
+		copy.PatchTimes(*this, {line.Row});
+	return copy;
+}
+
+std::vector<size_t> AssSnapshot::RowsVisibleAt(int time) const {
+	if (time == INT_MAX) return {};
+	return RowsVisibleDuring(time, time + 1);
+}
+
+std::vector<size_t> AssSnapshot::RowsVisibleDuring(int begin, int end) const {
+	std::vector<size_t> rows;
+	if (!time_changes) {
+		Times->overlapping(begin, end, [&](TimeIndex::interval const& i) { rows.push_back(i.value); });
+		std::sort(rows.begin(), rows.end());
+		return rows;
+	}
+
+	auto const& changed = time_changes->rows;
+	Times->overlapping(begin, end, [&](TimeIndex::interval const& i) {
+		if (!std::binary_search(changed.begin(), changed.end(), i.value))
+			rows.push_back(i.value);
+	});
+	for (auto const& i : time_changes->times) {
+		if (i.start < end && i.end > begin)
+			rows.push_back(i.value);
+	}
+	std::sort(rows.begin(), rows.end());
+	return rows;
+}
+
+bool AssSnapshot::Visible(AssDialogueBase const& line) {
+	return !line.Comment && line.Start < line.End;
+}
+
+bool AssSnapshot::SameTimes(AssDialogueBase const& a, AssDialogueBase const& b) {
+	if (!Visible(a) || !Visible(b))
+		return Visible(a) == Visible(b);
+	return a.Start == b.Start && a.End == b.End;
+}
+
+void AssSnapshot::IndexTimes(AssSnapshot const *prev) {
+	if (!prev || prev->line_count != line_count) {
+		std::vector<TimeIndex::interval> times;
+		size_t row = 0;
+		ForEachLine([&](AssDialogueBase const& line) {
+			if (Visible(line))
+				times.push_back({line.Start, line.End, row});
+			++row;
+		});
+		Times = std::make_shared<TimeIndex>(std::move(times));
+		return;
+	}
+
+	// The lines are in the same rows as in prev, so only the lines in
+	// blocks which aren't shared with it can need updating
+	std::vector<size_t> changed;
+	for (size_t i = 0; i < Events.size(); ++i) {
+		if (Events[i] == prev->Events[i]) continue;
+		auto const& old_block = *prev->Events[i];
+		auto const& new_block = *Events[i];
+		for (size_t j = 0; j < new_block.size(); ++j) {
+			if (!SameTimes(old_block[j], new_block[j]))
+				changed.push_back(i * block_size + j);
+		}
+	}
+
+	if (changed.empty()) {
+		Times = prev->Times;
+		time_changes = prev->time_changes;
+		return;
+	}
+	PatchTimes(*prev, std::move(changed));
+}
+
+void AssSnapshot::PatchTimes(AssSnapshot const& prev, std::vector<size_t> rows) {
+	// Rows which were already out of date in prev's index still are
+	if (prev.time_changes) {
+		auto const& old_rows = prev.time_changes->rows;
+		std::vector<size_t> merged;
+		merged.reserve(old_rows.size() + rows.size());
+		std::set_union(old_rows.begin(), old_rows.end(), rows.begin(), rows.end(), std::back_inserter(merged));
+		rows = std::move(merged);
+	}
+
+	std::vector<TimeIndex::interval> times;
+	for (size_t row : rows) {
+		auto const& line = Line(row);
+		if (Visible(line))
+			times.push_back({line.Start, line.End, row});
+	}
+
+	if (rows.size() <= max_time_changes) {
+		auto changes = std::make_shared<TimeChanges>();
+		changes->rows = std::move(rows);
+		changes->times = std::move(times);
+		Times = prev.Times;
+		time_changes = std::move(changes);
+		return;
+	}
+
+	auto index = std::make_shared<TimeIndex>(*prev.Times);
+	index->erase_if([&](TimeIndex::interval const& i) {
+		return std::binary_search(rows.begin(), rows.end(), i.value);
+	});
+	index->insert(std::move(times));
+	Times = std::move(index);
+	time_changes.reset();
+}
+
+bool AssSnapshot::SameLine(AssDialogueBase const& a, AssDialogueBase const& b) {
+	// The strings are flyweights, so these are all cheap comparisons
+	return a.Id == b.Id && a.Row == b.Row && a.Comment == b.Comment
+		&& a.Layer == b.Layer && a.Margin == b.Margin
+		&& a.Start == b.Start && a.End == b.End
+		&& a.Style == b.Style && a.Actor == b.Actor && a.Effect == b.Effect
+		&& a.ExtradataIds == b.ExtradataIds && a.Text == b.Text;
+}
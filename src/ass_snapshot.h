@@ -0,0 +1,156 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/interval_index.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+class AssAttachment;
+class AssFile;
+class AssInfo;
+class AssStyle;
+struct AssDialogueBase;
+
+/// @class AssSnapshot
+/// @brief An immutable copy of a subtitles file which can be handed to
+///        another thread
+///
+/// Each part of the file, and each block of lines, is held by a shared
+/// pointer and reused from the snapshot the new one was made from if it
+/// hasn't changed, so making a snapshot after an edit only copies the parts
+/// which were edited.
+///
+/// The snapshot also indexes the times of the lines, so that finding the
+/// lines visible on a frame doesn't have to check every line. Changing the
+/// times of a few lines shares the previous snapshot's index and records the
+/// new times of just those lines alongside it. The index is only rebuilt once
+/// enough lines have changed, or when lines are added or removed.
+class AssSnapshot {
+public:
+	/// Lines are stored in blocks of this many
+	static const size_t block_size = 64;
+	using Block = std::vector<AssDialogueBase>;
+	using Blocks = std::vector<std::shared_ptr<const Block>>;
+	/// Times of the lines which can be visible, with their rows
+	using TimeIndex = agi::interval_index<size_t>;
+
+	std::shared_ptr<const std::vector<AssInfo>> Info;
+	std::shared_ptr<const std::vector<AssStyle>> Styles;
+	std::shared_ptr<const std::vector<AssAttachment>> Attachments;
+	Blocks Events;
+	std::shared_ptr<const TimeIndex> Times;
+
+	/// @param file File to copy
+	/// @param prev Snapshot to share the unchanged parts of the file with
+	AssSnapshot(AssFile const& file, AssSnapshot const *prev = nullptr);
+
+	/// Make a copy of this snapshot with one line replaced
+	/// @param line New version of the line at line.Row
+	AssSnapshot WithLine(AssDialogueBase const& line) const;
+
+	/// Number of lines in the file
+	size_t LineCount() const { return line_count; }
+	/// Get the line at the given row
+	AssDialogueBase const& Line(size_t row) const;
+
+	/// Rows of the lines which are visible at time, in file order
+	std::vector<size_t> RowsVisibleAt(int time) const;
+	/// Rows of the lines which are visible at any point in [begin, end), in
+	/// file order
+	std::vector<size_t> RowsVisibleDuring(int begin, int end) const;
+
+	template<typename Func>
+	void ForEachLine(Func&& func) const {
+		for (auto const& block : Events) {
+			for (auto const& line : *block)
+				func(line);
+		}
+	}
+
+	/// Do two lines have the same contents?
+	static bool SameLine(AssDialogueBase const& a, AssDialogueBase const& b);
+
+	/// Get the previous copy of something if it's unchanged, and a new copy
+	/// otherwise
+	/// @param prev Previous copy, if any
+	/// @param current Items to copy
+	/// @param equal Are two items the same?
+	template<typename T, typename Range, typename Equal>
+	static std::shared_ptr<const std::vector<T>> Share(std::shared_ptr<const std::vector<T>> const& prev, Range const& current, Equal equal) {
+		if (prev && prev->size() == (size_t)std::distance(std::begin(current), std::end(current))
+			&& std::equal(prev->begin(), prev->end(), std::begin(current), equal))
+			return prev;
+		return std::make_shared<std::vector<T>>(std::begin(current), std::end(current));
+	}
+
+	/// Copy lines into blocks, reusing the blocks of prev which are unchanged
+	/// @param events Lines to copy
+	/// @param prev Blocks of a previous copy of the lines, if any
+	template<typename Range>
+	static Blocks ShareEvents(Range const& events, Blocks const *prev) {
+		Blocks blocks;
+		auto it = std::begin(events), end = std::end(events);
+		for (size_t i = 0; it != end; ++i) {
+			auto block_end = it;
+			size_t count = 0;
+			for (; block_end != end && count < block_size; ++block_end, ++count) ;
+
+			if (prev && i < prev->size()) {
+				auto const& old = (*prev)[i];
+				if (old->size() == count && std::equal(old->begin(), old->end(), it, SameLine)) {
+					blocks.push_back(old);
+					it = block_end;
+					continue;
+				}
+			}
+
+			blocks.push_back(std::make_shared<Block>(it, block_end));
+			it = block_end;
+		}
+		return blocks;
+	}
+
+private:
+	size_t line_count = 0;
+
+	/// Lines whose times have changed since Times was built
+	struct TimeChanges {
+		/// Rows whose entries in Times are out of date, sorted
+		std::vector<size_t> rows;
+		/// Current times of those rows which are visible
+		std::vector<TimeIndex::interval> times;
+	};
+	/// Changes to apply on top of Times, if any
+	std::shared_ptr<const TimeChanges> time_changes;
+	/// Most changed rows to keep before building a new index
+	static const size_t max_time_changes = 256;
+
+	/// Is the line ever visible?
+	static bool Visible(AssDialogueBase const& line);
+	/// Would the line be in the time index in the same place in both versions?
+	static bool SameTimes(AssDialogueBase const& a, AssDialogueBase const& b);
+	/// Index the times of Events, starting from prev's index if the lines
+	/// are in the same rows
+	void IndexTimes(AssSnapshot const *prev);
+	/// Share prev's index, with the times of rows updated from Events
+	/// @param rows Rows whose times differ from prev's, sorted
+	void PatchTimes(AssSnapshot const& prev, std::vector<size_t> rows);
+};
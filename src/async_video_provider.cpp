@@ -18,32 +18,26 @@
 
 #include "ass_dialogue.h"
 #include "ass_file.h"
-#include "export_fixstyle.h"
+#include "ass_snapshot.h"
 #include "include/aegisub/subtitles_provider.h"
+#include "options.h"
 #include "video_frame.h"
 #include "video_provider_manager.h"
 
 #include <libaegisub/dispatch.h>
 
+#include <algorithm>
+#include <cmath>
+
 enum {
 	NEW_SUBS_FILE = -1,
 	SUBS_FILE_ALREADY_LOADED = -2
 };
 
 std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, double time, bool raw) {
-	// Find an unused buffer to use or allocate a new one if needed
-	std::shared_ptr<VideoFrame> frame;
-	for (auto& buffer : buffers) {
-		if (buffer.use_count() == 1) {
-			frame = buffer;
-			break;
-		}
-	}
-
-	if (!frame) {
-		frame = std::make_shared<VideoFrame>();
-		buffers.push_back(frame);
-	}
+	// The pixels come from VideoFramePool(), and go back to it once the
+	// display is done with the frame
+	auto frame = std::make_shared<VideoFrame>();
 
 	try {
 		source_provider->GetFrame(frame_number, *frame);
@@ -61,14 +55,14 @@ std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, doub
 			// other lines will probably not be viewed before the file changes
 			// again), and if it's a different frame, export the entire file.
 			if (single_frame != NEW_SUBS_FILE) {
-				subs_provider->LoadSubtitles(subs.get());
+				subs_provider->LoadSubtitles(*subs, -1, !header_changed);
 				single_frame = SUBS_FILE_ALREADY_LOADED;
 			}
 			else {
-				AssFixStylesFilter::ProcessSubs(subs.get());
 				single_frame = frame_number;
-				subs_provider->LoadSubtitles(subs.get(), time);
+				subs_provider->LoadSubtitles(*subs, time, !header_changed);
 			}
+			header_changed = false;
 		}
 	}
 	catch (agi::Exception const& err) { throw SubtitlesProviderErrorEvent(err.GetMessage()); }
@@ -95,40 +89,44 @@ AsyncVideoProvider::AsyncVideoProvider(agi::fs::path const& video_filename, std:
 : worker(agi::dispatch::Create())
 , subs_provider(get_subs_provider(parent, br))
 , source_provider(VideoProviderFactory::GetProvider(video_filename, colormatrix, br))
+, keyframes(source_provider->GetKeyFrames())
 , parent(parent)
 {
+	VideoFramePool().SetMaxSize(OPT_GET("Provider/Video/Cache/Pool Size")->GetInt() << 20);
 }
 
 AsyncVideoProvider::~AsyncVideoProvider() {
-	// Block until all currently queued jobs are complete
+	// Stop reading ahead, then block until all currently queued jobs are
+	// complete. A read-ahead job which was already running may have queued
+	// one more, which the second sync waits for.
+	++version;
+	worker->Sync([]{});
 	worker->Sync([]{});
 }
 
-void AsyncVideoProvider::LoadSubtitles(const AssFile *new_subs) throw() {
+void AsyncVideoProvider::LoadSubtitles(const AssFile *new_subs, bool events_only) throw() {
 	uint_fast32_t req_version = ++version;
 
-	auto copy = new AssFile(*new_subs);
+	latest_subs = std::make_shared<AssSnapshot>(*new_subs, latest_subs.get());
+	auto snapshot = latest_subs;
 	worker->Async([=]{
-		subs.reset(copy);
+		subs = snapshot;
+		if (!events_only)
+			header_changed = true;
 		single_frame = NEW_SUBS_FILE;
 		ProcAsync(req_version, false);
 	});
 }
 
 void AsyncVideoProvider::UpdateSubtitles(const AssFile *new_subs, const AssDialogue *changed) throw() {
+	if (!latest_subs) return LoadSubtitles(new_subs, true);
 	uint_fast32_t req_version = ++version;
 
-	// Copy just the line which were changed, then replace the line at the
-	// same index in the worker's copy of the file with the new entry
-	auto copy = new AssDialogue(*changed);
+	// Copy just the block of lines with the changed line in it
+	latest_subs = std::make_shared<AssSnapshot>(latest_subs->WithLine(*changed));
+	auto snapshot = latest_subs;
 	worker->Async([=]{
-		int i = 0;
-		auto it = subs->Events.begin();
-		std::advance(it, copy->Row - i);
-		i = copy->Row;
-		subs->Events.insert(it, *copy);
-		delete &*it--;
-
+		subs = snapshot;
 		single_frame = NEW_SUBS_FILE;
 		ProcAsync(req_version, true);
 	});
@@ -136,14 +134,81 @@ void AsyncVideoProvider::UpdateSubtitles(const AssFile *new_subs, const AssDialo
 
 void AsyncVideoProvider::RequestFrame(int new_frame, double new_time) throw() {
 	uint_fast32_t req_version = ++version;
+	int prefetch = OPT_GET("Provider/Video/Cache/Prefetch")->GetInt();
 
 	worker->Async([=]{
+		int prev_frame = frame_number;
 		time = new_time;
 		frame_number = new_frame;
 		ProcAsync(req_version, false);
+		SchedulePrefetch(req_version, prev_frame, prefetch);
 	});
 }
 
+void AsyncVideoProvider::SchedulePrefetch(uint_fast32_t req_version, int prev_frame, int count) {
+	prefetch_queue.clear();
+	if (req_version < version || prev_frame < 0 || count <= 0) return;
+
+	// Read-ahead frames go into the frame cache, so there's nothing to do if
+	// there isn't one, and they shouldn't push out most of what's in it
+	VideoCacheStats stats;
+	if (!source_provider->GetCacheStats(stats)) return;
+	const size_t frame_size = std::max<size_t>(1, (size_t)GetWidth() * GetHeight() * 4);
+	count = (int)std::min<size_t>(count, stats.max_size / 2 / frame_size);
+	if (count == 0) return;
+
+	auto is_keyframe = [&](int frame) {
+		return std::binary_search(keyframes.begin(), keyframes.end(), frame);
+	};
+
+	const int delta = frame_number - prev_frame;
+	const int last_frame = GetFrameCount() - 1;
+	if (delta == -1) {
+		// Decode the preceding frames in order, as decoding backwards would
+		// need a seek for every frame
+		for (int i = std::max(0, frame_number - count); i < frame_number; ++i)
+			prefetch_queue.push_back(i);
+	}
+	else if (delta != 1 && delta != 0 && is_keyframe(prev_frame) && is_keyframe(frame_number)) {
+		auto it = std::lower_bound(keyframes.begin(), keyframes.end(), frame_number);
+		if (delta > 0 && it + 1 != keyframes.end())
+			prefetch_queue.push_back(*(it + 1));
+		else if (delta < 0 && it != keyframes.begin())
+			prefetch_queue.push_back(*(it - 1));
+	}
+	else if (delta > 0 && delta <= count) {
+		// Stepping forward or playing, possibly with dropped frames
+		for (int i = frame_number + 1; i <= std::min(last_frame, frame_number + count); ++i)
+			prefetch_queue.push_back(i);
+	}
+
+	if (!prefetch_queue.empty())
+		worker->Async([=]{ Prefetch(req_version); });
+}
+
+void AsyncVideoProvider::Prefetch(uint_fast32_t req_version) {
+	// Any new request or change to the subtitles makes the guess stale, and
+	// as this runs on the same queue it will be handled next
+	if (req_version < version || prefetch_queue.empty()) {
+		prefetch_queue.clear();
+		return;
+	}
+
+	int frame = prefetch_queue.front();
+	prefetch_queue.pop_front();
+	try {
+		source_provider->PrefetchFrame(frame);
+	}
+	catch (VideoProviderError const&) {
+		// Reported if and when the frame is actually requested
+		prefetch_queue.clear();
+		return;
+	}
+
+	if (!prefetch_queue.empty())
+		worker->Async([=]{ Prefetch(req_version); });
+}
+
 bool AsyncVideoProvider::NeedUpdate(std::vector<AssDialogueBase const*> const& visible_lines) {
 	// Always need to render after a seek
 	if (single_frame != NEW_SUBS_FILE || frame_number != last_rendered)
@@ -177,11 +242,11 @@ void AsyncVideoProvider::ProcAsync(uint_fast32_t req_version, bool check_updated
 	// Only actually produce the frame if there's no queued changes waiting
 	if (req_version < version || frame_number < 0) return;
 
+	// Line times are whole milliseconds, so a line is visible at time if it's
+	// visible at the start of the millisecond time is in
 	std::vector<AssDialogueBase const*> visible_lines;
-	for (auto const& line : subs->Events) {
-		if (!line.Comment && !(line.Start > time || line.End <= time))
-			visible_lines.push_back(&line);
-	}
+	for (auto row : subs->RowsVisibleAt((int)std::floor(time)))
+		visible_lines.push_back(&subs->Line(row));
 
 	if (check_updated && !NeedUpdate(visible_lines)) return;
 
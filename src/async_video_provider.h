@@ -20,12 +20,14 @@
 #include <libaegisub/fs_fwd.h>
 
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <set>
 #include <wx/event.h>
 
 class AssDialogue;
 class AssFile;
+class AssSnapshot;
 class SubtitlesProvider;
 class VideoProvider;
 class VideoProviderError;
@@ -45,20 +47,30 @@ class AsyncVideoProvider {
 	std::unique_ptr<SubtitlesProvider> subs_provider;
 	/// Video provider
 	std::unique_ptr<VideoProvider> source_provider;
+	/// Keyframes of the video, for guessing where keyframe jumps will go
+	std::vector<int> keyframes;
 	/// Event handler to send FrameReady events to
 	wxEvtHandler *parent;
 
 	int frame_number = -1; ///< Last frame number requested
 	double time = -1.; ///< Time of the frame to pass to the subtitle renderer
 
-	/// Copy of the subtitles file to avoid having to touch the project context
-	std::unique_ptr<AssFile> subs;
+	/// Snapshot of the subtitles file to avoid having to touch the project
+	/// context. Only used on the worker thread.
+	std::shared_ptr<const AssSnapshot> subs;
+	/// The most recent snapshot passed to the worker, which the next one is
+	/// made from. Only used on the calling thread.
+	std::shared_ptr<const AssSnapshot> latest_subs;
 
 	/// If >= 0, the subtitles provider current has just the lines visible on
 	/// that frame loaded. If -1, the entire file is loaded. If -2, the
 	/// currently loaded file is out of date.
 	int single_frame = -1;
 
+	/// Have the script info, styles or attachments changed since the
+	/// subtitles provider last loaded the file?
+	bool header_changed = true;
+
 	/// Last rendered frame number
 	int last_rendered = -1;
 	/// Last rendered subtitles on that frame
@@ -72,19 +84,39 @@ class AsyncVideoProvider {
 	/// Produce a frame if req_version is still the current version
 	void ProcAsync(uint_fast32_t req_version, bool check_updated);
 
+	/// Frames to decode into the cache while idle, in the order to decode them
+	std::deque<int> prefetch_queue;
+
+	/// @brief Guess which frames will be requested next and start reading them ahead
+	/// @param req_version Version of the request for the current frame
+	/// @param prev_frame  Frame requested before the current one
+	/// @param count       Maximum number of frames to read ahead
+	///
+	/// Stepping or playing forwards reads ahead the following frames,
+	/// stepping backwards the preceding ones, and jumping from keyframe to
+	/// keyframe the next keyframe in the same direction. Any other seek is
+	/// assumed to be unpredictable.
+	void SchedulePrefetch(uint_fast32_t req_version, int prev_frame, int count);
+
+	/// Decode the next frame in prefetch_queue unless anything else has been
+	/// requested since req_version, then queue up the one after that
+	void Prefetch(uint_fast32_t req_version);
+
 	/// Monotonic counter used to drop frames when changes arrive faster than
 	/// they can be rendered
 	std::atomic<uint_fast32_t> version{ 0 };
 
-	std::vector<std::shared_ptr<VideoFrame>> buffers;
-
 public:
 	/// @brief Load the passed subtitle file
 	/// @param subs File to load
+	/// @param events_only Only the events have changed since the last time
+	///                    the file was loaded, so the subtitles provider can
+	///                    keep its styles and fonts
 	///
-	/// This function blocks until is it is safe for the calling thread to
-	/// modify subs
-	void LoadSubtitles(const AssFile *subs) throw();
+	/// The parts of the file which haven't changed since the last call are
+	/// shared with the copy the worker already has, so the caller is free to
+	/// modify subs as soon as this returns
+	void LoadSubtitles(const AssFile *subs, bool events_only = false) throw();
 
 	/// @brief Update a previously loaded subtitle file
 	/// @param subs Subtitle file which was last passed to LoadSubtitles
@@ -123,6 +155,7 @@ public:
 	std::string GetDecoderName() const    { return source_provider->GetDecoderName(); }
 	bool ShouldSetVideoProperties() const { return source_provider->ShouldSetVideoProperties(); }
 	bool HasAudio() const                 { return source_provider->HasAudio(); }
+	bool GetCacheStats(VideoCacheStats &stats) const { return source_provider->GetCacheStats(stats); }
 
 	/// @brief Constructor
 	/// @param videoFileName File to open
@@ -73,6 +73,7 @@ void AudioController::OnPlaybackTimer(wxTimerEvent &)
 	}
 	else
 	{
+		PrioritizePlayback(pos);
 		AnnouncePlaybackPosition(MillisecondsFromSamples(pos));
 	}
 }
@@ -136,6 +137,7 @@ void AudioController::PlayRange(const TimeRange &range)
 {
 	if (!player) return;
 
+	PrioritizePlayback(SamplesFromMilliseconds(range.begin()));
 	player->Play(SamplesFromMilliseconds(range.begin()), SamplesFromMilliseconds(range.length()));
 	playback_mode = PM_Range;
 	playback_timer.Start(20);
@@ -162,6 +164,7 @@ void AudioController::PlayToEnd(int start_ms)
 	if (!player) return;
 
 	int64_t start_sample = SamplesFromMilliseconds(start_ms);
+	PrioritizePlayback(start_sample);
 	player->Play(start_sample, provider->GetNumSamples()-start_sample);
 	playback_mode = PM_ToEnd;
 	playback_timer.Start(20);
@@ -176,6 +179,7 @@ void AudioController::Stop()
 	player->Stop();
 	playback_mode = PM_NotPlaying;
 	playback_timer.Stop();
+	PrioritizePlayback(-1);
 
 	AnnouncePlaybackStop();
 }
@@ -212,6 +216,18 @@ void AudioController::SetVolume(double volume)
 	player->SetVolume(volume);
 }
 
+void AudioController::PrioritizePlayback(int64_t sample)
+{
+	if (!provider) return;
+
+	// Enough to stay ahead of the player while the decoder catches up
+	const int64_t lookahead = provider->GetSampleRate() * 10;
+	if (sample < 0)
+		provider->SetDecodePriority(agi::AudioProvider::DecodeHint::Playback, 0, 0);
+	else
+		provider->SetDecodePriority(agi::AudioProvider::DecodeHint::Playback, sample, lookahead);
+}
+
 int64_t AudioController::SamplesFromMilliseconds(int64_t ms) const
 {
 	if (!provider) return 0;
@@ -122,6 +122,11 @@ class AudioController final : public wxEvtHandler {
 	/// @return Duration in milliseconds
 	int GetDuration() const;
 
+	/// Ask the provider to decode the audio just after the given sample
+	/// ahead of everything else, so that playback doesn't hit undecoded audio
+	/// @param sample Current playback position, or -1 if not playing
+	void PrioritizePlayback(int64_t sample);
+
 public:
 	AudioController(agi::Context *context);
 	~AudioController();
@@ -633,9 +633,20 @@ void AudioDisplay::ScrollPixelToLeft(int pixel_position)
 	scroll_left = pixel_position;
 	scrollbar->SetPosition(scroll_left);
 	timeline->SetPosition(scroll_left);
+	PrioritizeViewport();
 	Refresh();
 }
 
+void AudioDisplay::PrioritizeViewport()
+{
+	if (!provider) return;
+
+	const int64_t rate = provider->GetSampleRate();
+	const int64_t start = int64_t(scroll_left * ms_per_pixel) * rate / 1000;
+	const int64_t end = int64_t((scroll_left + GetClientSize().GetWidth()) * ms_per_pixel) * rate / 1000;
+	provider->SetDecodePriority(agi::AudioProvider::DecodeHint::Viewport, start, end - start + 1);
+}
+
 void AudioDisplay::ScrollTimeRangeInView(const TimeRange &range)
 {
 	int client_width = GetClientRect().GetWidth();
@@ -702,6 +713,9 @@ void AudioDisplay::SetZoomLevel(int new_zoom_level)
 	ScrollPixelToLeft(AbsoluteXFromTime(cursor_time) - cursor_pos);
 	if (track_cursor_pos >= 0)
 		track_cursor_pos = AbsoluteXFromTime(cursor_time);
+	// The visible time range changes with the zoom even when the scroll
+	// position ends up the same
+	PrioritizeViewport();
 	Refresh();
 }
 
@@ -766,11 +780,17 @@ void AudioDisplay::ReloadRenderingSettings()
 		audio_spectrum_renderer->SetResolution(
 			spectrum_width[spectrum_quality],
 			spectrum_distance[spectrum_quality]);
+		audio_spectrum_renderer->SetHannWindow(OPT_GET("Audio/Renderer/Spectrum/Hann Window")->GetBool());
+
+		spectrum_ready_connection = audio_spectrum_renderer->AddBlocksReadyListener([this] {
+			RefreshRect(wxRect(0, audio_top, GetClientSize().GetWidth(), audio_height), false);
+		});
 
 		audio_renderer_provider = std::move(audio_spectrum_renderer);
 	}
 	else
 	{
+		spectrum_ready_connection = agi::signal::Connection();
 		colour_scheme_name = OPT_GET("Colour/Audio Display/Waveform")->GetString();
 		audio_renderer_provider = agi::make_unique<AudioWaveformRenderer>(colour_scheme_name);
 	}
@@ -800,10 +820,9 @@ void AudioDisplay::OnLoadTimer(wxTimerEvent&)
 		if (new_pos > audio_load_position)
 			audio_load_position = new_pos;
 
-		const double left = last_sample_decoded * 1000.0 / provider->GetSampleRate() / ms_per_pixel;
-		const double right = new_decoded_count * 1000.0 / provider->GetSampleRate() / ms_per_pixel;
-
-		if (left < scroll_left + pixel_audio_width && right >= scroll_left)
+		// Audio isn't necessarily decoded front-to-back, so any part of the
+		// visible area may have become available
+		if (new_decoded_count != last_sample_decoded)
 			Refresh();
 		else
 			RefreshRect(scrollbar->GetBounds());
@@ -1191,6 +1210,7 @@ void AudioDisplay::OnSize(wxSizeEvent &)
 
 	audio_top = timeline->GetHeight();
 
+	PrioritizeViewport();
 	Refresh();
 }
 
@@ -1236,10 +1256,14 @@ void AudioDisplay::OnAudioOpen(agi::AudioProvider *provider)
 				OPT_SUB("Colour/Audio Display/Spectrum", &AudioDisplay::ReloadRenderingSettings, this),
 				OPT_SUB("Colour/Audio Display/Waveform", &AudioDisplay::ReloadRenderingSettings, this),
 				OPT_SUB("Audio/Renderer/Spectrum/Quality", &AudioDisplay::ReloadRenderingSettings, this),
+				OPT_SUB("Audio/Renderer/Spectrum/Hann Window", &AudioDisplay::ReloadRenderingSettings, this),
 			});
 			OnTimingController();
 		}
 
+		// Get whatever is on screen decoded before the rest of the audio
+		PrioritizeViewport();
+
 		last_sample_decoded = provider->GetDecodedSamples();
 		audio_load_position = -1;
 		audio_load_speed = 0;
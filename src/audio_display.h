@@ -68,6 +68,9 @@ class AudioDisplay: public wxWindow {
 	/// The current audio renderer
 	std::unique_ptr<AudioRendererBitmapProvider> audio_renderer_provider;
 
+	/// Repaints when the spectrum renderer has computed more of the audio
+	agi::signal::Connection spectrum_ready_connection;
+
 	/// The controller managing us
 	AudioController *controller = nullptr;
 
@@ -179,6 +182,9 @@ class AudioDisplay: public wxWindow {
 	/// @return Was the mouse event forwarded somewhere?
 	bool ForwardMouseEvent(wxMouseEvent &event);
 
+	/// Ask the provider to decode the visible part of the audio first
+	void PrioritizeViewport();
+
 	/// wxWidgets paint event
 	void OnPaint(wxPaintEvent &event);
 	/// wxWidgets mouse input event
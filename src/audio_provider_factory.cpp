@@ -20,11 +20,14 @@
 #include "options.h"
 #include "utils.h"
 
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/format.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/log.h>
 #include <libaegisub/path.h>
 
+#include <boost/crc.hpp>
 #include <boost/range/iterator_range.hpp>
 
 using namespace agi;
@@ -49,6 +52,49 @@ const factory providers[] = {
 	{"Avisynth", CreateAvisynthAudioProvider, false},
 #endif
 };
+
+/// Identify the audio so that saved peaks are only used for the same track
+/// of the same, unmodified file. Has to be given the provider from before
+/// the cache is added, as the cache has nothing to read at first.
+/// @return The source, with an empty path if the audio can't be identified
+AudioPeakSource IdentifyPeakSource(AudioProvider const& provider, fs::path const& filename) {
+	AudioPeakSource source;
+	try {
+		source.size = fs::Size(filename);
+		source.mtime = fs::ModifiedTime(filename);
+		source.fingerprint = FingerprintAudio(provider);
+	}
+	catch (fs::FileSystemError const&) {
+		// Not something on disk which we can check for modifications
+		return source;
+	}
+	catch (AudioProviderError const& e) {
+		LOG_E("audio_provider") << "Unable to fingerprint audio: " << e.GetMessage();
+		return source;
+	}
+	source.path = filename.string();
+	return source;
+}
+
+/// Keep the cache's waveform peaks between sessions, so that the waveform of
+/// audio which has been opened before can be shown before it is decoded
+void PersistPeakIndex(AudioProvider *provider, AudioPeakSource const& source, Path const& path_helper) {
+	if (source.path.empty()) return;
+
+	auto dir = path_helper.Decode("?local/peakcache/");
+	try {
+		fs::CreateDirectory(dir);
+	}
+	catch (fs::FileSystemError const& e) {
+		LOG_E("audio_provider") << "Unable to create peak cache directory: " << e.GetMessage();
+		return;
+	}
+
+	boost::crc_32_type path_hash;
+	path_hash.process_bytes(source.path.data(), source.path.size());
+	provider->SetPeakIndexFile(dir / agi::format("%08x-%08x.peaks", path_hash.checksum(), source.fingerprint), source);
+	CleanCache(dir, "*.peaks", 256, 100);
+}
 }
 
 std::vector<std::string> GetAudioProviderNames() {
@@ -112,6 +158,13 @@ std::unique_ptr<agi::AudioProvider> GetAudioProvider(fs::path const& filename,
 	if (!cache || !needs_cache)
 		return CreateLockAudioProvider(std::move(provider));
 
+	// Everything but some players only ever reads 16-bit mono, so unless the
+	// original format is wanted for playback don't spend memory caching it
+	if (OPT_GET("Audio/Cache/Downmix")->GetBool())
+		provider = CreateDownmixAudioProvider(std::move(provider));
+
+	auto peak_source = IdentifyPeakSource(*provider, filename);
+
 	// Convert to RAM
 	if (cache == 1) {
 		if (sizeof(void*) == 4 && (provider->GetNumSamples() * provider->GetChannels() * provider->GetBytesPerSample() >= (1 << 30))) {
@@ -124,8 +177,11 @@ std::unique_ptr<agi::AudioProvider> GetAudioProvider(fs::path const& filename,
 			), _("Out of Memory"), wxICON_ERROR | wxOK | wxCENTRE);
 			cache = 2;
 		}
-		else
-			return CreateRAMAudioProvider(std::move(provider));
+		else {
+			provider = CreateRAMAudioProvider(std::move(provider));
+			PersistPeakIndex(provider.get(), peak_source, path_helper);
+			return provider;
+		}
 	}
 
 	// Convert to HD
@@ -134,7 +190,12 @@ std::unique_ptr<agi::AudioProvider> GetAudioProvider(fs::path const& filename,
 		if (path == "default")
 			path = "?temp";
 		auto cache_dir = path_helper.MakeAbsolute(path_helper.Decode(path), "?temp");
-		return CreateHDAudioProvider(std::move(provider), cache_dir);
+		provider = CreateHDAudioProvider(std::move(provider), cache_dir, filename);
+		PersistPeakIndex(provider.get(), peak_source, path_helper);
+		CleanCache(cache_dir, "aegisub-audio-*.cache",
+			OPT_GET("Audio/Cache/HD/Size")->GetInt(),
+			OPT_GET("Audio/Cache/HD/Files")->GetInt());
+		return provider;
 	}
 
 	throw InternalError("Invalid audio caching method");
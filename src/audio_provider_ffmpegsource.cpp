@@ -49,31 +49,51 @@ class FFmpegSourceAudioProvider final : public agi::AudioProvider, FFmpegSourceP
 	/// audio source object
 	agi::scoped_holder<FFMS_AudioSource*, void (FFMS_CC *)(FFMS_AudioSource*)> AudioSource;
 
+	/// Index and track the source was opened from, kept so that more sources
+	/// can be opened for the same track
+	std::shared_ptr<FFMS_Index> Index;
+	agi::fs::path FileName;
+	int TrackNumber = -1;
+	bool Downmix = false;
+
 	mutable char FFMSErrMsg[1024];			///< FFMS error message
 	mutable FFMS_ErrorInfo ErrInfo;			///< FFMS error codes/messages
 
+	void InitErrorInfo();
 	void LoadAudio(agi::fs::path const& filename);
+	void OpenAudioSource();
 	void FillBuffer(void *Buf, int64_t Start, int64_t Count) const override {
 		if (FFMS_GetAudio(AudioSource, Buf, Start, Count, &ErrInfo))
 			throw agi::AudioDecodeError(std::string("Failed to get audio samples: ") + ErrInfo.Buffer);
 	}
 
+	/// Open another source for the same track as an existing provider
+	FFmpegSourceAudioProvider(FFmpegSourceAudioProvider const& other, agi::BackgroundRunner *br);
+
 public:
 	FFmpegSourceAudioProvider(agi::fs::path const& filename, agi::BackgroundRunner *br);
 
 	bool NeedsCache() const override { return true; }
+
+	std::unique_ptr<agi::AudioProvider> Clone() const override {
+		return std::unique_ptr<agi::AudioProvider>(new FFmpegSourceAudioProvider(*this, nullptr));
+	}
 };
 
+void FFmpegSourceAudioProvider::InitErrorInfo() {
+	ErrInfo.Buffer		= FFMSErrMsg;
+	ErrInfo.BufferSize	= sizeof(FFMSErrMsg);
+	ErrInfo.ErrorType	= FFMS_ERROR_SUCCESS;
+	ErrInfo.SubType		= FFMS_ERROR_SUCCESS;
+}
+
 /// @brief Constructor
 /// @param filename The filename to open
 FFmpegSourceAudioProvider::FFmpegSourceAudioProvider(agi::fs::path const& filename, agi::BackgroundRunner *br) try
 : FFmpegSourceProvider(br)
 , AudioSource(nullptr, FFMS_DestroyAudioSource)
 {
-	ErrInfo.Buffer		= FFMSErrMsg;
-	ErrInfo.BufferSize	= sizeof(FFMSErrMsg);
-	ErrInfo.ErrorType	= FFMS_ERROR_SUCCESS;
-	ErrInfo.SubType		= FFMS_ERROR_SUCCESS;
+	InitErrorInfo();
 	SetLogLevel();
 
 	LoadAudio(filename);
@@ -83,6 +103,19 @@ catch (agi::EnvironmentError const& err) {
 	throw agi::AudioProviderError(err.GetMessage());
 }
 
+FFmpegSourceAudioProvider::FFmpegSourceAudioProvider(FFmpegSourceAudioProvider const& other, agi::BackgroundRunner *br)
+: FFmpegSourceProvider(br)
+, AudioSource(nullptr, FFMS_DestroyAudioSource)
+, Index(other.Index)
+, FileName(other.FileName)
+, TrackNumber(other.TrackNumber)
+, Downmix(other.Downmix)
+{
+	InitErrorInfo();
+	OpenAudioSource();
+	audioHash = other.audioHash;
+}
+
 void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 	FFMS_Indexer *Indexer = FFMS_CreateIndexer(filename.string().c_str(), &ErrInfo);
 	if (!Indexer) {
@@ -108,45 +141,18 @@ void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 	else
 		throw agi::AudioDataNotFound("no audio tracks found");
 
-	// generate a name for the cache file
-	agi::fs::path CacheName = GetCacheFilename(filename);
-
-	// try to read index
-	agi::scoped_holder<FFMS_Index*, void (FFMS_CC*)(FFMS_Index*)>
-		Index(FFMS_ReadIndex(CacheName.string().c_str(), &ErrInfo), FFMS_DestroyIndex);
-
-	if (Index && FFMS_IndexBelongsToFile(Index, filename.string().c_str(), &ErrInfo))
-		Index = nullptr;
-
-	if (Index) {
-		// we already have an index, but the desired track may not have been
-		// indexed, and if it wasn't we need to reindex
-		FFMS_Track *TempTrackData = FFMS_GetTrackFromIndex(Index, TrackNumber);
-		if (FFMS_GetNumFrames(TempTrackData) <= 0)
-			Index = nullptr;
-	}
-
-	// reindex if the error handling mode has changed
-	FFMS_IndexErrorHandling ErrorHandling = GetErrorHandlingMode();
-#if FFMS_VERSION >= ((2 << 24) | (17 << 16) | (2 << 8) | 0)
-	if (Index && FFMS_GetErrorHandling(Index) != ErrorHandling)
-		Index = nullptr;
-#endif
-
-	// moment of truth
-	if (!Index) {
-		TrackSelection TrackMask = static_cast<TrackSelection>(TrackNumber);
-		if (OPT_GET("Provider/FFmpegSource/Index All Tracks")->GetBool())
-			TrackMask = TrackSelection::All;
-		Index = DoIndexing(Indexer, CacheName, TrackMask, ErrorHandling);
-	}
-	else
-		FFMS_CancelIndexing(Indexer);
-
-	// update access time of index file so it won't get cleaned away
-	agi::fs::Touch(CacheName);
+	// reuses the video provider's index when the audio is opened from the
+	// video file, and reindexes if the track wasn't indexed or the error
+	// handling mode has changed
+	this->Index = GetIndex(Indexer, filename, TrackNumber, false);
+	this->FileName = filename;
+	this->TrackNumber = TrackNumber;
+	Downmix = OPT_GET("Provider/Audio/FFmpegSource/Downmix")->GetBool();
+	OpenAudioSource();
+}
 
-	AudioSource = FFMS_CreateAudioSource(filename.string().c_str(), TrackNumber, Index, FFMS_DELAY_FIRST_VIDEO_TRACK, &ErrInfo);
+void FFmpegSourceAudioProvider::OpenAudioSource() {
+	AudioSource = FFMS_CreateAudioSource(FileName.string().c_str(), TrackNumber, Index.get(), FFMS_DELAY_FIRST_VIDEO_TRACK, &ErrInfo);
 	if (!AudioSource)
 		throw agi::AudioProviderError(std::string("Failed to open audio track: ") + ErrInfo.Buffer);
 
@@ -170,7 +176,7 @@ void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 	}
 
 #if FFMS_VERSION >= ((2 << 24) | (17 << 16) | (4 << 8) | 0)
-	if (OPT_GET("Provider/Audio/FFmpegSource/Downmix")->GetBool()) {
+	if (Downmix) {
 		if (channels > 2 || bytes_per_sample != 2 || float_samples) {
 			std::unique_ptr<FFMS_ResampleOptions, decltype(&FFMS_DestroyResampleOptions)>
 				opt(FFMS_CreateResampleOptions(AudioSource), FFMS_DestroyResampleOptions);
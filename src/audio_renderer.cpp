@@ -161,6 +161,13 @@ size_t AudioRenderer::NumBlocks(const int64_t samples) const
 	return static_cast<size_t>(duration / pixel_ms / cache_bitmap_width);
 }
 
+bool AudioRenderer::IsBlockReady(const int i) const
+{
+	const int64_t start = static_cast<int64_t>(i * cache_bitmap_width * pixel_ms * provider->GetSampleRate() / 1000);
+	const int64_t end = static_cast<int64_t>((i + 1) * cache_bitmap_width * pixel_ms * provider->GetSampleRate() / 1000) + 1;
+	return renderer->CanRender(start, end - start);
+}
+
 wxBitmap const& AudioRenderer::GetCachedBitmap(const int i, const AudioRenderingStyle style)
 {
 	assert(provider);
@@ -195,7 +202,7 @@ void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int
 	// And the offset in it to start its use at
 	const int firstbitmapoffset = start % cache_bitmap_width;
 	// The last bitmap required
-	const int lastbitmap = std::min<int>(end / cache_bitmap_width, NumBlocks(provider->GetDecodedSamples()) - 1);
+	const int lastbitmap = std::min<int>(end / cache_bitmap_width, NumBlocks(provider->GetNumSamples()) - 1);
 
 	// Set a clipping region so that the first and last bitmaps don't draw
 	// outside the requested range
@@ -204,7 +211,12 @@ void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int
 
 	for (int i = firstbitmap; i <= lastbitmap; ++i)
 	{
-		dc.DrawBitmap(GetCachedBitmap(i, style), origin);
+		// The cache providers decode out of order, so any given block may
+		// not be available yet even if later ones are
+		if (IsBlockReady(i))
+			dc.DrawBitmap(GetCachedBitmap(i, style), origin);
+		else
+			renderer->RenderBlank(dc, wxRect(origin.x, origin.y, cache_bitmap_width, pixel_height), style);
 		origin.x += cache_bitmap_width;
 	}
 
@@ -232,6 +244,11 @@ void AudioRendererBitmapProvider::SetProvider(agi::AudioProvider *const _provide
 		OnSetProvider();
 }
 
+bool AudioRendererBitmapProvider::CanRender(int64_t start, int64_t count) const
+{
+	return provider->IsRangeDecoded(start, count);
+}
+
 void AudioRendererBitmapProvider::SetMillisecondsPerPixel(const double new_pixel_ms)
 {
 	if (compare_and_set(pixel_ms, new_pixel_ms))
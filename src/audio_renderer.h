@@ -114,6 +114,9 @@ class AudioRenderer {
 	/// if the cache doesn't have it.
 	wxBitmap const& GetCachedBitmap(int i, AudioRenderingStyle style);
 
+	/// Is everything needed to render bitmap index i available yet?
+	bool IsBlockReady(int i) const;
+
 	/// @brief Update the block count in the bitmap caches
 	///
 	/// Should be called when the width of the virtual bitmap has changed, i.e.
@@ -270,6 +273,14 @@ public:
 	/// of the entire canvas the audio is being rendered in.
 	virtual void RenderBlank(wxDC &dc, const wxRect &rect, AudioRenderingStyle style) = 0;
 
+	/// @brief Is everything needed to render a range of audio available?
+	/// @param start First sample of the range
+	/// @param count Number of samples in the range
+	///
+	/// By default the samples have to have been decoded. Deriving classes which
+	/// can render from something else should override this.
+	virtual bool CanRender(int64_t start, int64_t count) const;
+
 	/// @brief Change audio provider
 	/// @param provider Audio provider to change to
 	void SetProvider(agi::AudioProvider *provider);
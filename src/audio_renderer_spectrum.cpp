@@ -35,18 +35,191 @@
 #include "audio_renderer_spectrum.h"
 
 #include "audio_colorscheme.h"
-#ifndef WITH_FFTW3
-#include "fft.h"
+#ifdef WITH_FFTW3
+#include <fftw3.h>
 #endif
 
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/dispatch.h>
+#include <libaegisub/fft.h>
 #include <libaegisub/make_unique.h>
 
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <wx/image.h>
 #include <wx/dcmemory.h>
 
+namespace {
+/// Number of blocks computed by each background task
+const size_t batch_size = 32;
+
+#ifdef WITH_FFTW3
+/// Planning isn't thread safe, so all threads have to share this while
+/// creating or destroying plans
+std::mutex &PlannerMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+#endif
+
+/// Buffers and FFT state for doing derivations on one thread
+///
+/// Each thread which computes blocks keeps its own, so that the background
+/// threads can work on different blocks at the same time.
+struct DerivationScratch {
+	/// Binary logarithm of the number of samples the buffers are sized for
+	size_t derivation_size = 0;
+
+	/// Raw audio data
+	std::vector<int16_t> audio;
+
+	/// Hann window coefficients for the derivation size
+	std::vector<float> window;
+
+#ifdef WITH_FFTW3
+	/// FFTW plan data
+	fftw_plan dft_plan = nullptr;
+	/// Input array for FFTW
+	double *dft_input = nullptr;
+	/// Output array for FFTW
+	fftw_complex *dft_output = nullptr;
+
+	~DerivationScratch()
+	{
+		Free();
+	}
+
+	void Free()
+	{
+		if (!dft_plan) return;
+		std::lock_guard<std::mutex> lock(PlannerMutex());
+		fftw_destroy_plan(dft_plan);
+		fftw_free(dft_input);
+		fftw_free(dft_output);
+		dft_plan = nullptr;
+		dft_input = nullptr;
+		dft_output = nullptr;
+	}
+#else
+	/// Transform tables for the derivation size
+	std::unique_ptr<agi::RealFFT> fft;
+	/// Input sample data
+	std::vector<float> fft_input;
+	/// Real part of the output
+	std::vector<float> fft_real;
+	/// Imaginary part of the output
+	std::vector<float> fft_imag;
+#endif
+
+	/// Resize the buffers for a derivation size, if they aren't already
+	void SetSize(size_t size)
+	{
+		if (!audio.empty() && size == derivation_size)
+			return;
+		derivation_size = size;
+		audio.resize(2 << size);
+		window = agi::HannWindow(2 << size);
+
+#ifdef WITH_FFTW3
+		Free();
+		std::lock_guard<std::mutex> lock(PlannerMutex());
+		dft_input = fftw_alloc_real(2<<size);
+		dft_output = fftw_alloc_complex(2<<size);
+		dft_plan = fftw_plan_dft_r2c_1d(
+			2<<size,
+			dft_input,
+			dft_output,
+			FFTW_MEASURE);
+#else
+		fft = agi::make_unique<agi::RealFFT>(2 << size);
+		fft_input.resize(2 << size);
+		fft_real.resize((1 << size) + 1);
+		fft_imag.resize((1 << size) + 1);
+#endif
+	}
+};
+
+/// @brief Convert audio data to float range [-1;+1)
+/// @param count Samples to convert
+/// @param src Samples to convert
+/// @param window If not null, coefficients to multiply the samples by
+/// @param dest Buffer to fill
+template<class T>
+void ConvertToFloat(size_t count, const int16_t *src, const float *window, T *dest) {
+	if (window)
+	{
+		for (size_t si = 0; si < count; ++si)
+			dest[si] = (T)(src[si]) / 32768.0 * window[si];
+		return;
+	}
+
+	for (size_t si = 0; si < count; ++si)
+	{
+		dest[si] = (T)(src[si]) / 32768.0;
+	}
+}
+
+/// @brief Fill a block with frequency-power data for a time range
+/// @param provider        Audio to derive the data from
+/// @param derivation_size Binary logarithm of number of samples to use
+/// @param derivation_dist Binary logarithm of number of samples between the start of derivations
+/// @param hann_window     Apply a Hann window to the samples before deriving
+/// @param block_index     Index of the block to fill data for
+/// @param[out] block      Address to write the data to
+///
+/// Safe to call from any thread.
+void ComputeBlock(agi::AudioProvider const& provider, size_t derivation_size, size_t derivation_dist, bool hann_window, size_t block_index, float *block)
+{
+	thread_local DerivationScratch scratch;
+	scratch.SetSize(derivation_size);
+
+	int64_t first_sample = (((int64_t)block_index) << derivation_dist) - ((int64_t)1 << derivation_size);
+	provider.GetInt16MonoAudio(scratch.audio.data(), first_sample, 2 << derivation_size);
+
+	const float *window = hann_window ? scratch.window.data() : nullptr;
+	// The window halves the average magnitude, so compensate to keep the
+	// brightness about the same
+	const double window_gain = hann_window ? 2 : 1;
+
+#ifdef WITH_FFTW3
+	ConvertToFloat(2 << derivation_size, scratch.audio.data(), window, scratch.dft_input);
+
+	fftw_execute(scratch.dft_plan);
+
+	double scale_factor = window_gain * 9 / sqrt(2 << (derivation_size + 1));
+
+	fftw_complex *o = scratch.dft_output;
+	for (size_t si = (size_t)1<<derivation_size; si > 0; --si)
+	{
+		*block++ = log10( sqrt(o[0][0] * o[0][0] + o[0][1] * o[0][1]) * scale_factor + 1 );
+		o++;
+	}
+#else
+	ConvertToFloat(2 << derivation_size, scratch.audio.data(), window, scratch.fft_input.data());
+
+	scratch.fft->Transform(scratch.fft_input.data(), scratch.fft_real.data(), scratch.fft_imag.data());
+	const float *fft_real = scratch.fft_real.data();
+	const float *fft_imag = scratch.fft_imag.data();
+
+	float scale_factor = window_gain * 9 / sqrt(2 * (float)(2<<derivation_size));
+
+	for (size_t si = 1<<derivation_size; si > 0; --si)
+	{
+		// With x in range [0;1], log10(x*9+1) will also be in range [0;1],
+		// although the FFT output can apparently get greater magnitudes than 1
+		// despite the input being limited to [-1;+1).
+		*block++ = log10( sqrt(*fft_real * *fft_real + *fft_imag * *fft_imag) * scale_factor + 1 );
+		fft_real++; fft_imag++;
+	}
+#endif
+}
+}
+
 /// Allocates blocks of derived data for the audio spectrum
 struct AudioSpectrumCacheBlockFactory {
 	typedef std::unique_ptr<float, std::default_delete<float[]>> BlockType;
@@ -58,13 +231,9 @@ struct AudioSpectrumCacheBlockFactory {
 	/// @param i Index of the block to produce data for
 	/// @return Newly allocated and filled block
 	///
-	/// The filling is delegated to the spectrum renderer
-	BlockType ProduceBlock(size_t i)
-	{
-		auto res = new float[((size_t)1)<<spectrum->derivation_size];
-		spectrum->FillBlock(i, res);
-		return BlockType(res);
-	}
+	/// Blocks which have already been computed in the background are used if
+	/// available, and otherwise the filling is delegated to the spectrum renderer
+	BlockType ProduceBlock(size_t i);
 
 	/// @brief Calculate the in-memory size of a spec
 	/// @return The size in bytes of a spectrum cache block
@@ -84,6 +253,161 @@ public:
 	}
 };
 
+/// @class AudioSpectrumWorker
+/// @brief Computes spectrum blocks on the background thread pool
+///
+/// The queued tasks share ownership of the worker so that it outlives them,
+/// but the provider and the listener belong to the renderer, so Cancel() has to
+/// be called before either goes away.
+class AudioSpectrumWorker final : public std::enable_shared_from_this<AudioSpectrumWorker> {
+	typedef AudioSpectrumCacheBlockFactory::BlockType BlockType;
+
+	/// Audio to derive the data from
+	agi::AudioProvider *provider;
+	/// Binary logarithm of number of samples to use in deriving frequency-power data
+	const size_t derivation_size;
+	/// Binary logarithm of number of samples between the start of derivations
+	const size_t derivation_dist;
+	/// Apply a Hann window before deriving
+	const bool hann_window;
+	/// Called on the GUI thread when some blocks have been finished
+	std::function<void ()> on_ready;
+
+	std::mutex mutex;
+	/// Signalled when the last running batch ends
+	std::condition_variable idle;
+	/// Batches which have started and not yet ended
+	int running = 0;
+	bool cancelled = false;
+	/// Blocks which have been computed but not yet moved to the cache
+	std::unordered_map<size_t, BlockType> finished;
+	/// Blocks which have been queued but not yet computed
+	std::unordered_set<size_t> queued;
+
+	void ComputeBatch(std::vector<size_t> const& blocks)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (cancelled) return;
+			++running;
+		}
+
+		for (size_t block_index : blocks)
+		{
+			BlockType block(new float[(size_t)1 << derivation_size]);
+			ComputeBlock(*provider, derivation_size, derivation_dist, hann_window, block_index, block.get());
+
+			std::lock_guard<std::mutex> lock(mutex);
+			queued.erase(block_index);
+			finished[block_index] = std::move(block);
+			if (cancelled) break;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--running == 0)
+				idle.notify_all();
+		}
+
+		auto self = shared_from_this();
+		agi::dispatch::Main().Async([self] {
+			// Cancellation also happens on the GUI thread, so it can't have
+			// happened between this check and the call
+			if (!self->IsCancelled())
+				self->on_ready();
+		});
+	}
+
+	bool IsCancelled()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return cancelled;
+	}
+
+public:
+	AudioSpectrumWorker(agi::AudioProvider *provider, size_t derivation_size, size_t derivation_dist, bool hann_window, std::function<void ()> on_ready)
+	: provider(provider)
+	, derivation_size(derivation_size)
+	, derivation_dist(derivation_dist)
+	, hann_window(hann_window)
+	, on_ready(std::move(on_ready))
+	{
+	}
+
+	/// Has a block been computed and not yet taken?
+	bool IsFinished(size_t block_index)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return finished.count(block_index) != 0;
+	}
+
+	/// Get a computed block, or nullptr if it hasn't been computed
+	BlockType Take(size_t block_index)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = finished.find(block_index);
+		if (it == finished.end())
+			return nullptr;
+		auto block = std::move(it->second);
+		finished.erase(it);
+		return block;
+	}
+
+	/// Compute the given blocks in the background, skipping any which are
+	/// already queued
+	void Queue(std::vector<size_t> const& blocks)
+	{
+		std::vector<size_t> batch;
+		batch.reserve(batch_size);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t block_index : blocks)
+		{
+			if (!queued.insert(block_index).second) continue;
+			batch.push_back(block_index);
+			if (batch.size() == batch_size)
+			{
+				auto self = shared_from_this();
+				agi::dispatch::Background().Async([self, batch] { self->ComputeBatch(batch); });
+				batch.clear();
+			}
+		}
+
+		if (!batch.empty())
+		{
+			auto self = shared_from_this();
+			agi::dispatch::Background().Async([self, batch] { self->ComputeBatch(batch); });
+		}
+	}
+
+	/// Throw away computed blocks which were never taken if there are more
+	/// than max_blocks of them
+	void Trim(size_t max_blocks)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (finished.size() > max_blocks)
+			finished.clear();
+	}
+
+	/// Stop computing blocks and wait for any in progress to finish
+	void Cancel()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cancelled = true;
+		idle.wait(lock, [&] { return running == 0; });
+	}
+};
+
+AudioSpectrumCacheBlockFactory::BlockType AudioSpectrumCacheBlockFactory::ProduceBlock(size_t i)
+{
+	if (auto block = spectrum->worker->Take(i))
+		return block;
+
+	auto res = new float[((size_t)1)<<spectrum->derivation_size];
+	spectrum->FillBlock(i, res);
+	return BlockType(res);
+}
+
 AudioSpectrumRenderer::AudioSpectrumRenderer(std::string const& color_scheme_name)
 {
 	colors.reserve(AudioStyle_MAX);
@@ -100,40 +424,27 @@ AudioSpectrumRenderer::~AudioSpectrumRenderer()
 
 void AudioSpectrumRenderer::RecreateCache()
 {
-#ifdef WITH_FFTW3
-	if (dft_plan)
-	{
-		fftw_destroy_plan(dft_plan);
-		fftw_free(dft_input);
-		fftw_free(dft_output);
-		dft_plan = nullptr;
-		dft_input = nullptr;
-		dft_output = nullptr;
-	}
-#endif
+	cache.reset();
+	RecreateWorker();
 
 	if (provider)
 	{
 		size_t block_count = (size_t)((provider->GetNumSamples() + ((size_t)1<<derivation_dist) - 1) >> derivation_dist);
 		cache = agi::make_unique<AudioSpectrumCache>(block_count, this);
+	}
+}
 
-#ifdef WITH_FFTW3
-		dft_input = fftw_alloc_real(2<<derivation_size);
-		dft_output = fftw_alloc_complex(2<<derivation_size);
-		dft_plan = fftw_plan_dft_r2c_1d(
-			2<<derivation_size,
-			dft_input,
-			dft_output,
-			FFTW_MEASURE);
-#else
-		// Allocate scratch for 6x the derivation size:
-		// 2x for the input sample data
-		// 2x for the real part of the output
-		// 2x for the imaginary part of the output
-		fft_scratch.resize(6 << derivation_size);
-#endif
-		audio_scratch.resize(2 << derivation_size);
+void AudioSpectrumRenderer::RecreateWorker()
+{
+	if (worker)
+	{
+		worker->Cancel();
+		worker.reset();
 	}
+
+	if (provider)
+		worker = std::make_shared<AudioSpectrumWorker>(provider, derivation_size, derivation_dist, hann_window,
+			[this] { AnnounceBlocksReady(); });
 }
 
 void AudioSpectrumRenderer::OnSetProvider()
@@ -147,7 +458,10 @@ void AudioSpectrumRenderer::SetResolution(size_t _derivation_size, size_t _deriv
 	{
 		derivation_dist = _derivation_dist;
 		if (cache)
+		{
 			cache->Age(0);
+			RecreateWorker();
+		}
 	}
 
 	if (derivation_size != _derivation_size)
@@ -157,11 +471,14 @@ void AudioSpectrumRenderer::SetResolution(size_t _derivation_size, size_t _deriv
 	}
 }
 
-template<class T>
-void AudioSpectrumRenderer::ConvertToFloat(size_t count, T *dest) {
-	for (size_t si = 0; si < count; ++si)
+void AudioSpectrumRenderer::SetHannWindow(bool enable)
+{
+	if (hann_window == enable) return;
+	hann_window = enable;
+	if (cache)
 	{
-		dest[si] = (T)(audio_scratch[si]) / 32768.0;
+		cache->Age(0);
+		RecreateWorker();
 	}
 }
 
@@ -170,43 +487,43 @@ void AudioSpectrumRenderer::FillBlock(size_t block_index, float *block)
 	assert(cache);
 	assert(block);
 
-	int64_t first_sample = (((int64_t)block_index) << derivation_dist) - ((int64_t)1 << derivation_size);
-	provider->GetInt16MonoAudio(audio_scratch.data(), first_sample, 2 << derivation_size);
-
-#ifdef WITH_FFTW3
-	ConvertToFloat(2 << derivation_size, dft_input);
-
-	fftw_execute(dft_plan);
+	ComputeBlock(*provider, derivation_size, derivation_dist, hann_window, block_index, block);
+}
 
-	double scale_factor = 9 / sqrt(2 << (derivation_size + 1));
+size_t AudioSpectrumRenderer::BlockForPixel(int64_t x) const
+{
+	return (size_t)(x * pixel_ms * provider->GetSampleRate() / 1000) >> derivation_dist;
+}
 
-	fftw_complex *o = dft_output;
-	for (size_t si = (size_t)1<<derivation_size; si > 0; --si)
+bool AudioSpectrumRenderer::CanRender(int64_t start, int64_t count) const
+{
+	if (!AudioRendererBitmapProvider::CanRender(start, count))
+		return false;
+	if (!cache)
+		return true;
+
+	// Only one block is used per column of pixels, so check the blocks for
+	// the columns covering the range rather than every block in it
+	const double samples_per_pixel = pixel_ms * provider->GetSampleRate() / 1000;
+	const auto first_x = static_cast<int64_t>(start / samples_per_pixel);
+	const auto last_x = static_cast<int64_t>((start + count - 1) / samples_per_pixel);
+	const size_t block_count = (size_t)((provider->GetNumSamples() + ((size_t)1<<derivation_dist) - 1) >> derivation_dist);
+
+	std::vector<size_t> missing;
+	size_t last_block = SIZE_MAX;
+	for (int64_t x = first_x; x <= last_x; ++x)
 	{
-		*block++ = log10( sqrt(o[0][0] * o[0][0] + o[0][1] * o[0][1]) * scale_factor + 1 );
-		o++;
+		const size_t block_index = BlockForPixel(x);
+		if (block_index == last_block || block_index >= block_count) continue;
+		last_block = block_index;
+		if (!cache->Contains(block_index) && !worker->IsFinished(block_index))
+			missing.push_back(block_index);
 	}
-#else
-	ConvertToFloat(2 << derivation_size, &fft_scratch[0]);
-
-	float *fft_input = &fft_scratch[0];
-	float *fft_real = &fft_scratch[0] + (2 << derivation_size);
-	float *fft_imag = &fft_scratch[0] + (4 << derivation_size);
-
-	FFT fft;
-	fft.Transform(2<<derivation_size, fft_input, fft_real, fft_imag);
-
-	float scale_factor = 9 / sqrt(2 * (float)(2<<derivation_size));
 
-	for (size_t si = 1<<derivation_size; si > 0; --si)
-	{
-		// With x in range [0;1], log10(x*9+1) will also be in range [0;1],
-		// although the FFT output can apparently get greater magnitudes than 1
-		// despite the input being limited to [-1;+1).
-		*block++ = log10( sqrt(*fft_real * *fft_real + *fft_imag * *fft_imag) * scale_factor + 1 );
-		fft_real++; fft_imag++;
-	}
-#endif
+	if (missing.empty())
+		return true;
+	worker->Queue(missing);
+	return false;
 }
 
 void AudioSpectrumRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle style)
@@ -237,8 +554,7 @@ void AudioSpectrumRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 	for (int ax = start; ax < end; ++ax)
 	{
 		// Derived audio data
-		size_t block_index = (size_t)(ax * pixel_ms * provider->GetSampleRate() / 1000) >> derivation_dist;
-		float *power = &cache->Get(block_index);
+		float *power = &cache->Get(BlockForPixel(ax));
 
 		// Prepare bitmap writing
 		unsigned char *px = imgdata + (imgheight-1) * stride + (ax - start) * 3;
@@ -293,5 +609,10 @@ void AudioSpectrumRenderer::RenderBlank(wxDC &dc, const wxRect &rect, AudioRende
 void AudioSpectrumRenderer::AgeCache(size_t max_size)
 {
 	if (cache)
+	{
 		cache->Age(max_size);
+		// Anything still waiting to be moved into the cache after a render is
+		// for somewhere which wasn't drawn, so it counts towards the limit too
+		worker->Trim(max_size / (sizeof(float) << derivation_size));
+	}
 }
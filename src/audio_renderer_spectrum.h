@@ -37,14 +37,13 @@
 #include <memory>
 #include <vector>
 
-#include "audio_renderer.h"
+#include <libaegisub/signal.h>
 
-#ifdef WITH_FFTW3
-#include <fftw3.h>
-#endif
+#include "audio_renderer.h"
 
 class AudioColorScheme;
 class AudioSpectrumCache;
+class AudioSpectrumWorker;
 struct AudioSpectrumCacheBlockFactory;
 
 /// @class AudioSpectrumRenderer
@@ -58,6 +57,12 @@ class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	/// Internal cache management for the spectrum
 	std::unique_ptr<AudioSpectrumCache> cache;
 
+	/// Computes blocks which are about to be rendered on background threads
+	std::shared_ptr<AudioSpectrumWorker> worker;
+
+	/// Some blocks computed in the background are ready to be rendered
+	agi::signal::Signal<> AnnounceBlocksReady;
+
 	/// Colour tables used for rendering
 	std::vector<AudioColorScheme> colors;
 
@@ -67,6 +72,9 @@ class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	/// Binary logarithm of number of samples between the start of derivations
 	size_t derivation_dist = 0;
 
+	/// Apply a Hann window to the samples before deriving
+	bool hann_window = false;
+
 	/// @brief Reset in response to changing audio provider
 	///
 	/// Overrides the OnSetProvider event handler in the base class, to reset things
@@ -79,31 +87,19 @@ class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	/// e.g. new audio provider or new resolution.
 	void RecreateCache();
 
+	/// @brief Replace the background worker
+	///
+	/// To be called whenever the blocks it would compute have changed. Waits
+	/// for anything the old worker is in the middle of computing.
+	void RecreateWorker();
+
 	/// @brief Fill a block with frequency-power data for a time range
 	/// @param      block_index Index of the block to fill data for
 	/// @param[out] block       Address to write the data to
 	void FillBlock(size_t block_index, float *block);
 
-	/// @brief Convert audio data to float range [-1;+1)
-	/// @param count Samples to convert
-	/// @param dest Buffer to fill
-	template<class T>
-	void ConvertToFloat(size_t count, T *dest);
-
-#ifdef WITH_FFTW3
-	/// FFTW plan data
-	fftw_plan dft_plan = nullptr;
-	/// Pre-allocated input array for FFTW
-	double *dft_input = nullptr;
-	/// Pre-allocated output array for FFTW
-	fftw_complex *dft_output = nullptr;
-#else
-	/// Pre-allocated scratch area for doing FFT derivations
-	std::vector<float> fft_scratch;
-#endif
-
-	/// Pre-allocated scratch area for storing raw audio data
-	std::vector<int16_t> audio_scratch;
+	/// @brief Get the index of the block used for a column of pixels
+	size_t BlockForPixel(int64_t x) const;
 
 public:
 	/// @brief Constructor
@@ -122,6 +118,13 @@ public:
 	/// @brief Render blank area
 	void RenderBlank(wxDC &dc, const wxRect &rect, AudioRenderingStyle style) override;
 
+	/// @brief Have all of the blocks needed for a range been computed?
+	///
+	/// Any which haven't are queued to be computed in the background, and
+	/// listeners added with AddBlocksReadyListener are notified on the GUI
+	/// thread as they become available.
+	bool CanRender(int64_t start, int64_t count) const override;
+
 	/// @brief Set the derivation resolution
 	/// @param derivation_size Binary logarithm of number of samples to use in deriving frequency-power data
 	/// @param derivation_dist Binary logarithm of number of samples between the start of derivations
@@ -133,7 +136,15 @@ public:
 	/// is specified too large, it will be clamped to the size.
 	void SetResolution(size_t derivation_size, size_t derivation_dist);
 
+	/// @brief Set whether to apply a Hann window to the samples before deriving
+	///
+	/// This reduces the leakage of strong frequencies into the bins around
+	/// them, which makes the spectrum look less smeared.
+	void SetHannWindow(bool enable);
+
 	/// @brief Cleans up the cache
 	/// @param max_size Maximum size in bytes for the cache
 	void AgeCache(size_t max_size) override;
+
+	DEFINE_SIGNAL_ADDERS(AnnounceBlocksReady, AddBlocksReadyListener)
 };
@@ -32,6 +32,7 @@
 #include "audio_colorscheme.h"
 #include "options.h"
 
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/audio/provider.h>
 
 #include <algorithm>
@@ -83,27 +84,44 @@ void AudioWaveformRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 	wxPen pen_peaks(wxPen(pal->get(0.4f)));
 	wxPen pen_avgs(wxPen(pal->get(0.7f)));
 
+	// When zoomed out far enough, use the provider's precomputed peaks rather
+	// than scanning every sample
+	const agi::AudioPeakIndex *peaks = provider->GetPeakIndex();
+	const int64_t max_bucket = MaxPeakBucket();
+
 	for (int x = 0; x < rect.width; ++x)
 	{
-		provider->GetInt16MonoAudio(reinterpret_cast<int16_t*>(audio_buffer.get()), (int64_t)cur_sample, (int64_t)pixel_samples);
-		cur_sample += pixel_samples;
-
 		int peak_min = 0, peak_max = 0;
 		int64_t avg_min_accum = 0, avg_max_accum = 0;
-		auto aud = reinterpret_cast<const int16_t *>(audio_buffer.get());
-		for (int si = pixel_samples; si > 0; --si, ++aud)
+
+		agi::AudioPeak peak;
+		if (peaks && peaks->Get((int64_t)cur_sample, (int64_t)pixel_samples, max_bucket, peak))
 		{
-			if (*aud > 0)
-			{
-				peak_max = std::max(peak_max, (int)*aud);
-				avg_max_accum += *aud;
-			}
-			else
+			peak_min = peak.min;
+			peak_max = peak.max;
+			avg_min_accum = (int64_t)(peak.avg_min * pixel_samples);
+			avg_max_accum = (int64_t)(peak.avg_max * pixel_samples);
+		}
+		else
+		{
+			provider->GetInt16MonoAudio(reinterpret_cast<int16_t*>(audio_buffer.get()), (int64_t)cur_sample, (int64_t)pixel_samples);
+
+			auto aud = reinterpret_cast<const int16_t *>(audio_buffer.get());
+			for (int si = pixel_samples; si > 0; --si, ++aud)
 			{
-				peak_min = std::min(peak_min, (int)*aud);
-				avg_min_accum += *aud;
+				if (*aud > 0)
+				{
+					peak_max = std::max(peak_max, (int)*aud);
+					avg_max_accum += *aud;
+				}
+				else
+				{
+					peak_min = std::min(peak_min, (int)*aud);
+					avg_min_accum += *aud;
+				}
 			}
 		}
+		cur_sample += pixel_samples;
 
 		// midpoint is half height
 		peak_min = std::max((int)(peak_min * amplitude_scale * midpoint) / 0x8000, -midpoint);
@@ -128,6 +146,25 @@ void AudioWaveformRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 	dc.DrawLine(0, midpoint, rect.width, midpoint);
 }
 
+int64_t AudioWaveformRenderer::MaxPeakBucket() const
+{
+	// Requiring a few buckets per pixel keeps the error from rounding out to
+	// whole buckets from being visible
+	return (int64_t)(pixel_ms * provider->GetSampleRate() / 1000.0) / 4;
+}
+
+bool AudioWaveformRenderer::CanRender(int64_t start, int64_t count) const
+{
+	if (provider->IsRangeDecoded(start, count)) return true;
+
+	// Peaks loaded from a previous session are available before decoding
+	// has even started, but are only any use when zoomed out
+	const agi::AudioPeakIndex *peaks = provider->GetPeakIndex();
+	return peaks
+		&& MaxPeakBucket() >= (int64_t(1) << agi::AudioPeakIndex::level_bits[0])
+		&& peaks->IsComplete(start, count);
+}
+
 void AudioWaveformRenderer::RenderBlank(wxDC &dc, const wxRect &rect, AudioRenderingStyle style)
 {
 	const AudioColorScheme *pal = &colors[style];
@@ -49,6 +49,10 @@ class AudioWaveformRenderer final : public AudioRendererBitmapProvider {
 	void OnSetProvider() override { audio_buffer.reset(); }
 	void OnSetMillisecondsPerPixel() override { audio_buffer.reset(); }
 
+	/// Largest bucket of the provider's peak index which is fine enough for
+	/// the current zoom level
+	int64_t MaxPeakBucket() const;
+
 public:
 	/// @brief Constructor
 	/// @param color_scheme_name Name of the color scheme to use
@@ -66,6 +70,9 @@ public:
 	/// @brief Render blank area
 	void RenderBlank(wxDC &dc, const wxRect &rect, AudioRenderingStyle style) override;
 
+	/// @brief Can the range be rendered from decoded audio or saved peaks?
+	bool CanRender(int64_t start, int64_t count) const override;
+
 	/// @brief Cleans up the cache
 	/// @param max_size Maximum size in bytes for the cache
 	///
@@ -157,6 +157,20 @@ public:
 		}
 	}
 
+	/// @brief Check whether a block is in the cache
+	/// @param i Index of the block to look for
+	/// @return true if Get would return the block without creating it
+	///
+	/// Unlike Get, this does not count as a use of the block for aging.
+	bool Contains(size_t i) const
+	{
+		size_t mbi = i >> MacroblockExponent;
+		assert(mbi < data.size());
+
+		auto const& blocks = data[mbi].blocks;
+		return !blocks.empty() && blocks[i & macroblock_index_mask] != nullptr;
+	}
+
 	/// @brief Obtain a data block from the cache
 	/// @param      i       Index of the block to retrieve
 	/// @param[out] created On return, tells whether the returned block was created during the operation
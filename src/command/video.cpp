@@ -201,6 +201,11 @@ namespace {
             STR_DISP("Close Video")
             STR_HELP("Close the currently open video file")
 
+            bool Validate(const agi::Context* c) override {
+            // Also cancels video being opened in the background
+            return c->project->VideoProvider() || c->project->IsLoadingVideo();
+        }
+
             void operator()(agi::Context* c) override {
             c->project->CloseVideo();
         }
@@ -63,6 +63,14 @@ void ShowVideoDetailsDialog(agi::Context *c) {
 		framecount, agi::Time(fps.TimeAtFrame(framecount - 1)).GetAssFormatted(true)));
 	make_field(_("Decoder:"), to_wx(provider->GetDecoderName()));
 
+	VideoCacheStats stats;
+	if (provider->GetCacheStats(stats)) {
+		const uint64_t requests = stats.hits + stats.misses;
+		make_field(_("Frame cache:"), fmt_tl("%d frames, %.1f of %.1f MB, %.1f%% hits",
+			stats.frames, stats.size / 1048576.0, stats.max_size / 1048576.0,
+			requests ? 100.0 * stats.hits / requests : 0.0));
+	}
+
 	auto video_sizer = new wxStaticBoxSizer(wxVERTICAL, &d, _("Video"));
 	video_sizer->Add(fg);
 
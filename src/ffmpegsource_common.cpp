@@ -41,14 +41,17 @@
 #include "utils.h"
 
 #include <libaegisub/background_runner.h>
+#include <libaegisub/dispatch.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/path.h>
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/crc.hpp>
 #include <boost/filesystem/path.hpp>
+#include <mutex>
 #include <wx/intl.h>
 #include <wx/choicdlg.h>
+#include <wx/thread.h>
 
 #if FFMS_VERSION < ((2 << 24) | (22 << 16) | (0 << 8) | 0)
 enum {
@@ -64,6 +67,31 @@ enum {
 };
 #endif
 
+namespace {
+std::mutex IndexCacheLock;
+/// Indexes currently in use by a provider, by the name of their cache file
+std::map<agi::fs::path, std::weak_ptr<FFMS_Index>> IndexCache;
+
+/// Check if an index has everything needed by a GetIndex() call
+bool IndexCovers(FFMS_Index *Index, FFMS_Indexer *Indexer, int Track, bool WithAudio, FFMS_IndexErrorHandling IndexEH) {
+	if (Track >= 0 && FFMS_GetNumFrames(FFMS_GetTrackFromIndex(Index, Track)) <= 0)
+		return false;
+
+	if (!WithAudio && (Track < 0 || FFMS_GetTrackTypeI(Indexer, Track) != FFMS_TYPE_AUDIO))
+		return true;
+
+	// Audio indexed with a different error handling mode has to be redone
+#if FFMS_VERSION >= ((2 << 24) | (17 << 16) | (2 << 8) | 0)
+	if (FFMS_GetErrorHandling(Index) != IndexEH)
+		return false;
+#endif
+
+	return !WithAudio
+		|| FFMS_GetFirstTrackOfType(Index, FFMS_TYPE_AUDIO, nullptr) < 0
+		|| FFMS_GetFirstIndexedTrackOfType(Index, FFMS_TYPE_AUDIO, nullptr) >= 0;
+}
+}
+
 FFmpegSourceProvider::FFmpegSourceProvider(agi::BackgroundRunner *br)
 : br(br)
 {
@@ -73,10 +101,11 @@ FFmpegSourceProvider::FFmpegSourceProvider(agi::BackgroundRunner *br)
 /// @brief Does indexing of a source file
 /// @param Indexer		A pointer to the indexer object representing the file to be indexed
 /// @param CacheName    The filename of the output index file
-/// @param Trackmask    A binary mask of the track numbers to index
+/// @param Track        A track to index in addition to the video tracks, or -1 for none
+/// @param AllAudio     Index every audio track
 FFMS_Index *FFmpegSourceProvider::DoIndexing(FFMS_Indexer *Indexer,
 	                                         agi::fs::path const& CacheName,
-	                                         TrackSelection Track,
+	                                         int Track, bool AllAudio,
 	                                         FFMS_IndexErrorHandling IndexEH) {
 	char FFMSErrMsg[1024];
 	FFMS_ErrorInfo ErrInfo;
@@ -96,18 +125,18 @@ FFMS_Index *FFmpegSourceProvider::DoIndexing(FFMS_Indexer *Indexer,
 			return ps->IsCancelled();
 		};
 #if FFMS_VERSION >= ((2 << 24) | (21 << 16) | (0 << 8) | 0)
-		if (Track == TrackSelection::All)
+		if (AllAudio)
 			FFMS_TrackTypeIndexSettings(Indexer, FFMS_TYPE_AUDIO, 1, 0);
-		else if (Track != TrackSelection::None)
-			FFMS_TrackIndexSettings(Indexer, static_cast<int>(Track), 1, 0);
+		else if (Track >= 0)
+			FFMS_TrackIndexSettings(Indexer, Track, 1, 0);
 		FFMS_SetProgressCallback(Indexer, callback, ps);
 		Index = FFMS_DoIndexing2(Indexer, IndexEH, &ErrInfo);
 #else
 		int Trackmask = 0;
-		if (Track == TrackSelection::All)
+		if (AllAudio)
 			Trackmask = std::numeric_limits<int>::max();
-		else if (Track != TrackSelection::None)
-			Trackmask = 1 << static_cast<int>(Track);
+		else if (Track >= 0)
+			Trackmask = 1 << Track;
 		Index = FFMS_DoIndexing(Indexer, Trackmask, 0,
 			nullptr, nullptr, IndexEH, callback, ps, &ErrInfo);
 #endif
@@ -122,6 +151,75 @@ FFMS_Index *FFmpegSourceProvider::DoIndexing(FFMS_Indexer *Indexer,
 	return Index;
 }
 
+/// @brief Get an index for a file, shared with any other provider using the same one
+/// @param Indexer   The indexer object for the file, which is consumed
+/// @param filename  The file being opened
+/// @param Track     A track which must be indexed, or -1 for just the video tracks
+/// @param WithAudio Whether the audio tracks should be indexed too
+///
+/// Any index already in use by another provider for the file is reused if
+/// it covers the requested tracks, followed by the one in the index cache.
+/// If neither does, the file is indexed once for every track needed, so that
+/// when the video provider asks for the audio as well, opening the audio
+/// from the same file doesn't read it all again.
+std::shared_ptr<FFMS_Index> FFmpegSourceProvider::GetIndex(FFMS_Indexer *Indexer,
+	                                                       agi::fs::path const& filename,
+	                                                       int Track, bool WithAudio) {
+	char FFMSErrMsg[1024];
+	FFMS_ErrorInfo ErrInfo;
+	ErrInfo.Buffer		= FFMSErrMsg;
+	ErrInfo.BufferSize	= sizeof(FFMSErrMsg);
+	ErrInfo.ErrorType	= FFMS_ERROR_SUCCESS;
+	ErrInfo.SubType		= FFMS_ERROR_SUCCESS;
+
+	auto CacheName = GetCacheFilename(filename);
+	FFMS_IndexErrorHandling IndexEH = GetErrorHandlingMode();
+
+	std::shared_ptr<FFMS_Index> Index;
+	{
+		std::lock_guard<std::mutex> lock(IndexCacheLock);
+		auto it = IndexCache.find(CacheName);
+		if (it != IndexCache.end())
+			Index = it->second.lock();
+	}
+	if (Index && !IndexCovers(Index.get(), Indexer, Track, WithAudio, IndexEH))
+		Index.reset();
+
+	// try to read index
+	if (!Index) {
+		if (FFMS_Index *CachedIndex = FFMS_ReadIndex(CacheName.string().c_str(), &ErrInfo))
+			Index.reset(CachedIndex, FFMS_DestroyIndex);
+		if (Index && FFMS_IndexBelongsToFile(Index.get(), filename.string().c_str(), &ErrInfo))
+			Index.reset();
+		if (Index && !IndexCovers(Index.get(), Indexer, Track, WithAudio, IndexEH))
+			Index.reset();
+	}
+
+	// moment of truth
+	if (Index)
+		FFMS_CancelIndexing(Indexer);
+	else {
+		bool AllAudio = WithAudio || OPT_GET("Provider/FFmpegSource/Index All Tracks")->GetBool();
+		Index.reset(DoIndexing(Indexer, CacheName, Track, AllAudio, IndexEH), FFMS_DestroyIndex);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(IndexCacheLock);
+		for (auto it = IndexCache.begin(); it != IndexCache.end(); ) {
+			if (it->second.expired())
+				it = IndexCache.erase(it);
+			else
+				++it;
+		}
+		IndexCache[CacheName] = Index;
+	}
+
+	// update access time of index file so it won't get cleaned away
+	agi::fs::Touch(CacheName);
+
+	return Index;
+}
+
 /// @brief Finds all tracks of the given type and return their track numbers and respective codec names
 /// @param Indexer	The indexer object representing the source file
 /// @param Type		The track type to look for
@@ -156,10 +254,20 @@ FFmpegSourceProvider::AskForTrackSelection(const std::map<int, std::string> &Tra
 		TrackNumbers.push_back(track.first);
 	}
 
-	int Choice = wxGetSingleChoiceIndex(
-		Type == FFMS_TYPE_VIDEO ? _("Multiple video tracks detected, please choose the one you wish to load:") : _("Multiple audio tracks detected, please choose the one you wish to load:"),
-		Type == FFMS_TYPE_VIDEO ? _("Choose video track") : _("Choose audio track"),
-		Choices);
+	int Choice = -1;
+	auto ask = [&] {
+		Choice = wxGetSingleChoiceIndex(
+			Type == FFMS_TYPE_VIDEO ? _("Multiple video tracks detected, please choose the one you wish to load:") : _("Multiple audio tracks detected, please choose the one you wish to load:"),
+			Type == FFMS_TYPE_VIDEO ? _("Choose video track") : _("Choose audio track"),
+			Choices);
+	};
+
+	// Video may be being opened in the background, and dialogs can only be
+	// shown from the GUI thread
+	if (wxThread::IsMain())
+		ask();
+	else
+		agi::dispatch::Main().Sync(ask);
 
 	if (Choice < 0)
 		return TrackSelection::None;
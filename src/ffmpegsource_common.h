@@ -34,6 +34,7 @@
 
 #ifdef WITH_FFMS2
 #include <map>
+#include <memory>
 
 #include <ffms.h>
 
@@ -55,15 +56,16 @@ public:
 #undef None
 
 	enum class TrackSelection : int {
-		None = -1,
-		All = -2
+		None = -1
 	};
 
 	void CleanCache();
 
 	FFMS_Index *DoIndexing(FFMS_Indexer *Indexer, agi::fs::path const& Cachename,
-		                   TrackSelection Track,
+		                   int Track, bool AllAudio,
 		                   FFMS_IndexErrorHandling IndexEH);
+	std::shared_ptr<FFMS_Index> GetIndex(FFMS_Indexer *Indexer, agi::fs::path const& filename,
+		                                 int Track, bool WithAudio);
 	std::map<int, std::string> GetTracksOfType(FFMS_Indexer *Indexer, FFMS_TrackType Type);
 	TrackSelection AskForTrackSelection(const std::map<int, std::string>& TrackList, FFMS_TrackType Type);
 	agi::fs::path GetCacheFilename(agi::fs::path const& filename);
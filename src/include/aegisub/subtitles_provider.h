@@ -38,16 +38,33 @@
 #include <string>
 #include <vector>
 
-class AssFile;
+class AssAttachment;
+class AssSnapshot;
 struct VideoFrame;
 
 class SubtitlesProvider {
 	std::vector<char> buffer;
 	virtual void LoadSubtitles(const char *data, size_t len)=0;
+	/// Replace the events of the last file loaded with the ones in data,
+	/// keeping its script info, styles and fonts
+	/// @return false if the provider can only load whole files
+	virtual bool LoadEvents(const char *, size_t) { return false; }
+	/// Use the given font attachments for the file about to be loaded
+	/// @return false if the fonts should be included in the file instead
+	virtual bool LoadFonts(std::vector<const AssAttachment *> const&) { return false; }
 
 public:
 	virtual ~SubtitlesProvider() = default;
-	void LoadSubtitles(AssFile *subs, int time = -1);
+
+	/// @brief Load a subtitle file
+	/// @param subs File to load
+	/// @param time If not -1, only load the lines visible at this time
+	/// @param events_only Only the events have changed since the last file
+	///                    was loaded, so the rest of it can be kept
+	///
+	/// Lines using a style which doesn't exist are rendered with the Default
+	/// style.
+	void LoadSubtitles(AssSnapshot const& subs, int time = -1, bool events_only = false);
 	virtual void DrawSubtitles(VideoFrame &dst, double time)=0;
 	virtual void Reinitialize() { }
 };
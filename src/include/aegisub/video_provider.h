@@ -37,10 +37,20 @@
 #include <libaegisub/exception.h>
 #include <libaegisub/vfr.h>
 
+#include <cstdint>
 #include <string>
 
 struct VideoFrame;
 
+/// Usage statistics of a video frame cache
+struct VideoCacheStats {
+	uint64_t hits = 0;     ///< Number of requests served from the cache
+	uint64_t misses = 0;   ///< Number of requests which had to be decoded
+	size_t frames = 0;     ///< Number of frames currently cached
+	size_t size = 0;       ///< Bytes currently used by the cache
+	size_t max_size = 0;   ///< Maximum bytes the cache may use
+};
+
 class VideoProvider {
 public:
 	virtual ~VideoProvider() = default;
@@ -48,6 +58,10 @@ public:
 	/// Override this method to actually get frames
 	virtual void GetFrame(int n, VideoFrame &frame)=0;
 
+	/// Decode a frame into the frame cache in anticipation of it being
+	/// requested soon. Does nothing if there is no cache.
+	virtual void PrefetchFrame(int) { }
+
 	/// Set the YCbCr matrix to the specified one
 	///
 	/// Providers are free to disregard this, and should if the requested
@@ -83,6 +97,12 @@ public:
 
 	/// Does the file which this provider is reading have an audio track?
 	virtual bool HasAudio() const { return false; }
+
+	/// Get the statistics of the frame cache in front of the decoder, if any
+	/// @return false if there is no cache
+	///
+	/// May be called from a different thread than GetFrame().
+	virtual bool GetCacheStats(VideoCacheStats &) const { return false; }
 };
 
 DEFINE_EXCEPTION(VideoProviderError, agi::Exception);
@@ -73,7 +73,8 @@ void General(wxTreebook *book, Preferences *parent) {
 	wxString autoload_modes[] = { _("Never"), _("Always"), _("Ask") };
 	wxArrayString autoload_modes_arr(3, autoload_modes);
 	p->OptionChoice(general, _("Automatically load linked files"), autoload_modes_arr, "App/Auto/Load Linked Files");
-	p->OptionAdd(general, _("Undo Levels"), "Limits/Undo Levels", 2, 10000);
+	p->OptionAdd(general, _("Undo memory (MB)"), "Limits/Undo Memory", 1, 4096);
+	p->OptionAdd(general, _("Undo disk space (MB)"), "Limits/Undo Disk Space", 0, 65536);
 
 	auto recent = p->PageSizer(_("Recently Used Lists"));
 	p->OptionAdd(recent, _("Files"), "Limits/MRU", 0, 16);
@@ -178,6 +179,8 @@ void Video(wxTreebook *book, Preferences *parent) {
 	p->CellSkip(general);
 	p->OptionAdd(general, _("Automatically open audio when opening video"), "Video/Open Audio");
 	p->CellSkip(general);
+	p->OptionAdd(general, _("Open video in the background"), "Video/Open In Background");
+	p->CellSkip(general);
 
 	const wxString czoom_arr[24] = { "12.5%", "25%", "37.5%", "50%", "62.5%", "75%", "87.5%", "100%", "112.5%", "125%", "137.5%", "150%", "162.5%", "175%", "187.5%", "200%", "212.5%", "225%", "237.5%", "250%", "262.5%", "275%", "287.5%", "300%" };
 	wxArrayString choice_zoom(24, czoom_arr);
@@ -391,12 +394,18 @@ void Advanced_Audio(wxTreebook *book, Preferences *parent) {
 	wxArrayString ct_choice(3, ct_arr);
 	p->OptionChoice(cache, _("Cache type"), ct_choice, "Audio/Cache/Type");
 	p->OptionBrowse(cache, _("Path"), "Audio/Cache/HD/Location");
+	p->OptionAdd(cache, _("Hard disk cache size (MB)"), "Audio/Cache/HD/Size", 0, INT_MAX, 256);
+	wxControl* cache_files = p->OptionAdd(cache, _("Hard disk cache files"), "Audio/Cache/HD/Files", 0, INT_MAX);
+	cache_files->SetToolTip("Maximum number of audio files to keep cached on disk. 0 for no limit.");
+	wxControl* cache_downmix = p->OptionAdd(cache, _("Cache as 16-bit mono"), "Audio/Cache/Downmix");
+	cache_downmix->SetToolTip("Greatly reduces the size of the cache for surround and floating point audio.\nDisable to let audio players which support it play the original channels.");
 
 	auto spectrum = p->PageSizer(_("Spectrum"));
 
 	const wxString sq_arr[4] = { _("Regular quality"), _("Better quality"), _("High quality"), _("Insane quality") };
 	wxArrayString sq_choice(4, sq_arr);
 	p->OptionChoice(spectrum, _("Quality"), sq_choice, "Audio/Renderer/Spectrum/Quality");
+	p->OptionAdd(spectrum, _("Smooth with a Hann window"), "Audio/Renderer/Spectrum/Hann Window");
 
 	p->OptionAdd(spectrum, _("Cache memory max (MB)"), "Audio/Renderer/Spectrum/Memory Max", 2, 1024);
 
@@ -457,6 +466,9 @@ void Advanced_Video(wxTreebook *book, Preferences *parent) {
 	wxArrayString sp_choice = to_wx(SubtitlesProviderFactory::GetClasses());
 	p->OptionChoice(expert, _("Subtitles provider"), sp_choice, "Subtitle/Provider");
 
+	wxControl* prefetch = p->OptionAdd(expert, _("Frames to read ahead"), "Provider/Video/Cache/Prefetch", 0, 240);
+	prefetch->SetToolTip("Number of frames to decode in advance while idle when stepping or playing through the video. Limited to half of the video frame cache.");
+
 #ifdef WITH_AVISYNTH
 	auto avisynth = p->PageSizer("Avisynth");
 	p->OptionAdd(avisynth, _("Allow pre-2.56a Avisynth"), "Provider/Avisynth/Allow Ancient");
@@ -27,6 +27,7 @@
 #include "dialog_progress.h"
 #include "dialogs.h"
 #include "format.h"
+#include "frame_main.h"
 #include "include/aegisub/context.h"
 #include "include/aegisub/video_provider.h"
 #include "mkv_wrap.h"
@@ -38,6 +39,8 @@
 #include "video_display.h"
 
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/background_runner.h>
+#include <libaegisub/dispatch.h>
 #include <libaegisub/format_path.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/keyframe.h>
@@ -47,10 +50,107 @@
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <atomic>
 #include <wx/msgdlg.h>
 
+/// @class VideoLoadProgress
+/// @brief Progress reporting for video opened in the background
+///
+/// Tasks run as part of a background load run on the loading thread, with
+/// their progress shown in the status bar, and are cancelled when the load is
+/// superseded or the video is closed. Anything else, such as libass waiting
+/// for its font cache from the GUI thread once the video is open, still gets
+/// the modal progress dialog.
+class VideoLoadProgress final : public agi::BackgroundRunner, public std::enable_shared_from_this<VideoLoadProgress> {
+	agi::Context *context;
+	DialogProgress *dialog;
+	/// Incremented whenever a load is started or cancelled
+	std::atomic<unsigned> generation{0};
+
+	/// The load running on the calling thread, or 0
+	static unsigned& CurrentLoad() {
+		static thread_local unsigned load = 0;
+		return load;
+	}
+
+	class Sink final : public agi::ProgressSink {
+		std::shared_ptr<VideoLoadProgress> owner;
+		unsigned load;
+		std::string title, message;
+		int64_t percent = -1;
+
+		void Update() {
+			wxString text = to_wx(title.empty() ? message : message.empty() ? title : title + ": " + message);
+			if (percent >= 0)
+				text += wxString::Format(" (%d%%)", (int)percent);
+			owner->ShowStatus(load, text);
+		}
+
+	public:
+		Sink(std::shared_ptr<VideoLoadProgress> owner, unsigned load) : owner(std::move(owner)), load(load) { }
+
+		void SetIndeterminate() override { percent = -1; Update(); }
+		void SetTitle(std::string const& t) override { title = t; Update(); }
+		void SetMessage(std::string const& m) override { message = m; Update(); }
+		void SetProgress(int64_t cur, int64_t max) override {
+			int64_t p = max > 0 ? cur * 100 / max : -1;
+			if (p == percent) return;
+			percent = p;
+			Update();
+		}
+		void Log(std::string const& str) override { LOG_I("video/open") << str; }
+		bool IsCancelled() override { return !owner->IsCurrent(load); }
+	};
+
+public:
+	VideoLoadProgress(agi::Context *context, DialogProgress *dialog) : context(context), dialog(dialog) { }
+
+	/// Start a new load, cancelling any previous one
+	unsigned Start() { return ++generation; }
+	/// Cancel the current load
+	void Cancel() { ++generation; }
+	/// Is the given load still wanted?
+	bool IsCurrent(unsigned load) const { return generation == load; }
+
+	/// Run a function on the calling thread as part of a load
+	void RunLoad(unsigned load, std::function<void ()> const& func) {
+		CurrentLoad() = load;
+		try {
+			func();
+		}
+		catch (...) {
+			CurrentLoad() = 0;
+			throw;
+		}
+		CurrentLoad() = 0;
+	}
+
+	/// Show a message in the status bar if the load is still current
+	void ShowStatus(unsigned load, wxString const& text) {
+		auto self = shared_from_this();
+		agi::dispatch::Main().Async([=] {
+			// The project cancels its load when it is destroyed, so the
+			// context is still valid if this one is current
+			if (self->IsCurrent(load) && self->context->frame)
+				self->context->frame->StatusTimeout(text);
+		});
+	}
+
+	void Run(std::function<void (agi::ProgressSink *)> task) override {
+		unsigned load = CurrentLoad();
+		if (!load)
+			return dialog->Run(task);
+
+		Sink ps(shared_from_this(), load);
+		task(&ps);
+		if (ps.IsCancelled())
+			throw agi::UserCancelException("Opening video cancelled");
+	}
+};
+
 Project::Project(agi::Context* c) : context(c) {
 	OPT_SUB("Audio/Cache/Type", &Project::ReloadAudio, this);
+	OPT_SUB("Audio/Cache/Downmix", &Project::ReloadAudio, this);
 	OPT_SUB("Audio/Provider", &Project::ReloadAudio, this);
 	OPT_SUB("Provider/Audio/FFmpegSource/Decode Error Handling", &Project::ReloadAudio, this);
 	OPT_SUB("Provider/Audio/FFmpegSource/Downmix", &Project::ReloadAudio, this);
@@ -62,7 +162,9 @@ Project::Project(agi::Context* c) : context(c) {
 	OPT_SUB("Video/Provider", &Project::ReloadVideo, this);
 }
 
-Project::~Project() { }
+Project::~Project() {
+	CancelVideoLoad();
+}
 
 void Project::UpdateRelativePaths() {
 	context->ass->Properties.audio_file = context->path->MakeRelative(audio_file, "?script").generic_string();
@@ -244,9 +346,10 @@ void Project::DoLoadAudio(agi::fs::path const& path, bool quiet) {
 	if (!progress)
 		progress = new DialogProgress(context->parent);
 
+	std::unique_ptr<agi::AudioProvider> provider;
 	try {
 		try {
-			audio_provider = GetAudioProvider(path, *context->path, progress);
+			provider = GetAudioProvider(path, *context->path, progress);
 		}
 		catch (agi::UserCancelException const&) { return; }
 		catch (...) {
@@ -272,6 +375,12 @@ void Project::DoLoadAudio(agi::fs::path const& path, bool quiet) {
 		return ShowError(e.GetMessage());
 	}
 
+	// Background work such as the spectrum reads from the old provider, and
+	// is only stopped when the provider in use changes
+	if (audio_provider)
+		AnnounceAudioProviderModified(nullptr);
+	audio_provider = std::move(provider);
+
 	SetPath(audio_file, "?audio", "Audio", path);
 	AnnounceAudioProviderModified(audio_provider.get());
 }
@@ -286,13 +395,9 @@ void Project::CloseAudio() {
 	SetPath(audio_file, "?audio", "", "");
 }
 
-bool Project::DoLoadVideo(agi::fs::path const& path) {
-	if (!progress)
-		progress = new DialogProgress(context->parent);
-
+bool Project::OpenVideo(agi::fs::path const& path, std::function<void ()> const& open) {
 	try {
-		auto old_matrix = context->ass->GetScriptInfo("YCbCr Matrix");
-		video_provider = agi::make_unique<AsyncVideoProvider>(path, old_matrix, context->videoController.get(), progress);
+		open();
 	}
 	catch (agi::UserCancelException const&) { return false; }
 	catch (agi::fs::FileSystemError const& err) {
@@ -304,7 +409,27 @@ bool Project::DoLoadVideo(agi::fs::path const& path) {
 		ShowError(to_wx(err.GetMessage()));
 		return false;
 	}
+	return true;
+}
+
+bool Project::DoLoadVideo(agi::fs::path const& path) {
+	CancelVideoLoad();
+	if (!progress)
+		progress = new DialogProgress(context->parent);
+
+	std::unique_ptr<AsyncVideoProvider> provider;
+	auto old_matrix = context->ass->GetScriptInfo("YCbCr Matrix");
+	if (!OpenVideo(path, [&] {
+		provider = agi::make_unique<AsyncVideoProvider>(path, old_matrix, context->videoController.get(), progress);
+	}))
+		return false;
 
+	FinishLoadVideo(path, std::move(provider));
+	return true;
+}
+
+void Project::FinishLoadVideo(agi::fs::path const& path, std::unique_ptr<AsyncVideoProvider> provider) {
+	video_provider = std::move(provider);
 	AnnounceVideoProviderModified(video_provider.get());
 
 	UpdateVideoProperties(context->ass.get(), video_provider.get(), context->parent);
@@ -327,15 +452,61 @@ bool Project::DoLoadVideo(agi::fs::path const& path) {
 
 	AnnounceKeyframesModified(keyframes);
 	AnnounceTimecodesModified(timecodes);
-	return true;
 }
 
-void Project::LoadVideo(agi::fs::path path) {
-	if (path.empty()) return;
-	if (!DoLoadVideo(path)) return;
-	if (OPT_GET("Video/Open Audio")->GetBool() && audio_file != video_file && video_provider->HasAudio())
-		DoLoadAudio(video_file, true);
+void Project::LoadVideoInBackground(agi::fs::path const& path) {
+	CancelVideoLoad();
+	if (!progress)
+		progress = new DialogProgress(context->parent);
+	if (!video_load_progress)
+		video_load_progress = std::make_shared<VideoLoadProgress>(context, progress);
+
+	auto runner = video_load_progress;
+	auto load = pending_video_load = runner->Start();
+	if (context->frame)
+		context->frame->StatusTimeout(fmt_tl("Opening %s in the background", path.filename()));
+
+	struct Result {
+		std::unique_ptr<AsyncVideoProvider> provider;
+		std::exception_ptr error;
+	};
+	auto result = std::make_shared<Result>();
+	auto matrix = context->ass->GetScriptInfo("YCbCr Matrix");
+	auto parent = context->videoController.get();
 
+	agi::dispatch::Background().Async([=] {
+		try {
+			runner->RunLoad(load, [&] {
+				result->provider = agi::make_unique<AsyncVideoProvider>(path, matrix, parent, runner.get());
+			});
+		}
+		catch (...) {
+			result->error = std::current_exception();
+		}
+
+		agi::dispatch::Main().Async([=] {
+			// Superseded, closed, or the project is gone
+			if (!runner->IsCurrent(load)) return;
+			pending_video_load = 0;
+
+			if (!OpenVideo(path, [&] { if (result->error) std::rethrow_exception(result->error); }))
+				return;
+			FinishLoadVideo(path, std::move(result->provider));
+
+			if (OPT_GET("Video/Open Audio")->GetBool() && audio_file != video_file && video_provider->HasAudio())
+				DoLoadAudio(video_file, true);
+			ResetVideoView();
+		});
+	});
+}
+
+void Project::CancelVideoLoad() {
+	if (!pending_video_load) return;
+	video_load_progress->Cancel();
+	pending_video_load = 0;
+}
+
+void Project::ResetVideoView() {
 	double dar = video_provider->GetDAR();
 	if (dar > 0)
 		context->videoController->SetAspectRatio(dar);
@@ -344,7 +515,19 @@ void Project::LoadVideo(agi::fs::path path) {
 	context->videoController->JumpToFrame(0);
 }
 
+void Project::LoadVideo(agi::fs::path path) {
+	if (path.empty()) return;
+	if (OPT_GET("Video/Open In Background")->GetBool())
+		return LoadVideoInBackground(path);
+
+	if (!DoLoadVideo(path)) return;
+	if (OPT_GET("Video/Open Audio")->GetBool() && audio_file != video_file && video_provider->HasAudio())
+		DoLoadAudio(video_file, true);
+	ResetVideoView();
+}
+
 void Project::CloseVideo() {
+	CancelVideoLoad();
 	AnnounceVideoProviderModified(nullptr);
 	video_provider.reset();
 	SetPath(video_file, "?video", "", "");
@@ -518,12 +701,7 @@ void Project::LoadList(std::vector<agi::fs::path> const& files) {
 		DoLoadAudio(audio, false);
 
 	if (!video.empty() && DoLoadVideo(video)) {
-		double dar = video_provider->GetDAR();
-		if (dar > 0)
-			context->videoController->SetAspectRatio(dar);
-		else
-			context->videoController->SetAspectRatio(AspectRatio::Default);
-		context->videoController->JumpToFrame(0);
+		ResetVideoView();
 
 		// We loaded these earlier, but loading video unloaded them
 		// Non-Do version of Load in case they've vanished or changed between
@@ -19,17 +19,25 @@
 #include <libaegisub/vfr.h>
 
 #include <boost/filesystem/path.hpp>
+#include <functional>
 #include <memory>
 #include <vector>
 
 class AsyncVideoProvider;
 class DialogProgress;
+class VideoLoadProgress;
 class wxString;
 namespace agi { class AudioProvider; }
 namespace agi { struct Context; }
 struct ProjectProperties;
 
 class Project {
+	/// Progress reporting for video opened in the background; declared before
+	/// the provider as the provider may hold on to it
+	std::shared_ptr<VideoLoadProgress> video_load_progress;
+	/// Load number of the video being opened in the background, or 0
+	unsigned pending_video_load = 0;
+
 	std::unique_ptr<agi::AudioProvider> audio_provider;
 	std::unique_ptr<AsyncVideoProvider> video_provider;
 	agi::vfr::Framerate timecodes;
@@ -55,6 +63,11 @@ class Project {
 	bool DoLoadSubtitles(agi::fs::path const& path, std::string encoding, ProjectProperties &properties);
 	void DoLoadAudio(agi::fs::path const& path, bool quiet);
 	bool DoLoadVideo(agi::fs::path const& path);
+	bool OpenVideo(agi::fs::path const& path, std::function<void ()> const& open);
+	void FinishLoadVideo(agi::fs::path const& path, std::unique_ptr<AsyncVideoProvider> provider);
+	void LoadVideoInBackground(agi::fs::path const& path);
+	void CancelVideoLoad();
+	void ResetVideoView();
 	void DoLoadTimecodes(agi::fs::path const& path);
 	void DoLoadKeyframes(agi::fs::path const& path);
 
@@ -80,6 +93,7 @@ public:
 
 	void LoadVideo(agi::fs::path path);
 	void CloseVideo();
+	bool IsLoadingVideo() const { return pending_video_load != 0; }
 	AsyncVideoProvider *VideoProvider() const { return video_provider.get(); }
 	agi::fs::path const& VideoName() const { return video_file; }
 
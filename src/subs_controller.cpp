@@ -20,6 +20,7 @@
 #include "ass_dialogue.h"
 #include "ass_file.h"
 #include "ass_info.h"
+#include "ass_snapshot.h"
 #include "ass_style.h"
 #include "compat.h"
 #include "command/command.h"
@@ -31,13 +32,20 @@
 #include "selection_controller.h"
 #include "subtitle_format.h"
 #include "text_selection_controller.h"
+#include "undo_spill.h"
 
 #include <libaegisub/dispatch.h>
 #include <libaegisub/format_path.h>
 #include <libaegisub/fs.h>
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
 #include <libaegisub/util.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
 #include <wx/msgdlg.h>
 
 namespace {
@@ -48,43 +56,354 @@ namespace {
 		else
 			timer->Stop();
 	}
+
+	using EventBlock = AssSnapshot::Block;
+	using ScriptInfo = std::vector<std::pair<std::string, std::string>>;
+
+	bool SameStyle(AssStyle const& a, AssStyle const& b) {
+		return a.GetEntryData() == b.GetEntryData();
+	}
+
+	bool SameAttachment(AssAttachment const& a, AssAttachment const& b) {
+		return a.Group() == b.Group() && a.GetSharedEntryData() == b.GetSharedEntryData();
+	}
+
+	bool SameExtradata(ExtradataEntry const& a, ExtradataEntry const& b) {
+		return a.id == b.id && a.key == b.key && a.value == b.value;
+	}
+
+	// Rough estimates of the memory used by each part of an undo state.
+	// Attachments aren't counted since their data is in flyweights shared
+	// with the open file.
+	size_t Bytes(ScriptInfo const& info) {
+		size_t bytes = 0;
+		for (auto const& line : info)
+			bytes += sizeof(line) + line.first.size() + line.second.size();
+		return bytes;
+	}
+
+	size_t Bytes(std::vector<AssStyle> const& styles) {
+		size_t bytes = 0;
+		for (auto const& style : styles)
+			bytes += sizeof(style) + style.GetEntryData().size();
+		return bytes;
+	}
+
+	size_t Bytes(EventBlock const& block) {
+		size_t bytes = 0;
+		for (auto const& line : block)
+			bytes += sizeof(line) + line.Text.get().size();
+		return bytes;
+	}
+
+	size_t Bytes(std::vector<ExtradataEntry> const& extradata) {
+		size_t bytes = 0;
+		for (auto const& entry : extradata)
+			bytes += sizeof(entry) + entry.key.size() + entry.value.size();
+		return bytes;
+	}
+
+	// Serialization of the parts of undo states for the undo history file.
+	// The file is only ever read back by the process which wrote it, so this
+	// doesn't need to be portable.
+	void Write(std::string& out, uint32_t value) {
+		out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+
+	void Write(std::string& out, std::string const& str) {
+		Write(out, (uint32_t)str.size());
+		out += str;
+	}
+
+	class Reader {
+		const char *pos;
+		const char *end;
+
+		void Check(size_t size) {
+			if ((size_t)(end - pos) < size)
+				throw UndoSpillError("Truncated undo history entry");
+		}
+
+	public:
+		Reader(std::string const& data) : pos(data.data()), end(data.data() + data.size()) { }
+
+		uint32_t Int() {
+			uint32_t value;
+			Check(sizeof(value));
+			memcpy(&value, pos, sizeof(value));
+			pos += sizeof(value);
+			return value;
+		}
+
+		std::string String() {
+			uint32_t size = Int();
+			Check(size);
+			std::string str(pos, size);
+			pos += size;
+			return str;
+		}
+	};
+
+	std::string SerializeInfo(ScriptInfo const& info) {
+		std::string out;
+		Write(out, (uint32_t)info.size());
+		for (auto const& line : info) {
+			Write(out, line.first);
+			Write(out, line.second);
+		}
+		return out;
+	}
+
+	std::shared_ptr<ScriptInfo> DeserializeInfo(std::string const& data) {
+		Reader in(data);
+		auto info = std::make_shared<ScriptInfo>(in.Int());
+		for (auto& line : *info) {
+			line.first = in.String();
+			line.second = in.String();
+		}
+		return info;
+	}
+
+	std::string SerializeStyles(std::vector<AssStyle> const& styles) {
+		std::string out;
+		Write(out, (uint32_t)styles.size());
+		for (auto const& style : styles)
+			Write(out, style.GetEntryData());
+		return out;
+	}
+
+	std::shared_ptr<std::vector<AssStyle>> DeserializeStyles(std::string const& data) {
+		Reader in(data);
+		auto styles = std::make_shared<std::vector<AssStyle>>();
+		auto count = in.Int();
+		styles->reserve(count);
+		for (size_t i = 0; i < count; ++i)
+			styles->emplace_back(in.String());
+		return styles;
+	}
+
+	std::string SerializeEvents(EventBlock const& block) {
+		std::string out;
+		Write(out, (uint32_t)block.size());
+		for (auto const& line : block) {
+			Write(out, (uint32_t)line.Id);
+			Write(out, (uint32_t)line.Row);
+			Write(out, (uint32_t)line.Comment);
+			Write(out, (uint32_t)line.Layer);
+			for (int margin : line.Margin)
+				Write(out, (uint32_t)margin);
+			Write(out, (uint32_t)(int)line.Start);
+			Write(out, (uint32_t)(int)line.End);
+			Write(out, line.Style);
+			Write(out, line.Actor);
+			Write(out, line.Effect);
+			Write(out, (uint32_t)line.ExtradataIds.get().size());
+			for (uint32_t id : line.ExtradataIds.get())
+				Write(out, id);
+			Write(out, line.Text);
+		}
+		return out;
+	}
+
+	std::shared_ptr<EventBlock> DeserializeEvents(std::string const& data) {
+		Reader in(data);
+		auto block = std::make_shared<EventBlock>(in.Int());
+		for (auto& line : *block) {
+			line.Id = (int)in.Int();
+			line.Row = (int)in.Int();
+			line.Comment = !!in.Int();
+			line.Layer = (int)in.Int();
+			for (int& margin : line.Margin)
+				margin = (int)in.Int();
+			line.Start = (int)in.Int();
+			line.End = (int)in.Int();
+			line.Style = in.String();
+			line.Actor = in.String();
+			line.Effect = in.String();
+			std::vector<uint32_t> ids(in.Int());
+			for (auto& id : ids)
+				id = in.Int();
+			line.ExtradataIds = std::move(ids);
+			line.Text = in.String();
+		}
+		return block;
+	}
+
+	std::string SerializeExtradata(std::vector<ExtradataEntry> const& extradata) {
+		std::string out;
+		Write(out, (uint32_t)extradata.size());
+		for (auto const& entry : extradata) {
+			Write(out, entry.id);
+			Write(out, entry.key);
+			Write(out, entry.value);
+		}
+		return out;
+	}
+
+	std::shared_ptr<std::vector<ExtradataEntry>> DeserializeExtradata(std::string const& data) {
+		Reader in(data);
+		auto extradata = std::make_shared<std::vector<ExtradataEntry>>(in.Int());
+		for (auto& entry : *extradata) {
+			entry.id = in.Int();
+			entry.key = in.String();
+			entry.value = in.String();
+		}
+		return extradata;
+	}
 }
 
+/// A state of the file which can be returned to
+///
+/// Each part of the file, and each block of lines, is held by a shared
+/// pointer and reused from the previous state if it hasn't changed, so an
+/// edit to a single line of a large file with lots of fonts only costs one
+/// block of lines. Every state still has everything needed to rebuild the
+/// file by itself.
+///
+/// Old states can be spilled to the undo history file to free up memory,
+/// and have to be loaded back before they can be applied.
 struct SubsController::UndoInfo {
 	wxString undo_description;
 	int commit_id;
 
-	std::vector<std::pair<std::string, std::string>> script_info;
-	std::vector<AssStyle> styles;
-	std::vector<AssDialogueBase> events;
-	std::vector<AssAttachment> attachments;
-	std::vector<ExtradataEntry> extradata;
+	std::shared_ptr<const ScriptInfo> script_info;
+	std::shared_ptr<const std::vector<AssStyle>> styles;
+	AssSnapshot::Blocks events;
+	std::shared_ptr<const std::vector<AssAttachment>> attachments;
+	std::shared_ptr<const std::vector<ExtradataEntry>> extradata;
+
+	/// Where the parts are in the undo history file if this state has been
+	/// spilled. Attachments stay in memory as they're shared with the file.
+	std::shared_ptr<UndoSpillFile::Chunk> spilled_script_info;
+	std::shared_ptr<UndoSpillFile::Chunk> spilled_styles;
+	std::vector<std::shared_ptr<UndoSpillFile::Chunk>> spilled_events;
+	std::shared_ptr<UndoSpillFile::Chunk> spilled_extradata;
+
+	/// Estimated bytes of memory used by parts which aren't shared with the
+	/// states before this one
+	size_t memory = 0;
 
 	mutable std::vector<int> selection;
 	int active_line_id = 0;
 	int pos = 0, sel_start = 0, sel_end = 0;
 
-	UndoInfo(const agi::Context *c, wxString const& d, int commit_id)
+	/// @param prev The previous state, if any, to share unchanged parts with
+	/// @param type Commit type, for skipping comparing the lines when none
+	///             of them can have changed
+	UndoInfo(const agi::Context *c, wxString const& d, int commit_id, UndoInfo const *prev, int type)
 	: undo_description(d)
 	, commit_id(commit_id)
-	, attachments(c->ass->Attachments)
-	, extradata(c->ass->Extradata)
 	{
-		script_info.reserve(c->ass->Info.size());
-		for (auto const& info : c->ass->Info)
-			script_info.emplace_back(info.Key(), info.Value());
+		if (prev && !prev->IsLoaded())
+			prev = nullptr;
+
+		ScriptInfo info;
+		info.reserve(c->ass->Info.size());
+		for (auto const& line : c->ass->Info)
+			info.emplace_back(line.Key(), line.Value());
+		if (prev && *prev->script_info == info)
+			script_info = prev->script_info;
+		else
+			script_info = std::make_shared<ScriptInfo>(std::move(info));
+
+		styles = AssSnapshot::Share(prev ? prev->styles : nullptr, c->ass->Styles, SameStyle);
+		attachments = AssSnapshot::Share(prev ? prev->attachments : nullptr, c->ass->Attachments, SameAttachment);
+		extradata = AssSnapshot::Share(prev ? prev->extradata : nullptr, c->ass->Extradata, SameExtradata);
 
-		styles.reserve(c->ass->Styles.size());
-		styles.assign(c->ass->Styles.begin(), c->ass->Styles.end());
+		// Commits which can't have touched any lines don't need to compare them
+		const int lines = AssFile::COMMIT_ORDER | AssFile::COMMIT_DIAG_ADDREM
+			| AssFile::COMMIT_DIAG_FULL | AssFile::COMMIT_EXTRADATA;
+		if (prev && type != AssFile::COMMIT_NEW && !(type & lines))
+			events = prev->events;
+		else
+			events = AssSnapshot::ShareEvents(c->ass->Events, prev ? &prev->events : nullptr);
 
-		events.reserve(c->ass->Events.size());
-		events.assign(c->ass->Events.begin(), c->ass->Events.end());
+		memory = UnsharedBytes(prev);
 
 		UpdateActiveLine(c);
 		UpdateSelection(c);
 		UpdateTextSelection(c);
 	}
 
+	/// Replace the stored copy of a line
+	void UpdateLine(AssDialogue const& line) {
+		for (auto& block : events) {
+			auto it = std::find_if(block->begin(), block->end(), [&](AssDialogueBase const& d) { return d.Id == line.Id; });
+			if (it == block->end()) continue;
+
+			// The block may be shared with other states
+			if (block.use_count() > 1)
+				memory += Bytes(*block);
+			auto copy = std::make_shared<EventBlock>(*block);
+			(*copy)[it - block->begin()] = line;
+			block = std::move(copy);
+			return;
+		}
+	}
+
+	bool IsLoaded() const { return !!styles; }
+
+	/// Estimated bytes of memory used by parts which aren't shared with another state
+	size_t UnsharedBytes(UndoInfo const *other) const {
+		size_t bytes = 0;
+		if (!other || script_info != other->script_info)
+			bytes += Bytes(*script_info);
+		if (!other || styles != other->styles)
+			bytes += Bytes(*styles);
+		if (!other || extradata != other->extradata)
+			bytes += Bytes(*extradata);
+		for (size_t i = 0; i < events.size(); ++i) {
+			if (!other || i >= other->events.size() || events[i] != other->events[i])
+				bytes += Bytes(*events[i]);
+		}
+		return bytes;
+	}
+
+	/// Write this state to the undo history file and free its parts
+	void Spill(UndoSpillFile& file) {
+		// Write everything before touching anything so that this state is
+		// left as it was if writing fails
+		auto info_chunk = file.Store(script_info, SerializeInfo);
+		auto styles_chunk = file.Store(styles, SerializeStyles);
+		auto extradata_chunk = file.Store(extradata, SerializeExtradata);
+		std::vector<std::shared_ptr<UndoSpillFile::Chunk>> event_chunks;
+		event_chunks.reserve(events.size());
+		for (auto const& block : events)
+			event_chunks.push_back(file.Store(block, SerializeEvents));
+
+		spilled_script_info = std::move(info_chunk);
+		spilled_styles = std::move(styles_chunk);
+		spilled_extradata = std::move(extradata_chunk);
+		spilled_events = std::move(event_chunks);
+		script_info.reset();
+		styles.reset();
+		extradata.reset();
+		events = decltype(events)();
+		memory = 0;
+	}
+
+	/// Read this state back from the undo history file
+	/// @param next The state after this one, to share parts with
+	void Load(UndoSpillFile& file, UndoInfo const *next) {
+		auto info = file.Load<ScriptInfo>(spilled_script_info, DeserializeInfo);
+		auto loaded_styles = file.Load<std::vector<AssStyle>>(spilled_styles, DeserializeStyles);
+		auto loaded_extradata = file.Load<std::vector<ExtradataEntry>>(spilled_extradata, DeserializeExtradata);
+		decltype(events) loaded_events;
+		loaded_events.reserve(spilled_events.size());
+		for (auto const& chunk : spilled_events)
+			loaded_events.push_back(file.Load<EventBlock>(chunk, DeserializeEvents));
+
+		script_info = std::move(info);
+		styles = std::move(loaded_styles);
+		extradata = std::move(loaded_extradata);
+		events = std::move(loaded_events);
+		spilled_script_info.reset();
+		spilled_styles.reset();
+		spilled_extradata.reset();
+		spilled_events.clear();
+		memory = UnsharedBytes(next && next->IsLoaded() ? next : nullptr);
+	}
+
 	void Apply(agi::Context *c) const {
 		// Keep old dialogue lines alive until after the commit is complete
 		// since a bunch of stuff holds references to them
@@ -100,20 +419,22 @@ struct SubsController::UndoInfo {
 		AssDialogue *active_line = nullptr;
 		Selection new_sel;
 
-		for (auto const& info : script_info)
-			c->ass->Info.push_back(*new AssInfo(info.first, info.second));
-		for (auto const& style : styles)
+		for (auto const& info : *script_info)
+			c->ass->Info.emplace_back(info.first, info.second);
+		for (auto const& style : *styles)
 			c->ass->Styles.push_back(*new AssStyle(style));
-		c->ass->Attachments = attachments;
-		for (auto const& event : events) {
-			auto copy = new AssDialogue(event);
-			c->ass->Events.push_back(*copy);
-			if (copy->Id == active_line_id)
-				active_line = copy;
-			if (binary_search(begin(selection), end(selection), copy->Id))
-				new_sel.insert(copy);
+		c->ass->Attachments = *attachments;
+		for (auto const& block : events) {
+			for (auto const& event : *block) {
+				auto copy = new AssDialogue(event);
+				c->ass->Events.push_back(*copy);
+				if (copy->Id == active_line_id)
+					active_line = copy;
+				if (binary_search(begin(selection), end(selection), copy->Id))
+					new_sel.insert(copy);
+			}
 		}
-		c->ass->Extradata = extradata;
+		c->ass->Extradata = *extradata;
 
 		c->ass->Commit("", AssFile::COMMIT_NEW);
 		c->selectionController->SetSelectionAndActive(std::move(new_sel), active_line);
@@ -147,6 +468,7 @@ SubsController::SubsController(agi::Context *context)
 : context(context)
 , undo_connection(context->ass->AddUndoManager(&SubsController::OnCommit, this))
 , text_selection_connection(context->textSelectionController->AddSelectionListener(&SubsController::OnTextSelectionChanged, this))
+, undo_spill(agi::make_unique<UndoSpillFile>(context->path->Decode("?temp")))
 , autosave_queue(agi::dispatch::Create())
 {
 	autosave_timer_changed(&autosave_timer);
@@ -316,12 +638,7 @@ void SubsController::OnCommit(AssFileCommit c) {
 	if (commit_id == *c.commit_id+1 && redo_stack.empty() && saved_commit_id+1 != commit_id) {
 		// If only one line changed just modify it instead of copying the file
 		if (c.single_line && c.single_line->Group() == AssEntryGroup::DIALOGUE) {
-			for (auto& diag : undo_stack.back().events) {
-				if (diag.Id == c.single_line->Id) {
-					diag = *c.single_line;
-					break;
-				}
-			}
+			undo_stack.back().UpdateLine(*c.single_line);
 			*c.commit_id = commit_id;
 			return;
 		}
@@ -330,20 +647,19 @@ void SubsController::OnCommit(AssFileCommit c) {
 	}
 
 	// Make sure the file has at least one style and one dialogue line
+	int type = c.type;
 	if (context->ass->Styles.empty())
 		context->ass->Styles.push_back(*new AssStyle);
 	if (context->ass->Events.empty()) {
 		context->ass->Events.push_back(*new AssDialogue);
 		context->ass->Events.back().Row = 0;
+		type |= AssFile::COMMIT_DIAG_ADDREM;
 	}
 
 	redo_stack.clear();
 
-	undo_stack.emplace_back(context, c.message, commit_id);
-
-	int depth = std::max<int>(OPT_GET("Limits/Undo Levels")->GetInt(), 2);
-	while ((int)undo_stack.size() > depth)
-		undo_stack.pop_front();
+	undo_stack.emplace_back(context, c.message, commit_id, undo_stack.empty() ? nullptr : &undo_stack.back(), type);
+	TrimUndoStack();
 
 	if (undo_stack.size() > 1 && OPT_GET("App/Auto/Save on Every Change")->GetBool() && !filename.empty() && CanSave())
 		Save(filename);
@@ -351,6 +667,59 @@ void SubsController::OnCommit(AssFileCommit c) {
 	*c.commit_id = commit_id;
 }
 
+void SubsController::TrimUndoStack() {
+	const size_t memory_limit = (size_t)std::max<int64_t>(OPT_GET("Limits/Undo Memory")->GetInt(), 1) << 20;
+	const uint64_t disk_limit = (uint64_t)std::max<int64_t>(OPT_GET("Limits/Undo Disk Space")->GetInt(), 0) << 20;
+
+	size_t used = 0;
+	for (auto const& state : undo_stack)
+		used += state.memory;
+	for (auto const& state : redo_stack)
+		used += state.memory;
+
+	// Push the oldest states out of memory until the rest fit, always keeping
+	// the current state and the one before it so that undoing once is quick
+	auto stop = undo_stack.size() > 2 ? std::prev(undo_stack.end(), 2) : undo_stack.begin();
+	for (auto it = undo_stack.begin(); used > memory_limit && it != stop; ) {
+		auto next = std::next(it);
+		if (!it->IsLoaded()) {
+			it = next;
+			continue;
+		}
+
+		// Whatever this state shares with the next one stays in memory, and
+		// is now only used by the next one
+		const size_t shared = it->UnsharedBytes(nullptr) - it->UnsharedBytes(&*next);
+		const size_t freed = it->memory - std::min(it->memory, shared);
+		next->memory += shared;
+		used -= std::min(used, freed);
+
+		if (disk_limit > 0) {
+			try {
+				it->Spill(*undo_spill);
+				it = next;
+				continue;
+			}
+			catch (agi::Exception const& e) {
+				LOG_E("subs_controller") << "Could not save undo history to disk: " << e.GetMessage();
+			}
+		}
+
+		// Nothing older than a state which was dropped is any use
+		it = undo_stack.erase(undo_stack.begin(), next);
+	}
+
+	while (undo_spill->LiveSize() > disk_limit && !undo_stack.front().IsLoaded())
+		undo_stack.pop_front();
+
+	try {
+		undo_spill->Compact();
+	}
+	catch (agi::Exception const& e) {
+		LOG_E("subs_controller") << "Could not compact undo history: " << e.GetMessage();
+	}
+}
+
 void SubsController::OnActiveLineChanged() {
 	if (!undo_stack.empty())
 		undo_stack.back().UpdateActiveLine(context);
@@ -370,6 +739,20 @@ void SubsController::Undo() {
 	if (undo_stack.size() <= 1) return;
 	redo_stack.splice(redo_stack.end(), undo_stack, std::prev(undo_stack.end()));
 
+	if (!undo_stack.back().IsLoaded()) {
+		try {
+			undo_stack.back().Load(*undo_spill, &redo_stack.back());
+		}
+		catch (agi::Exception const& e) {
+			LOG_E("subs_controller") << "Could not read undo history: " << e.GetMessage();
+			// None of the spilled states can be trusted to be readable now
+			undo_stack.splice(undo_stack.end(), redo_stack, std::prev(redo_stack.end()));
+			while (!undo_stack.front().IsLoaded())
+				undo_stack.pop_front();
+			return;
+		}
+	}
+
 	commit_id = undo_stack.back().commit_id;
 
 	text_selection_connection.Block();
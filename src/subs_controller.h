@@ -28,6 +28,7 @@ namespace agi {
 	}
 	struct Context;
 }
+class UndoSpillFile;
 struct AssFileCommit;
 struct ProjectProperties;
 
@@ -38,6 +39,10 @@ class SubsController {
 	agi::signal::Connection selection_connection;
 	agi::signal::Connection text_selection_connection;
 
+	/// Compressed storage on disk for undo states which don't fit in memory.
+	/// Has to outlive the undo states.
+	std::unique_ptr<UndoSpillFile> undo_spill;
+
 	struct UndoInfo;
 	boost::container::list<UndoInfo> undo_stack;
 	boost::container::list<UndoInfo> redo_stack;
@@ -74,6 +79,9 @@ class SubsController {
 	void AutoSave();
 
 	void OnCommit(AssFileCommit c);
+	/// Spill or discard old undo states to keep within the undo memory and
+	/// disk space limits
+	void TrimUndoStack();
 	void OnActiveLineChanged();
 	void OnSelectionChanged();
 	void OnTextSelectionChanged();
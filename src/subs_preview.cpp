@@ -34,6 +34,7 @@
 
 #include "ass_dialogue.h"
 #include "ass_file.h"
+#include "ass_snapshot.h"
 #include "ass_style.h"
 #include "dialog_progress.h"
 #include "subs_preview.h"
@@ -109,7 +110,7 @@ void SubtitlesPreview::UpdateBitmap() {
 
 	if (provider) {
 		try {
-			provider->LoadSubtitles(sub_file.get());
+			provider->LoadSubtitles(AssSnapshot(*sub_file));
 			provider->DrawSubtitles(frame, 0.1);
 		}
 		catch (...) { }
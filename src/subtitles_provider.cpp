@@ -18,14 +18,16 @@
 
 #include "ass_dialogue.h"
 #include "ass_attachment.h"
-#include "ass_file.h"
 #include "ass_info.h"
+#include "ass_snapshot.h"
 #include "ass_style.h"
 #include "factory_manager.h"
 #include "options.h"
 #include "subtitles_provider_csri.h"
 #include "subtitles_provider_libass.h"
 
+#include <boost/algorithm/string/case_conv.hpp>
+
 namespace {
 	struct factory {
 		std::string name;
@@ -68,9 +70,15 @@ std::unique_ptr<SubtitlesProvider> SubtitlesProviderFactory::GetProvider(agi::Ba
 	throw error;
 }
 
-void SubtitlesProvider::LoadSubtitles(AssFile *subs, int time) {
+void SubtitlesProvider::LoadSubtitles(AssSnapshot const& subs, int time, bool events_only) {
 	buffer.clear();
 
+	std::vector<std::string> styles;
+	styles.reserve(subs.Styles->size());
+	for (auto const& style : *subs.Styles)
+		styles.push_back(boost::to_lower_copy(style.name));
+	sort(begin(styles), end(styles));
+
 	auto push_header = [&](const char *str) {
 		buffer.insert(buffer.end(), str, str + strlen(str));
 	};
@@ -78,31 +86,62 @@ void SubtitlesProvider::LoadSubtitles(AssFile *subs, int time) {
 		buffer.insert(buffer.end(), &str[0], &str[0] + str.size());
 		buffer.push_back('\n');
 	};
+	auto push_event = [&](AssDialogueBase const& line) {
+		if (binary_search(begin(styles), end(styles), boost::to_lower_copy(line.Style.get())))
+			push_line(line.GetEntryData());
+		else {
+			AssDialogueBase fixed(line);
+			fixed.Style = "Default";
+			push_line(fixed.GetEntryData());
+		}
+	};
+	auto push_events = [&] {
+		push_header("[Events]\n");
+		if (time >= 0) {
+			for (auto row : subs.RowsVisibleAt(time))
+				push_event(subs.Line(row));
+			return;
+		}
+		subs.ForEachLine([&](AssDialogueBase const& line) {
+			if (!line.Comment)
+				push_event(line);
+		});
+	};
+
+	// Serializing and parsing the fonts can take far longer than the
+	// events, so skip them when they can't have changed
+	if (events_only) {
+		push_events();
+		if (LoadEvents(&buffer[0], buffer.size()))
+			return;
+		buffer.clear();
+	}
 
 	push_header("\xEF\xBB\xBF[Script Info]\n");
-	for (auto const& line : subs->Info)
+	for (auto const& line : *subs.Info)
 		push_line(line.GetEntryData());
 
 	push_header("[V4+ Styles]\n");
-	for (auto const& line : subs->Styles)
+	for (auto const& line : *subs.Styles)
 		push_line(line.GetEntryData());
 
-	if (!subs->Attachments.empty()) {
+	std::vector<const AssAttachment *> fonts;
+	for (auto const& attachment : *subs.Attachments) {
+		if (attachment.Group() == AssEntryGroup::FONT)
+			fonts.push_back(&attachment);
+	}
+
+	if (!LoadFonts(fonts) && !fonts.empty()) {
 		// TODO: some scripts may have a lot of attachments, 
 		// so ideally we'd want to write only those actually used on the requested video frame,
 		// but this would require some pre-parsing of the attached font files with FreeType,
 		// which isn't probably trivial.
 		push_header("[Fonts]\n");
-		for (auto const& attachment : subs->Attachments)
-			if (attachment.Group() == AssEntryGroup::FONT)
-				push_line(attachment.GetEntryData());
+		for (auto font : fonts)
+			push_line(font->GetEntryData());
 	}
 
-	push_header("[Events]\n");
-	for (auto const& line : subs->Events) {
-		if (!line.Comment && (time < 0 || !(line.Start > time || line.End <= time)))
-			push_line(line.GetEntryData());
-	}
+	push_events();
 
 	LoadSubtitles(&buffer[0], buffer.size());
 }
@@ -34,11 +34,13 @@
 
 #include "subtitles_provider_libass.h"
 
+#include "ass_attachment.h"
 #include "compat.h"
 #include "include/aegisub/subtitles_provider.h"
 #include "video_frame.h"
 #include "options.h"
 
+#include <libaegisub/alpha_blend.h>
 #include <libaegisub/background_runner.h>
 #include <libaegisub/dispatch.h>
 #include <libaegisub/exception.h>
@@ -46,14 +48,11 @@
 #include <libaegisub/make_unique.h>
 #include <libaegisub/util.h>
 
+#include <algorithm>
 #include <atomic>
-#if BOOST_VERSION >= 106900
-#include <boost/gil.hpp>
-#else
-#include <boost/gil/gil_all.hpp>
-#endif
 #include <memory>
 #include <mutex>
+#include <vector>
 
 #include <wx/intl.h>
 #include <wx/thread.h>
@@ -81,18 +80,34 @@ void msg_callback(int level, const char *fmt, va_list args, void *) {
 		LOG_D("subtitle/provider/libass") << buf;
 }
 
+ASS_Library *new_library() {
+	auto lib = ass_library_init();
+	ass_set_message_cb(lib, msg_callback, nullptr);
+	return lib;
+}
+
 // Stuff used on the cache thread, owned by a shared_ptr in case the provider
 // gets deleted before the cache finishing updating
 struct cache_thread_shared {
+	/// Each provider has its own library so that it can have its own set of
+	/// embedded fonts
+	ASS_Library *library = new_library();
 	ASS_Renderer *renderer = nullptr;
 	std::atomic<bool> ready{false};
-	~cache_thread_shared() { if (renderer) ass_renderer_done(renderer); }
+	~cache_thread_shared() {
+		if (renderer) ass_renderer_done(renderer);
+		ass_library_done(library);
+	}
 };
 
 class LibassSubtitlesProvider final : public SubtitlesProvider {
 	agi::BackgroundRunner *br;
 	std::shared_ptr<cache_thread_shared> shared;
 	ASS_Track* ass_track = nullptr;
+	/// The images of the frame being drawn, kept to reuse its allocation
+	std::vector<agi::alpha_mask> masks;
+	/// Font attachments which have been added to the library
+	std::vector<boost::flyweight<std::string>> fonts;
 
 	ASS_Renderer *renderer() {
 		if (shared->ready)
@@ -126,11 +141,68 @@ public:
 
 	void LoadSubtitles(const char *data, size_t len) override {
 		if (ass_track) ass_free_track(ass_track);
-		ass_track = ass_read_memory(library, const_cast<char *>(data), len, nullptr);
+		ass_track = ass_read_memory(shared->library, const_cast<char *>(data), len, nullptr);
 		if (!ass_track) throw agi::InternalError("libass failed to load subtitles.");
 		if (OPT_GET("Experiments/Unicode63 Bracket Matching")->GetBool()) ass_track_set_feature(ass_track, ASS_FEATURE_BIDI_BRACKETS, 1);
 	}
 
+	bool LoadEvents(const char *data, size_t len) override {
+		if (!ass_track) return false;
+		// The track is left in the [Events] section after loading a whole
+		// file, so new lines get parsed with its existing event format
+		ass_flush_events(ass_track);
+		ass_process_data(ass_track, const_cast<char *>(data), (int)len);
+		return true;
+	}
+
+	bool LoadFonts(std::vector<const AssAttachment *> const& attachments) override {
+		// Identical attachments share their data, so comparing them is
+		// cheap, and unchanged fonts don't get decoded and added again
+		std::vector<boost::flyweight<std::string>> wanted;
+		std::vector<const AssAttachment *> to_add;
+		for (auto font : attachments) {
+			auto const& data = font->GetSharedEntryData();
+			if (std::find(wanted.begin(), wanted.end(), data) != wanted.end()) continue;
+			wanted.push_back(data);
+			if (std::find(fonts.begin(), fonts.end(), data) == fonts.end())
+				to_add.push_back(font);
+		}
+		if (to_add.empty() && wanted.size() == fonts.size())
+			return true;
+
+		// The fonts mustn't change while the cache thread is setting up the
+		// initial renderer
+		renderer();
+
+		// libass can't remove fonts from a library, so start over with a new
+		// one if any are no longer wanted
+		if (fonts.size() + to_add.size() != wanted.size()) {
+			if (ass_track) ass_free_track(ass_track);
+			ass_track = nullptr;
+			ass_renderer_done(shared->renderer);
+			ass_library_done(shared->library);
+			shared->library = new_library();
+			shared->renderer = ass_renderer_init(shared->library);
+			ass_set_font_scale(shared->renderer, 1.);
+			fonts.clear();
+			to_add = attachments;
+		}
+
+		for (auto font : to_add) {
+			auto const& entry = font->GetSharedEntryData();
+			if (std::find(fonts.begin(), fonts.end(), entry) != fonts.end()) continue;
+			fonts.push_back(entry);
+
+			auto data = font->GetData();
+			if (!data.empty())
+				ass_add_font(shared->library, const_cast<char *>(font->GetFileName().c_str()), data.data(), (int)data.size());
+		}
+
+		// The renderer only picks up the library's fonts when they're set
+		ass_set_fonts(shared->renderer, nullptr, "Sans", 1, nullptr, false);
+		return true;
+	}
+
 	void DrawSubtitles(VideoFrame &dst, double time) override;
 
 	void Reinitialize() override {
@@ -139,7 +211,7 @@ public:
 			return;
 
 		ass_renderer_done(shared->renderer);
-		shared->renderer = ass_renderer_init(library);
+		shared->renderer = ass_renderer_init(shared->library);
 		ass_set_font_scale(shared->renderer, 1.);
 		ass_set_fonts(shared->renderer, nullptr, "Sans", 1, nullptr, true);
 	}
@@ -151,7 +223,7 @@ LibassSubtitlesProvider::LibassSubtitlesProvider(agi::BackgroundRunner *br)
 {
 	auto state = shared;
 	cache_queue->Async([state] {
-		auto ass_renderer = ass_renderer_init(library);
+		auto ass_renderer = ass_renderer_init(state->library);
 		if (ass_renderer) {
 			ass_set_font_scale(ass_renderer, 1.);
 			ass_set_fonts(ass_renderer, nullptr, "Sans", 1, nullptr, true);
@@ -176,35 +248,19 @@ void LibassSubtitlesProvider::DrawSubtitles(VideoFrame &frame,double time) {
 	ASS_Image* img = ass_render_frame(renderer(), ass_track, int(time * 1000), nullptr);
 
 	// libass actually returns several alpha-masked monochrome images.
-	// Here, we loop through their linked list, get the colour of the current, and blend into the frame.
-	// This is repeated for all of them.
-
-	using namespace boost::gil;
-	auto dst = interleaved_view(frame.width, frame.height, (bgra8_pixel_t*)frame.data.data(), frame.width * 4);
-	if (frame.flipped)
-		dst = flipped_up_down_view(dst);
+	// Here, we loop through their linked list, get the colour of each, and
+	// then blend them all into the frame in order, a band of rows per thread.
 
+	masks.clear();
 	for (; img; img = img->next) {
-		unsigned int opacity = 255 - ((unsigned int)_a(img->color));
-		unsigned int r = (unsigned int)_r(img->color);
-		unsigned int g = (unsigned int)_g(img->color);
-		unsigned int b = (unsigned int)_b(img->color);
-
-		auto srcview = interleaved_view(img->w, img->h, (gray8_pixel_t*)img->bitmap, img->stride);
-		auto dstview = subimage_view(dst, img->dst_x, img->dst_y, img->w, img->h);
-
-		transform_pixels(dstview, srcview, dstview, [=](const bgra8_pixel_t frame, const gray8_pixel_t src) -> bgra8_pixel_t {
-			unsigned int k = ((unsigned)src) * opacity / 255;
-			unsigned int ck = 255 - k;
-
-			bgra8_pixel_t ret;
-			ret[0] = (k * b + ck * frame[0]) / 255;
-			ret[1] = (k * g + ck * frame[1]) / 255;
-			ret[2] = (k * r + ck * frame[2]) / 255;
-			ret[3] = 0;
-			return ret;
-		});
+		if (img->w <= 0 || img->h <= 0) continue;
+		masks.push_back({img->bitmap, (size_t)img->stride, img->w, img->h, img->dst_x, img->dst_y,
+			(uint8_t)_r(img->color), (uint8_t)_g(img->color), (uint8_t)_b(img->color), (uint8_t)(255 - _a(img->color))});
 	}
+
+	const ptrdiff_t pitch = frame.flipped ? -(ptrdiff_t)frame.pitch : (ptrdiff_t)frame.pitch;
+	unsigned char *origin = frame.data.data() + (frame.flipped ? (frame.height - 1) * frame.pitch : 0);
+	agi::blend_masks(masks, origin, pitch, (int)frame.height);
 }
 }
 
@@ -0,0 +1,188 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "undo_spill.h"
+
+#include <libaegisub/fs.h>
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
+
+#include <algorithm>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <zlib.h>
+
+namespace {
+/// Compressing quickly matters more than compressing well, as this is done
+/// while committing changes
+const int compression_level = 1;
+
+std::unique_ptr<std::iostream> OpenTemp(agi::fs::path const& filename) {
+	auto file = agi::make_unique<boost::filesystem::fstream>(filename,
+		std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!file->is_open())
+		throw UndoSpillError("Could not create undo history file " + filename.string());
+#ifndef _WIN32
+	// Nothing else needs to see the file, so make sure it goes away even if
+	// we crash
+	agi::fs::Remove(filename);
+#endif
+	return file;
+}
+
+void Close(std::unique_ptr<std::iostream>& file, agi::fs::path const& filename) {
+	if (!file) return;
+	file.reset();
+#ifdef _WIN32
+	try {
+		agi::fs::Remove(filename);
+	}
+	catch (agi::fs::FileSystemError const& e) {
+		LOG_E("undo/spill") << e.GetMessage();
+	}
+#else
+	// Already removed when it was opened
+	(void)filename;
+#endif
+}
+}
+
+UndoSpillFile::Chunk::Chunk(UndoSpillFile *file, uint64_t offset, uint32_t size, uint32_t uncompressed_size)
+: file(file), offset(offset), size(size), uncompressed_size(uncompressed_size)
+{
+	file->live_size += size;
+}
+
+UndoSpillFile::Chunk::~Chunk() {
+	file->live_size -= size;
+}
+
+UndoSpillFile::UndoSpillFile(agi::fs::path directory)
+: directory(std::move(directory))
+{
+}
+
+UndoSpillFile::~UndoSpillFile() {
+	Close(file, filename);
+}
+
+void UndoSpillFile::Open(agi::fs::path const& new_filename) {
+	auto new_file = OpenTemp(new_filename);
+	Close(file, filename);
+	file = std::move(new_file);
+	filename = new_filename;
+}
+
+std::shared_ptr<UndoSpillFile::Chunk> UndoSpillFile::Write(std::string const& data) {
+	if (!file) {
+		if (!agi::fs::DirectoryExists(directory))
+			agi::fs::CreateDirectory(directory);
+		Open(boost::filesystem::unique_path(directory/"aegisub-undo-%%%%%%%%.tmp"));
+	}
+
+	uLongf compressed_size = compressBound(data.size());
+	std::vector<Bytef> compressed(compressed_size);
+	if (compress2(compressed.data(), &compressed_size, reinterpret_cast<const Bytef *>(data.data()), data.size(), compression_level) != Z_OK)
+		throw UndoSpillError("Failed to compress undo history");
+
+	file->seekp(size);
+	file->write(reinterpret_cast<const char *>(compressed.data()), compressed_size);
+	if (file->fail())
+		throw UndoSpillError("Failed to write to undo history file " + filename.string());
+
+	auto chunk = std::make_shared<Chunk>(this, size, compressed_size, data.size());
+	size += compressed_size;
+	chunks.push_back(chunk);
+	return chunk;
+}
+
+std::string UndoSpillFile::Read(Chunk const& chunk) {
+	std::vector<Bytef> compressed(chunk.size);
+	file->seekg(chunk.offset);
+	file->read(reinterpret_cast<char *>(compressed.data()), chunk.size);
+	if (file->fail()) {
+		file->clear();
+		throw UndoSpillError("Failed to read from undo history file " + filename.string());
+	}
+
+	std::string data(chunk.uncompressed_size, '\0');
+	uLongf data_size = data.size();
+	if (uncompress(reinterpret_cast<Bytef *>(&data[0]), &data_size, compressed.data(), compressed.size()) != Z_OK || data_size != data.size())
+		throw UndoSpillError("Undo history file " + filename.string() + " is corrupt");
+	return data;
+}
+
+void UndoSpillFile::Prune() {
+	chunks.erase(std::remove_if(begin(chunks), end(chunks), [](std::weak_ptr<Chunk> const& c) { return c.expired(); }), end(chunks));
+	for (auto it = begin(written); it != end(written); ) {
+		if (it->second.first.expired() || it->second.second.expired())
+			it = written.erase(it);
+		else
+			++it;
+	}
+	for (auto it = begin(loaded); it != end(loaded); ) {
+		if (it->second.first.expired() || it->second.second.expired())
+			it = loaded.erase(it);
+		else
+			++it;
+	}
+}
+
+void UndoSpillFile::Compact() {
+	if (!file || size - live_size < live_size) return;
+
+	Prune();
+	if (chunks.empty()) {
+		// Start over with an empty file the next time anything is written
+		Close(file, filename);
+		size = 0;
+		return;
+	}
+
+	auto new_filename = boost::filesystem::unique_path(directory/"aegisub-undo-%%%%%%%%.tmp");
+	auto new_file = OpenTemp(new_filename);
+
+	// Chunks are only updated once everything has been copied, so that
+	// they're still valid in the old file if this fails
+	std::vector<std::pair<std::shared_ptr<Chunk>, uint64_t>> moved;
+	moved.reserve(chunks.size());
+	uint64_t new_size = 0;
+	std::vector<char> buffer;
+	for (auto const& weak : chunks) {
+		auto chunk = weak.lock();
+		if (!chunk) continue;
+
+		buffer.resize(chunk->size);
+		file->seekg(chunk->offset);
+		file->read(buffer.data(), buffer.size());
+		new_file->write(buffer.data(), buffer.size());
+		if (file->fail() || new_file->fail()) {
+			file->clear();
+			Close(new_file, new_filename);
+			throw UndoSpillError("Failed to compact undo history file " + filename.string());
+		}
+
+		moved.emplace_back(std::move(chunk), new_size);
+		new_size += buffer.size();
+	}
+
+	for (auto& chunk : moved)
+		chunk.first->offset = chunk.second;
+	Close(file, filename);
+	file = std::move(new_file);
+	filename = new_filename;
+	size = new_size;
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <libaegisub/exception.h>
+#include <libaegisub/fs_fwd.h>
+
+#include <boost/filesystem/path.hpp>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+DEFINE_EXCEPTION(UndoSpillError, agi::Exception);
+
+/// @class UndoSpillFile
+/// @brief Compressed storage in a temporary file for undo states which have
+///        been pushed out of memory
+///
+/// Undo states share most of their parts with each other, so parts are
+/// stored by their shared pointer: storing a part which is already in the
+/// file returns the existing chunk, and loading a chunk which has already
+/// been loaded returns the part which is still in memory.
+class UndoSpillFile {
+public:
+	/// A compressed blob in the file, which stays valid for as long as
+	/// anything holds it. The file must outlive all of its chunks.
+	struct Chunk {
+		UndoSpillFile *file;
+		uint64_t offset;
+		uint32_t size;
+		uint32_t uncompressed_size;
+
+		Chunk(UndoSpillFile *file, uint64_t offset, uint32_t size, uint32_t uncompressed_size);
+		Chunk(Chunk const&) = delete;
+		~Chunk();
+	};
+
+private:
+	/// Directory to create the file in
+	agi::fs::path directory;
+	/// Path of the file, if it has been created
+	agi::fs::path filename;
+	std::unique_ptr<std::iostream> file;
+
+	/// Bytes written to the file
+	uint64_t size = 0;
+	/// Bytes in the file which belong to a chunk which still exists
+	uint64_t live_size = 0;
+
+	/// All chunks written, for compacting the file
+	std::vector<std::weak_ptr<Chunk>> chunks;
+	/// Parts which have been written, by address
+	std::unordered_map<const void *, std::pair<std::weak_ptr<const void>, std::weak_ptr<Chunk>>> written;
+	/// Parts which have been loaded, by the chunk they were loaded from
+	std::unordered_map<const Chunk *, std::pair<std::weak_ptr<Chunk>, std::weak_ptr<const void>>> loaded;
+
+	void Open(agi::fs::path const& new_filename);
+	std::shared_ptr<Chunk> Write(std::string const& data);
+	std::string Read(Chunk const& chunk);
+	/// Remove index entries for things which no longer exist
+	void Prune();
+
+public:
+	/// @param directory Directory to create the temporary file in when
+	///                  something is first written
+	UndoSpillFile(agi::fs::path directory);
+	~UndoSpillFile();
+
+	/// Write a part to the file if it isn't already there
+	/// @param part Part to store
+	/// @param serialize Function to turn the part into a string
+	template<typename T, typename Serialize>
+	std::shared_ptr<Chunk> Store(std::shared_ptr<const T> const& part, Serialize serialize) {
+		auto& entry = written[part.get()];
+		auto chunk = entry.second.lock();
+		if (chunk && entry.first.lock() == part)
+			return chunk;
+
+		chunk = Write(serialize(*part));
+		entry = {part, chunk};
+		// Loading it while it's still in memory shouldn't read it back
+		loaded[chunk.get()] = {chunk, part};
+		return chunk;
+	}
+
+	/// Read a part from the file, or get the copy of it which is already in
+	/// memory if there is one
+	/// @param chunk Chunk returned by Store()
+	/// @param deserialize Function to turn the string back into a T
+	template<typename T, typename Deserialize>
+	std::shared_ptr<const T> Load(std::shared_ptr<Chunk> const& chunk, Deserialize deserialize) {
+		auto& entry = loaded[chunk.get()];
+		if (entry.first.lock() == chunk) {
+			if (auto part = entry.second.lock())
+				return std::static_pointer_cast<const T>(part);
+		}
+
+		std::shared_ptr<const T> part = deserialize(Read(*chunk));
+		entry = {chunk, part};
+		// Storing it again shouldn't write it again
+		written[part.get()] = {part, chunk};
+		return part;
+	}
+
+	/// Bytes in the file which are still in use
+	uint64_t LiveSize() const { return live_size; }
+
+	/// Rewrite the file without the chunks which no longer exist if they take
+	/// up more than half of it
+	void Compact();
+};
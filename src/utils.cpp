@@ -157,9 +157,8 @@ void SetClipboard(wxBitmap const& new_data) {
 }
 
 void CleanCache(agi::fs::path const& directory, std::string const& file_type, uint64_t max_size, uint64_t max_files) {
-	static std::unique_ptr<agi::dispatch::Queue> queue;
-	if (!queue)
-		queue = agi::dispatch::Create();
+	// Called from both the GUI thread and background loading threads
+	static auto queue = agi::dispatch::Create();
 
 	max_size <<= 20;
 	if (max_files == 0)
@@ -76,8 +76,10 @@ void VideoController::OnSubtitlesCommit(int type, const AssDialogue *changed) {
 		}
 	}
 
-	if (!changed)
-		provider->LoadSubtitles(context->ass.get());
+	if (!changed) {
+		const int header = AssFile::COMMIT_SCRIPTINFO | AssFile::COMMIT_STYLES | AssFile::COMMIT_ATTACHMENT;
+		provider->LoadSubtitles(context->ass.get(), type != AssFile::COMMIT_NEW && !(type & header));
+	}
 	else
 		provider->UpdateSubtitles(context->ass.get(), changed);
 }
@@ -37,6 +37,12 @@ namespace {
 	};
 }
 
+agi::BufferPool& VideoFramePool() {
+	// Never destroyed, as frames may outlive any static object
+	static auto pool = new agi::BufferPool(64 << 20);
+	return *pool;
+}
+
 wxImage GetImage(VideoFrame const& frame) {
 	using namespace boost::gil;
 
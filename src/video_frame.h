@@ -14,16 +14,33 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include <libaegisub/buffer_pool.h>
+
 #include <vector>
 
 class wxImage;
 
+/// Pool which the pixels of every video frame are allocated from
+///
+/// Video providers, the frame cache and the subtitle renderers all work on
+/// frames of the same few sizes, so recycling their buffers avoids both the
+/// heap churn and the page faults of allocating a new one for each frame.
+agi::BufferPool& VideoFramePool();
+
+/// A decoded frame of 32-bit BGRA pixels
+///
+/// A frame always owns its pixels, as it's drawn on by the subtitle
+/// renderer and may be kept by the frame cache long after the decoder has
+/// moved on. Video providers convert from the decoder's buffer straight into
+/// the frame they're given, reusing its existing allocation when it's big
+/// enough, so handing a frame back to a provider is the cheap way to get the
+/// next one. Pixels are aligned to agi::BufferPool::alignment.
 struct VideoFrame {
-	std::vector<unsigned char> data;
+	std::vector<unsigned char, agi::pool_allocator<unsigned char, VideoFramePool>> data;
 	size_t width;
 	size_t height;
-	size_t pitch;
-	bool flipped;
+	size_t pitch;  ///< Bytes from the start of one row to the next
+	bool flipped;  ///< Are the rows stored bottom to top?
 };
 
 wxImage GetImage(VideoFrame const& frame);
@@ -19,9 +19,12 @@
 #include "options.h"
 #include "video_frame.h"
 
+#include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
 
+#include <atomic>
 #include <list>
+#include <unordered_map>
 
 namespace {
 /// A video frame and its frame number
@@ -33,6 +36,11 @@ struct CachedFrame {
 	: frame(frame), frame_number(frame_number) { }
 
 	CachedFrame(CachedFrame const&) = delete;
+
+	/// Memory used by this frame, including the bookkeeping for it
+	size_t Size() const {
+		return sizeof(CachedFrame) + frame.data.capacity();
+	}
 };
 
 /// @class VideoProviderCache
@@ -43,23 +51,62 @@ class VideoProviderCache final : public VideoProvider {
 
 	/// @brief Maximum size of the cache in bytes
 	///
-	/// Note that this is a soft limit. The cache stops allocating new frames
-	/// once it has exceeded the limit, but it never tries to shrink
+	/// The least recently used frames are discarded as needed to stay under
+	/// this, and frames larger than it on their own are never cached.
 	const size_t max_cache_size = OPT_GET("Provider/Video/Cache/Size")->GetInt() << 20; // convert MB to bytes
 
 	/// Cache of video frames with the most recently used ones at the front
 	std::list<CachedFrame> cache;
+	/// Position of each cached frame in the list
+	std::unordered_map<int, std::list<CachedFrame>::iterator> index;
+
+	/// Current size of everything in the cache in bytes
+	std::atomic<size_t> cache_size{0};
+	/// Number of frames in the cache, for GetCacheStats()
+	std::atomic<size_t> frame_count{0};
+	std::atomic<uint64_t> hits{0};
+	std::atomic<uint64_t> misses{0};
+
+	/// Buffer for frames decoded by PrefetchFrame()
+	VideoFrame prefetch_buffer;
+
+	/// Discard least recently used frames until the cache fits in max_size
+	void Shrink(size_t max_size);
+
+	/// Add a frame which is not yet in the cache as the most recently used
+	void Insert(int n, VideoFrame const& frame);
+
+	void Clear() {
+		cache.clear();
+		index.clear();
+		cache_size = 0;
+		frame_count = 0;
+	}
 
 public:
 	VideoProviderCache(std::unique_ptr<VideoProvider> master) : master(std::move(master)) { }
 
+	~VideoProviderCache() {
+		LOG_D("video/cache") << "Frame cache: " << hits << " hits, " << misses << " misses";
+	}
+
 	void GetFrame(int n, VideoFrame &frame) override;
+	void PrefetchFrame(int n) override;
 
 	void SetColorSpace(std::string const& m) override {
-		cache.clear();
+		Clear();
 		return master->SetColorSpace(m);
 	}
 
+	bool GetCacheStats(VideoCacheStats &stats) const override {
+		stats.hits = hits;
+		stats.misses = misses;
+		stats.frames = frame_count;
+		stats.size = cache_size;
+		stats.max_size = max_cache_size;
+		return true;
+	}
+
 	int GetFrameCount() const override             { return master->GetFrameCount(); }
 	int GetWidth() const override                  { return master->GetWidth(); }
 	int GetHeight() const override                 { return master->GetHeight(); }
@@ -74,28 +121,69 @@ public:
 	bool HasAudio() const override                 { return master->HasAudio(); }
 };
 
+void VideoProviderCache::Shrink(size_t max_size) {
+	while (!cache.empty() && cache_size > max_size) {
+		cache_size -= cache.back().Size();
+		index.erase(cache.back().frame_number);
+		cache.pop_back();
+		--frame_count;
+	}
+}
+
 void VideoProviderCache::GetFrame(int n, VideoFrame &out) {
-	size_t total_size = 0;
+	auto it = index.find(n);
+	if (it != index.end()) {
+		++hits;
+		cache.splice(cache.begin(), cache, it->second); // Move to front
+		out = cache.front().frame;
+		return;
+	}
 
-	for (auto cur = cache.begin(); cur != cache.end(); ++cur) {
-		if (cur->frame_number == n) {
-			cache.splice(cache.begin(), cache, cur); // Move to front
-			out = cache.front().frame;
-			return;
-		}
+	++misses;
+	master->GetFrame(n, out);
+	Insert(n, out);
+}
 
-		total_size += cur->frame.data.size();
+void VideoProviderCache::PrefetchFrame(int n) {
+	auto it = index.find(n);
+	if (it != index.end()) {
+		cache.splice(cache.begin(), cache, it->second);
+		return;
 	}
 
-	master->GetFrame(n, out);
+	master->GetFrame(n, prefetch_buffer);
+	Insert(n, prefetch_buffer);
+}
 
-	if (total_size >= max_cache_size) {
-		cache.splice(cache.begin(), cache, --cache.end()); // Move last to front
-		cache.front().frame_number = n;
-		cache.front().frame = out;
+void VideoProviderCache::Insert(int n, VideoFrame const& frame) {
+	const size_t size = sizeof(CachedFrame) + frame.data.size();
+	if (size > max_cache_size) return;
+
+	// Make room for the new frame, keeping the last evicted frame around so
+	// that its buffer can be reused, as all of the frames are usually the
+	// same size
+	std::list<CachedFrame> spare;
+	while (!cache.empty() && cache_size + size > max_cache_size) {
+		cache_size -= cache.back().Size();
+		index.erase(cache.back().frame_number);
+		--frame_count;
+		spare.clear();
+		spare.splice(spare.begin(), cache, std::prev(cache.end()));
 	}
-	else
-		cache.emplace_front(out, n);
+
+	if (spare.empty())
+		cache.emplace_front(frame, n);
+	else {
+		spare.front().frame = frame;
+		spare.front().frame_number = n;
+		cache.splice(cache.begin(), spare);
+	}
+	++frame_count;
+	index[n] = cache.begin();
+	cache_size += cache.front().Size();
+
+	// A reused buffer may be larger than the frame
+	Shrink(max_cache_size);
 }
 }
 
@@ -96,7 +96,7 @@ std::string DummyVideoProvider::MakeFilename(double fps, int frames, int width,
 }
 
 void DummyVideoProvider::GetFrame(int, VideoFrame &frame) {
-	frame.data    = data;
+	frame.data.assign(data.begin(), data.end());
 	frame.width   = width;
 	frame.height  = height;
 	frame.pitch   = width * 4;
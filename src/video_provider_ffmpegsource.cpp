@@ -41,6 +41,7 @@
 #include "video_frame.h"
 
 #include <libaegisub/fs.h>
+#include <libaegisub/image_transform.h>
 #include <libaegisub/make_unique.h>
 
 namespace {
@@ -67,6 +68,9 @@ class FFmpegSourceVideoProvider final : public VideoProvider, FFmpegSourceProvid
 	/// video source object
 	agi::scoped_holder<FFMS_VideoSource*, void (FFMS_CC*)(FFMS_VideoSource*)> VideoSource;
 	const FFMS_VideoProperties *VideoInfo = nullptr; ///< video properties
+	/// Index the source was opened from, kept for opening the audio from
+	/// the same file without indexing it again
+	std::shared_ptr<FFMS_Index> Index;
 
 	int Width = -1;                 ///< width in pixels
 	int Height = -1;                ///< height in pixels
@@ -77,6 +81,7 @@ class FFmpegSourceVideoProvider final : public VideoProvider, FFmpegSourceProvid
 	agi::vfr::Framerate Timecodes;  ///< vfr object
 	std::string ColorSpace;         ///< Colorspace name
 	std::string RealColorSpace;     ///< Colorspace name
+	agi::image_transform Transform; ///< Flip and rotation to apply to each frame
 
 	char FFMSErrMsg[1024];          ///< FFMS error message
 	FFMS_ErrorInfo ErrInfo;         ///< FFMS error codes/messages
@@ -182,38 +187,10 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 		TrackNumber = static_cast<int>(Selection);
 	}
 
-	// generate a name for the cache file
-	auto CacheName = GetCacheFilename(filename);
-
-	// try to read index
-	agi::scoped_holder<FFMS_Index*, void (FFMS_CC*)(FFMS_Index*)>
-		Index(FFMS_ReadIndex(CacheName.string().c_str(), &ErrInfo), FFMS_DestroyIndex);
-
-	if (Index && FFMS_IndexBelongsToFile(Index, filename.string().c_str(), &ErrInfo))
-		Index = nullptr;
-
-	// time to examine the index and check if the track we want is indexed
-	// technically this isn't really needed since all video tracks should always be indexed,
-	// but a bit of sanity checking never hurt anyone
-	if (Index && TrackNumber >= 0) {
-		FFMS_Track *TempTrackData = FFMS_GetTrackFromIndex(Index, TrackNumber);
-		if (FFMS_GetNumFrames(TempTrackData) <= 0)
-			Index = nullptr;
-	}
-
-	// moment of truth
-	if (!Index) {
-		auto TrackMask = TrackSelection::None;
-		if (OPT_GET("Provider/FFmpegSource/Index All Tracks")->GetBool() || OPT_GET("Video/Open Audio")->GetBool())
-			TrackMask = TrackSelection::All;
-		Index = DoIndexing(Indexer, CacheName, TrackMask, GetErrorHandlingMode());
-	}
-	else {
-		FFMS_CancelIndexing(Indexer);
-	}
-
-	// update access time of index file so it won't get cleaned away
-	agi::fs::Touch(CacheName);
+	// If the audio is going to be opened from this file too, index it now so
+	// that the audio provider can share the index rather than reading the
+	// whole file a second time
+	Index = GetIndex(Indexer, filename, TrackNumber, OPT_GET("Video/Open Audio")->GetBool());
 
 	// we have now read the index and may proceed with cleaning the index cache
 	CleanCache();
@@ -221,18 +198,18 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 	// track number still not set?
 	if (TrackNumber < 0) {
 		// just grab the first track
-		TrackNumber = FFMS_GetFirstIndexedTrackOfType(Index, FFMS_TYPE_VIDEO, &ErrInfo);
+		TrackNumber = FFMS_GetFirstIndexedTrackOfType(Index.get(), FFMS_TYPE_VIDEO, &ErrInfo);
 		if (TrackNumber < 0)
 			throw VideoNotSupported(std::string("Couldn't find any video tracks: ") + ErrInfo.Buffer);
 	}
 
 	// Check if there's an audio track
-	has_audio = FFMS_GetFirstTrackOfType(Index, FFMS_TYPE_AUDIO, nullptr) != -1;
+	has_audio = FFMS_GetFirstTrackOfType(Index.get(), FFMS_TYPE_AUDIO, nullptr) != -1;
 
 	// set thread count
 	int Threads = OPT_GET("Provider/Video/FFmpegSource/Decoding Threads")->GetInt();
 #if FFMS_VERSION < ((2 << 24) | (17 << 16) | (2 << 8) | 1)
-	if (FFMS_GetSourceType(Index) == FFMS_SOURCE_LAVF)
+	if (FFMS_GetSourceType(Index.get()) == FFMS_SOURCE_LAVF)
 		Threads = 1;
 #endif
 
@@ -244,7 +221,7 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 	else
 		SeekMode = FFMS_SEEK_NORMAL;
 
-	VideoSource = FFMS_CreateVideoSource(filename.string().c_str(), TrackNumber, Index, Threads, SeekMode, &ErrInfo);
+	VideoSource = FFMS_CreateVideoSource(filename.string().c_str(), TrackNumber, Index.get(), Threads, SeekMode, &ErrInfo);
 	if (!VideoSource)
 		throw VideoOpenError(std::string("Failed to open video track: ") + ErrInfo.Buffer);
 
@@ -281,6 +258,19 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 	}
 #endif
 
+#if FFMS_VERSION >= ((2 << 24) | (24 << 16) | (0 << 8) | 0)
+	// FFMS2's rotation is counterclockwise
+	if (VideoInfo->Rotation % 90 == 0)
+		Transform = agi::image_transform::rotation(-VideoInfo->Rotation);
+#endif
+#if FFMS_VERSION >= ((2 << 24) | (31 << 16) | (0 << 8) | 0)
+	// The flip is applied before the rotation, so it mirrors the source
+	if (VideoInfo->Flip > 0)
+		Transform.flip_x = !Transform.flip_x;
+	else if (VideoInfo->Flip < 0)
+		Transform.flip_y = !Transform.flip_y;
+#endif
+
 	const int TargetFormat[] = { FFMS_GetPixFmt("bgra"), -1 };
 	if (FFMS_SetOutputFormatV2(VideoSource, TargetFormat, Width, Height, FFMS_RESIZER_BICUBIC, &ErrInfo))
 		throw VideoOpenError(std::string("Failed to set output format: ") + ErrInfo.Buffer);
@@ -321,59 +311,15 @@ void FFmpegSourceVideoProvider::GetFrame(int n, VideoFrame &out) {
 	if (!frame)
 		throw VideoDecodeError(std::string("Failed to retrieve frame: ") +  ErrInfo.Buffer);
 
-	out.data.assign(frame->Data[0], frame->Data[0] + frame->Linesize[0] * Height);
+	// The frame belongs to FFMS2 and is overwritten by the next call, so copy
+	// it out, flipping and rotating it in the same pass
 	out.flipped = false;
-	out.width = Width;
-	out.height = Height;
-	out.pitch = frame->Linesize[0];
-#if FFMS_VERSION >= ((2 << 24) | (31 << 16) | (0 << 8) | 0)
-	// Handle flip
-	if (VideoInfo->Flip > 0)
-		for (int x = 0; x < Height; ++x)
-			for (int y = 0; y < Width / 2; ++y)
-				for (int ch = 0; ch < 4; ++ch)
-					std::swap(out.data[frame->Linesize[0] * x + 4 * y + ch], out.data[frame->Linesize[0] * x + 4 * (Width - 1 - y) + ch]);
-
-	else if (VideoInfo->Flip < 0)
-		for (int x = 0; x < Height / 2; ++x)
-			for (int y = 0; y < Width; ++y)
-				for (int ch = 0; ch < 4; ++ch)
-					std::swap(out.data[frame->Linesize[0] * x + 4 * y + ch], out.data[frame->Linesize[0] * (Height - 1 - x) + 4 * y + ch]);
-#endif
-#if FFMS_VERSION >= ((2 << 24) | (24 << 16) | (0 << 8) | 0)
-	// Handle rotation
-	if (VideoInfo->Rotation % 360 == 180 || VideoInfo->Rotation % 360 == -180) {
-		std::vector<unsigned char> data(std::move(out.data));
-		out.data.resize(Width * Height * 4);
-		for (int x = 0; x < Height; ++x)
-			for (int y = 0; y < Width; ++y)
-				for (int ch = 0; ch < 4; ++ch)
-					out.data[4 * (Width * x + y) + ch] = data[frame->Linesize[0] * (Height - 1 - x) + 4 * (Width - 1 - y) + ch];
-		out.pitch = 4 * Width;
-	}
-	else if (VideoInfo->Rotation % 360 == 90 || VideoInfo->Rotation % 360 == -270) {
-		std::vector<unsigned char> data(std::move(out.data));
-		out.data.resize(Width * Height * 4);
-		for (int x = 0; x < Width; ++x)
-			for (int y = 0; y < Height; ++y)
-				for (int ch = 0; ch < 4; ++ch)
-					out.data[4 * (Height * x + y) + ch] = data[frame->Linesize[0] * y + 4 * (Width - 1 - x) + ch];
-		out.width = Height;
-		out.height = Width;
-		out.pitch = 4 * Height;
-	}
-	else if (VideoInfo->Rotation % 360 == 270 || VideoInfo->Rotation % 360 == -90) {
-		std::vector<unsigned char> data(std::move(out.data));
-		out.data.resize(Width * Height * 4);
-		for (int x = 0; x < Width; ++x)
-			for (int y = 0; y < Height; ++y)
-				for (int ch = 0; ch < 4; ++ch)
-					out.data[4 * (Height * x + y) + ch] = data[frame->Linesize[0] * (Height - 1 - y) + 4 * x + ch];
-		out.width = Height;
-		out.height = Width;
-		out.pitch = 4 * Height;
-	}
-#endif
+	out.width = Transform.transpose ? Height : Width;
+	out.height = Transform.transpose ? Width : Height;
+	out.pitch = out.width * 4;
+	out.data.resize(out.pitch * out.height);
+	agi::transform_bgra(frame->Data[0], frame->Linesize[0], Width, Height,
+		out.data.data(), out.pitch, Transform);
 }
 }
 
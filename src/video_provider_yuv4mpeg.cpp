@@ -44,6 +44,7 @@
 #include <libaegisub/ycbcr_conv.h>
 
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <memory>
 #include <vector>
 
@@ -118,8 +119,13 @@ class YUV4MPEGVideoProvider final : public VideoProvider {
 	int frame_sz;	/// size of each frame in bytes
 	int luma_sz;	/// size of the luma plane of each frame, in bytes
 	int chroma_sz;	/// size of one of the two chroma planes of each frame, in bytes
+	int chroma_stride; /// size of one row of a chroma plane, in bytes
+	int chroma_shift_x = 1; /// log2 of the horizontal chroma subsampling
+	int chroma_shift_y = 1; /// log2 of the vertical chroma subsampling
 
 	Y4M_PixelFormat pixfmt = Y4M_PIXFMT_NONE;		/// colorspace/pixel format
+	int bit_depth = 8;	/// bits per sample; samples deeper than 8 bits take two bytes
+	agi::ycbcr_range range = agi::ycbcr_range::tv;	/// sample range, from the COLORRANGE extension
 	Y4M_InterlacingMode imode = Y4M_ILACE_NOTSET;	/// interlacing mode (for the entire stream)
 	struct {
 		int num = -1;	/// numerator
@@ -128,7 +134,7 @@ class YUV4MPEGVideoProvider final : public VideoProvider {
 
 	agi::vfr::Framerate fps;
 
-	agi::ycbcr_converter conv{agi::ycbcr_matrix::bt601, agi::ycbcr_range::tv};
+	agi::ycbcr_planar_converter conv{agi::ycbcr_matrix::bt601, agi::ycbcr_range::tv};
 
 	/// a list of byte positions detailing where in the file
 	/// each frame header can be found
@@ -151,7 +157,7 @@ public:
 	double GetDAR() const override                 { return 0; }
 	agi::vfr::Framerate GetFPS() const override    { return fps; }
 	std::vector<int> GetKeyFrames() const override { return {}; }
-	std::string GetColorSpace() const override     { return "TV.601"; }
+	std::string GetColorSpace() const override     { return range == agi::ycbcr_range::pc ? "PC.601" : "TV.601"; }
 	std::string GetDecoderName() const override    { return "YU4MPEG"; }
 	bool WantsCaching() const override             { return true; }
 };
@@ -181,17 +187,35 @@ YUV4MPEGVideoProvider::YUV4MPEGVideoProvider(agi::fs::path const& filename)
 	if (imode == Y4M_ILACE_NOTSET)
 		imode = Y4M_ILACE_UNKNOWN;
 
-	luma_sz = w * h;
 	switch (pixfmt) {
 	case Y4M_PIXFMT_420JPEG:
 	case Y4M_PIXFMT_420MPEG2:
 	case Y4M_PIXFMT_420PALDV:
-		chroma_sz	= (w * h) >> 2; break;
+		chroma_shift_x = 1; chroma_shift_y = 1; break;
+	case Y4M_PIXFMT_411:
+		chroma_shift_x = 2; chroma_shift_y = 0; break;
+	case Y4M_PIXFMT_422:
+		chroma_shift_x = 1; chroma_shift_y = 0; break;
+	case Y4M_PIXFMT_444:
+	case Y4M_PIXFMT_444ALPHA:
+	case Y4M_PIXFMT_MONO:
+		chroma_shift_x = 0; chroma_shift_y = 0; break;
 	default:
-		/// @todo add support for more pixel formats
 		throw VideoOpenError("Unsupported pixel format");
 	}
-	frame_sz	= luma_sz + chroma_sz*2;
+
+	const int sample_sz = bit_depth > 8 ? 2 : 1;
+	const int chroma_w = (w + (1 << chroma_shift_x) - 1) >> chroma_shift_x;
+	const int chroma_h = (h + (1 << chroma_shift_y) - 1) >> chroma_shift_y;
+	luma_sz = w * h * sample_sz;
+	chroma_stride = chroma_w * sample_sz;
+	chroma_sz = pixfmt == Y4M_PIXFMT_MONO ? 0 : chroma_stride * chroma_h;
+	frame_sz = luma_sz + chroma_sz * 2;
+	// The alpha plane is ignored, but still has to be skipped over
+	if (pixfmt == Y4M_PIXFMT_444ALPHA)
+		frame_sz += luma_sz;
+
+	conv = agi::ycbcr_planar_converter(agi::ycbcr_matrix::bt601, range, bit_depth);
 
 	num_frames = IndexFile(pos);
 	if (num_frames <= 0 || seek_table.empty())
@@ -251,6 +275,7 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 	int t_fps_den	= -1;
 	Y4M_InterlacingMode t_imode	= Y4M_ILACE_NOTSET;
 	Y4M_PixelFormat t_pixfmt	= Y4M_PIXFMT_NONE;
+	int t_bit_depth	= -1;
 
 	for (unsigned i = 1; i < tags.size(); i++) {
 		char type = tags[i][0];
@@ -278,6 +303,17 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 			// technically this should probably be case sensitive,
 			// but being liberal in what you accept doesn't hurt
 			boost::to_lower(tag);
+			t_bit_depth = 8;
+
+			// High bit depth formats have the depth appended, as in 420p10
+			// or mono16
+			size_t depth_pos = tag.compare(0, 4, "mono") ? tag.find('p') + 1 : 4;
+			if (depth_pos > 0 && depth_pos < tag.size() && tag.find_first_not_of("0123456789", depth_pos) == tag.npos) {
+				if (!agi::util::try_parse(tag.substr(depth_pos), &t_bit_depth) || t_bit_depth < 8 || t_bit_depth > 16)
+					err = "invalid bit depth";
+				tag.erase(tag[depth_pos - 1] == 'p' ? depth_pos - 1 : depth_pos);
+			}
+
 			if (tag == "420")			t_pixfmt = Y4M_PIXFMT_420JPEG; // is this really correct?
 			else if (tag == "420jpeg")	t_pixfmt = Y4M_PIXFMT_420JPEG;
 			else if (tag == "420mpeg2")	t_pixfmt = Y4M_PIXFMT_420MPEG2;
@@ -300,6 +336,10 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 			else
 				err = "invalid or unknown interlacing mode";
 		}
+		else if (type == 'X' && boost::starts_with(tag, "COLORRANGE=")) {
+			if (tag == "COLORRANGE=FULL")			range = agi::ycbcr_range::pc;
+			else if (tag == "COLORRANGE=LIMITED")	range = agi::ycbcr_range::tv;
+		}
 		else
 			LOG_D("provider/video/yuv4mpeg") << "Unparsed tag: " << tags[i];
 
@@ -319,7 +359,7 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 			err = "illegal height change";
 		if ((t_fps_num > 0 && t_fps_den > 0) && (t_fps_num != fps_rat.num || t_fps_den != fps_rat.den))
 			err = "illegal framerate change";
-		if (t_pixfmt != Y4M_PIXFMT_NONE && t_pixfmt != pixfmt)
+		if ((t_pixfmt != Y4M_PIXFMT_NONE && t_pixfmt != pixfmt) || (t_bit_depth > 0 && t_bit_depth != bit_depth))
 			err = "illegal colorspace change";
 		if (t_imode != Y4M_ILACE_NOTSET && t_imode != imode)
 			err = "illegal interlacing mode change";
@@ -332,6 +372,7 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 		fps_rat.num = t_fps_num;
 		fps_rat.den = t_fps_den;
 		pixfmt		= t_pixfmt	!= Y4M_PIXFMT_NONE	? t_pixfmt	: Y4M_PIXFMT_420JPEG;
+		bit_depth	= t_bit_depth	> 0					? t_bit_depth	: 8;
 		imode		= t_imode	!= Y4M_ILACE_NOTSET	? t_imode	: Y4M_ILACE_UNKNOWN;
 		fps = double(fps_rat.num) / fps_rat.den;
 		inited = true;
@@ -390,34 +431,19 @@ int YUV4MPEGVideoProvider::IndexFile(uint64_t pos) {
 void YUV4MPEGVideoProvider::GetFrame(int n, VideoFrame &frame) {
 	n = mid(0, n, num_frames - 1);
 
-	int uv_width = w / 2;
+	auto src = reinterpret_cast<const uint8_t *>(file.read(seek_table[n], frame_sz));
 
-	auto src_y = reinterpret_cast<const unsigned char *>(file.read(seek_table[n], luma_sz + chroma_sz * 2));
-	auto src_u = src_y + luma_sz;
-	auto src_v = src_u + chroma_sz;
-	frame.data.resize(w * h * 4);
-	unsigned char *dst = &frame.data[0];
-
-	for (int py = 0; py < h; ++py) {
-		for (int px = 0; px < w / 2; ++px) {
-			const uint8_t u = *src_u++;
-			const uint8_t v = *src_v++;
-			for (unsigned int i = 0; i < 2; ++i) {
-				const uint8_t y = *src_y++;
-				auto rgb = conv.ycbcr_to_rgb({{y, u, v}});
-				*dst++ = rgb[2];
-				*dst++ = rgb[1];
-				*dst++ = rgb[0];
-				*dst++ = 0;
-			}
-		}
+	agi::ycbcr_planes planes;
+	planes.y = src;
+	planes.cb = chroma_sz ? src + luma_sz : nullptr;
+	planes.cr = chroma_sz ? src + luma_sz + chroma_sz : nullptr;
+	planes.y_stride = w * (bit_depth > 8 ? 2 : 1);
+	planes.c_stride = chroma_stride;
+	planes.chroma_shift_x = chroma_shift_x;
+	planes.chroma_shift_y = chroma_shift_y;
 
-		// Roll back u/v on even lines
-		if (!(py & 1)) {
-			src_u -= uv_width;
-			src_v -= uv_width;
-		}
-	}
+	frame.data.resize(w * h * 4);
+	conv.convert(planes, w, h, frame.data.data(), w * 4);
 
 	frame.flipped = false;
 	frame.width = w;
@@ -0,0 +1,136 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include "benchmark.h"
+
+#include <libaegisub/alpha_blend.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+/// One of the images libass returns for a frame
+struct Image {
+	std::vector<uint8_t> bitmap;
+	size_t w, h, x, y;
+	uint8_t r, g, b, opacity;
+};
+
+/// An antialiased ring, roughly what libass produces for the border or
+/// shadow of a glyph, with transparent padding around and inside it
+std::vector<uint8_t> Ring(size_t w, size_t h, double thickness) {
+	std::vector<uint8_t> mask(w * h);
+	const double cx = w / 2.0, cy = h / 2.0, radius = std::min(cx, cy) - 2;
+	for (size_t y = 0; y < h; ++y) {
+		for (size_t x = 0; x < w; ++x) {
+			const double d = std::abs(std::hypot(x + 0.5 - cx, y + 0.5 - cy) - radius + thickness / 2);
+			const double cover = std::max(0.0, std::min(1.0, thickness / 2 - d + 0.5));
+			mask[y * w + x] = (uint8_t)(cover * 255);
+		}
+	}
+	return mask;
+}
+
+/// A karaoke-heavy 1080p frame: a few thousand glyph-sized images for the
+/// fill, border and shadow of each syllable, plus a few large blurred signs
+std::vector<Image> KaraokeFrame() {
+	std::vector<Image> images;
+	uint32_t state = 1;
+	auto rand = [&](uint32_t n) {
+		state = state * 1664525 + 1013904223;
+		return (state >> 8) % n;
+	};
+	for (size_t line = 0; line < 12; ++line) {
+		for (size_t glyph = 0; glyph < 60; ++glyph) {
+			const size_t w = 24 + rand(24), h = 40 + rand(16);
+			const size_t x = 40 + glyph * 30, y = 60 + line * 80;
+			images.push_back({Ring(w + 8, h + 8, 10), w + 8, h + 8, x + 3, y + 3, 0, 0, 0, 128});
+			images.push_back({Ring(w + 4, h + 4, 6), w + 4, h + 4, x, y, 20, 20, 60, 255});
+			images.push_back({Ring(w, h, (double)w), w, h, x + 2, y + 2, 255, 240, 200, 255});
+			images.push_back({Ring(w, h, 3), w, h, x + 2, y + 2, 255, 80, 80, 200});
+		}
+	}
+	for (size_t sign = 0; sign < 4; ++sign)
+		images.push_back({Ring(400, 300, 60), 400, 300, 100 + sign * 420, 700, 240, 240, 240, 180});
+	return images;
+}
+
+/// How DrawSubtitles used to blend: every pixel of every image, with
+/// integer divisions
+void BlendDivide(std::vector<Image> const& images, uint8_t *frame, size_t pitch) {
+	for (auto const& img : images) {
+		for (size_t y = 0; y < img.h; ++y) {
+			uint8_t *row = frame + (img.y + y) * pitch + img.x * 4;
+			for (size_t x = 0; x < img.w; ++x) {
+				unsigned k = img.bitmap[y * img.w + x] * (unsigned)img.opacity / 255;
+				unsigned ck = 255 - k;
+				row[x * 4 + 0] = (k * img.b + ck * row[x * 4 + 0]) / 255;
+				row[x * 4 + 1] = (k * img.g + ck * row[x * 4 + 1]) / 255;
+				row[x * 4 + 2] = (k * img.r + ck * row[x * 4 + 2]) / 255;
+				row[x * 4 + 3] = 0;
+			}
+		}
+	}
+}
+}
+
+TEST(lagi_bench, alpha_blend) {
+	using agi::cpu::SimdLevel;
+
+	const size_t width = 1920, height = 1080, pitch = width * 4;
+	std::vector<uint8_t> frame(pitch * height, 0x40);
+	const auto images = KaraokeFrame();
+	std::printf("  %d images\n", (int)images.size());
+
+	const double baseline = bench::Time([&] { BlendDivide(images, frame.data(), pitch); });
+	bench::Report("per pixel, dividing", baseline, baseline);
+
+	auto run = [&](SimdLevel level) {
+		return bench::Time([&] {
+			for (auto const& img : images)
+				agi::blend_mask(img.bitmap.data(), img.w, img.w, img.h, frame.data() + img.y * pitch + img.x * 4,
+					pitch, img.r, img.g, img.b, img.opacity, level);
+		});
+	};
+	bench::Report("blend_mask, scalar", run(SimdLevel::None), baseline);
+	if (agi::cpu::BestSimdLevel() >= SimdLevel::SSE2)
+		bench::Report("blend_mask, SSE2", run(SimdLevel::SSE2), baseline);
+	if (agi::cpu::BestSimdLevel() >= SimdLevel::AVX2)
+		bench::Report("blend_mask, AVX2", run(SimdLevel::AVX2), baseline);
+}
+
+TEST(lagi_bench, alpha_blend_bands) {
+	// The karaoke frame repeated four times over a 4K frame
+	const int width = 3840, height = 2160;
+	const ptrdiff_t pitch = width * 4;
+	std::vector<uint8_t> frame(pitch * height, 0x40);
+	const auto images = KaraokeFrame();
+	std::vector<agi::alpha_mask> masks;
+	for (int copy = 0; copy < 4; ++copy) {
+		for (auto const& img : images) {
+			masks.push_back({img.bitmap.data(), img.w, (int)img.w, (int)img.h,
+				(int)img.x + copy % 2 * 1920, (int)img.y + copy / 2 * 1080,
+				img.r, img.g, img.b, img.opacity});
+		}
+	}
+	std::printf("  %d images, %u threads\n", (int)masks.size(), std::thread::hardware_concurrency());
+
+	const double baseline = bench::Time([&] { agi::blend_masks_rows(masks, frame.data(), pitch, 0, height); });
+	bench::Report("one thread", baseline, baseline);
+	bench::Report("bands in parallel", bench::Time([&] { agi::blend_masks(masks, frame.data(), pitch, height); }), baseline);
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include "benchmark.h"
+
+#include <libaegisub/audio/sample_convert.h>
+
+#include <vector>
+
+TEST(lagi_bench, audio_convert_int16_mono) {
+	using agi::cpu::SimdLevel;
+	struct Format { const char *name; int bytes_per_sample; bool float_samples; };
+	// About what the waveform renderer asks for per pixel column at the
+	// default zoom, and a bit under what most players request at once
+	const int64_t count = 4096;
+
+	for (auto format : {Format{"u8", 1, false}, Format{"s16", 2, false}, Format{"s24", 3, false},
+	                    Format{"s32", 4, false}, Format{"float", 4, true}, Format{"double", 8, true}}) {
+		for (int channels : {1, 2, 6}) {
+			if (format.bytes_per_sample == 2 && channels == 1) continue; // Never converted
+
+			std::vector<char> src(count * channels * format.bytes_per_sample);
+			if (format.float_samples) {
+				for (size_t i = 0; i < count * channels; ++i) {
+					if (format.bytes_per_sample == 4)
+						reinterpret_cast<float *>(src.data())[i] = (rand() % 2000 - 1000) / 1000.f;
+					else
+						reinterpret_cast<double *>(src.data())[i] = (rand() % 2000 - 1000) / 1000.;
+				}
+			}
+			else {
+				for (auto& byte : src)
+					byte = (char)rand();
+			}
+
+			std::vector<int16_t> dst(count);
+			auto run = [&](SimdLevel level) {
+				return bench::Time([&] {
+					agi::ConvertToInt16Mono(dst.data(), src.data(), count, channels, format.bytes_per_sample, format.float_samples, level);
+				});
+			};
+
+			std::printf("%s, %d channel(s), %d samples:\n", format.name, channels, (int)count);
+			const double scalar = run(SimdLevel::None);
+			bench::Report("scalar", scalar, scalar);
+			if (agi::cpu::BestSimdLevel() >= SimdLevel::SSE2)
+				bench::Report("SSE2", run(SimdLevel::SSE2), scalar);
+			if (agi::cpu::BestSimdLevel() >= SimdLevel::AVX2)
+				bench::Report("AVX2", run(SimdLevel::AVX2), scalar);
+		}
+	}
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace bench {
+/// Run func repeatedly for at least a quarter of a second
+/// @return Average time per call in nanoseconds
+template<typename Func>
+double Time(Func&& func) {
+	using clock = std::chrono::steady_clock;
+	func(); // Warm up caches and lazily-initialized state
+
+	size_t iterations = 0;
+	auto start = clock::now();
+	auto elapsed = clock::duration::zero();
+	for (size_t batch = 1; elapsed < std::chrono::milliseconds(250); batch *= 2) {
+		for (size_t i = 0; i < batch; ++i)
+			func();
+		iterations += batch;
+		elapsed = clock::now() - start;
+	}
+	return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+/// Print the time for one variant of a benchmark, relative to a baseline
+inline void Report(std::string const& name, double ns, double baseline_ns) {
+	std::printf("  %-40s %12.1f ns %8.2fx\n", name.c_str(), ns, baseline_ns / ns);
+}
+}
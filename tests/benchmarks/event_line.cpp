@@ -0,0 +1,147 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include "benchmark.h"
+
+#include <libaegisub/ass/event_line.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/regex.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+/// The lines of a karaoke script: mostly per-syllable effect lines with
+/// \k and \t tags, some with extradata, and a few comments
+std::vector<std::string> KaraokeScript(size_t count) {
+	std::vector<std::string> lines;
+	lines.reserve(count);
+	uint32_t state = 1;
+	auto rand = [&](uint32_t n) {
+		state = state * 1664525 + 1013904223;
+		return (state >> 8) % n;
+	};
+	for (size_t i = 0; i < count; ++i) {
+		int start = (int)(i * 250 % 36000000);
+		agi::Time s(start), e(start + 200 + (int)rand(3000));
+		std::string line = rand(20) ? "Dialogue: " : "Comment: ";
+		line += std::to_string(rand(10)) + "," + s.GetAssFormatted() + "," + e.GetAssFormatted();
+		line += rand(2) ? ",OP Romaji,,0,0,0,fx," : ",ED Kanji,Singer,10,10,25,,";
+		if (rand(4) == 0)
+			line += "{=" + std::to_string(rand(1000)) + "=" + std::to_string(rand(1000)) + "}";
+		for (int syl = 0, n = 4 + (int)rand(12); syl < n; ++syl) {
+			line += "{\\k" + std::to_string(10 + rand(60)) + "\\t(0," + std::to_string(rand(500)) + ",\\fscx120)}";
+			line += "syl" + std::to_string(syl);
+		}
+		lines.push_back(std::move(line));
+	}
+	return lines;
+}
+
+/// How AssDialogue::Parse used to read lines: split on commas, copy and trim
+/// each field, lexical_cast the numbers and find extradata with regexes
+struct OldLine {
+	bool comment;
+	int layer;
+	agi::Time start, end;
+	std::string style, actor, effect, text;
+	int margin[3];
+	std::vector<uint32_t> ids;
+};
+
+void ParseOld(std::string const& raw, OldLine& out) {
+	agi::StringRange str;
+	if (boost::starts_with(raw, "Dialogue:")) {
+		out.comment = false;
+		str = agi::StringRange(raw.begin() + 10, raw.end());
+	}
+	else {
+		out.comment = true;
+		str = agi::StringRange(raw.begin() + 9, raw.end());
+	}
+
+	auto pos = agi::Split(str, ',');
+	auto next_tok = [&] { return *pos++; };
+	auto next_str_trim = [&] { return agi::str(boost::trim_copy(next_tok())); };
+
+	auto tmp = next_str_trim();
+	out.layer = boost::istarts_with(tmp, "marked=") ? 0 : boost::lexical_cast<int>(tmp);
+	out.start = next_str_trim();
+	out.end = next_str_trim();
+	out.style = next_str_trim();
+	out.actor = next_str_trim();
+	for (int& margin : out.margin)
+		margin = boost::lexical_cast<int>(agi::str(next_tok()));
+	out.effect = next_str_trim();
+
+	std::string text{next_tok().begin(), str.end()};
+	out.ids.clear();
+	if (text.size() > 1 && text[0] == '{' && text[1] == '=') {
+		static const boost::regex extradata_test("^\\{(=\\d+)+\\}");
+		boost::match_results<std::string::iterator> rematch;
+		if (boost::regex_search(text.begin(), text.end(), rematch, extradata_test)) {
+			std::string extradata_str = rematch.str(0);
+			text = rematch.suffix().str();
+
+			static const boost::regex idmatcher("=(\\d+)");
+			auto start = extradata_str.begin();
+			auto end = extradata_str.end();
+			while (boost::regex_search(start, end, rematch, idmatcher)) {
+				out.ids.push_back(boost::lexical_cast<uint32_t>(rematch.str(1)));
+				start = rematch.suffix().first;
+			}
+		}
+	}
+	out.text = std::move(text);
+}
+}
+
+TEST(lagi_bench, event_line_parse) {
+	for (size_t count : {1000, 200000}) {
+		auto lines = KaraokeScript(count);
+		std::printf("%d karaoke lines:\n", (int)count);
+
+		OldLine old_line;
+		const double baseline = bench::Time([&] {
+			for (auto const& line : lines)
+				ParseOld(line, old_line);
+		});
+		bench::Report("split, lexical_cast and regex", baseline, baseline);
+
+		agi::ass::EventLine line;
+		bench::Report("single pass", bench::Time([&] {
+			for (auto const& str : lines)
+				agi::ass::ParseEventLine(str, line);
+		}), baseline);
+
+		// AssDialogue still has to copy the strings into its fields
+		std::string style, actor, effect, text;
+		bench::Report("single pass, copying strings", bench::Time([&] {
+			for (auto const& str : lines) {
+				agi::ass::ParseEventLine(str, line);
+				style.assign(line.style.begin(), line.style.end());
+				actor.assign(line.actor.begin(), line.actor.end());
+				effect.assign(line.effect.begin(), line.effect.end());
+				text.assign(line.text.begin(), line.text.end());
+			}
+		}), baseline);
+	}
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include "benchmark.h"
+
+#include <libaegisub/fft.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+/// The complex radix-2 transform the spectrum display used when built
+/// without FFTW, kept as the baseline
+void ComplexRadix2(size_t n_samples, float *input, float *output_r, float *output_i) {
+	unsigned int bits = 0;
+	while ((1u << bits) < n_samples) ++bits;
+
+	for (unsigned int i = 0; i < n_samples; i++) {
+		unsigned int index = i, rev = 0;
+		for (unsigned int b = 0; b < bits; b++) {
+			rev = (rev << 1) | (index & 1);
+			index >>= 1;
+		}
+		output_r[rev] = input[i];
+		output_i[rev] = 0.0f;
+	}
+
+	const float angle_num = 2.0f * 3.1415926535897932384626433832795f;
+	unsigned int block_end = 1;
+	for (unsigned int block_size = 2; block_size <= n_samples; block_size <<= 1) {
+		float delta_angle = angle_num / (float)block_size;
+		float sm2 = sin(-2 * delta_angle);
+		float sm1 = sin(-delta_angle);
+		float cm2 = cos(-2 * delta_angle);
+		float cm1 = cos(-delta_angle);
+		float w = 2 * cm1;
+
+		for (unsigned int i = 0; i < n_samples; i += block_size) {
+			float ar1 = cm1, ar2 = cm2, ai1 = sm1, ai2 = sm2;
+			for (unsigned int j = i, n = 0; n < block_end; j++, n++) {
+				unsigned int k = j + block_end;
+				float ar0 = w * ar1 - ar2;
+				float ai0 = w * ai1 - ai2;
+				ar2 = ar1; ai2 = ai1;
+				ar1 = ar0; ai1 = ai0;
+
+				float tr = ar0 * output_r[k] - ai0 * output_i[k];
+				float ti = ar0 * output_i[k] + ai0 * output_r[k];
+				output_r[k] = output_r[j] - tr;
+				output_i[k] = output_i[j] - ti;
+				output_r[j] += tr;
+				output_i[j] += ti;
+			}
+		}
+		block_end = block_size;
+	}
+}
+}
+
+TEST(lagi_bench, fft_real) {
+	using agi::cpu::SimdLevel;
+
+	// The spectrum display's quality settings use 512 to 4096 samples
+	for (size_t n = 512; n <= 4096; n *= 2) {
+		std::vector<float> input(n);
+		for (auto& sample : input)
+			sample = (rand() % 2000 - 1000) / 1000.f;
+		std::vector<float> re(n), im(n);
+
+		std::printf("%d samples:\n", (int)n);
+		const double baseline = bench::Time([&] {
+			ComplexRadix2(n, input.data(), re.data(), im.data());
+		});
+		bench::Report("complex radix-2", baseline, baseline);
+
+		auto run = [&](SimdLevel level, const float *window) {
+			agi::RealFFT fft(n, level);
+			return bench::Time([&] {
+				fft.Transform(input.data(), re.data(), im.data(), window);
+			});
+		};
+
+		bench::Report("real, scalar", run(SimdLevel::None, nullptr), baseline);
+		if (agi::cpu::BestSimdLevel() >= SimdLevel::SSE2)
+			bench::Report("real, SSE2", run(SimdLevel::SSE2, nullptr), baseline);
+		if (agi::cpu::BestSimdLevel() >= SimdLevel::AVX2)
+			bench::Report("real, AVX2", run(SimdLevel::AVX2, nullptr), baseline);
+
+		auto window = agi::HannWindow(n);
+		bench::Report("real, best, Hann window", run(agi::cpu::BestSimdLevel(), window.data()), baseline);
+	}
+}
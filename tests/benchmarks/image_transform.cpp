@@ -0,0 +1,68 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include "benchmark.h"
+
+#include <libaegisub/image_transform.h>
+
+#include <vector>
+
+namespace {
+/// How the FFMS2 video provider rotated frames by 90 degrees: a copy of the
+/// decoded frame, then a byte at a time into a newly allocated buffer
+void CopyThenRotate(const uint8_t *src, size_t width, size_t height, std::vector<uint8_t>& out) {
+	out.assign(src, src + width * height * 4);
+	std::vector<uint8_t> data(width * height * 4);
+	for (size_t x = 0; x < width; ++x) {
+		for (size_t y = 0; y < height; ++y) {
+			for (size_t ch = 0; ch < 4; ++ch)
+				data[4 * (height * x + y) + ch] = out[y * width * 4 + 4 * (width - 1 - x) + ch];
+		}
+	}
+	out = std::move(data);
+}
+}
+
+TEST(lagi_bench, image_transform) {
+	using agi::cpu::SimdLevel;
+
+	// A 4K frame from a phone held upright
+	const size_t width = 3840, height = 2160;
+	std::vector<uint8_t> src(width * height * 4);
+	for (size_t i = 0; i < src.size(); ++i)
+		src[i] = (uint8_t)(i * 7);
+	std::vector<uint8_t> out(src.size());
+
+	const double baseline = bench::Time([&] { CopyThenRotate(src.data(), width, height, out); });
+	bench::Report("copy, then rotate by bytes", baseline, baseline);
+
+	auto run = [&](agi::image_transform t, SimdLevel level) {
+		const size_t pitch = (t.transpose ? height : width) * 4;
+		return bench::Time([&] {
+			agi::transform_bgra(src.data(), width * 4, width, height, out.data(), pitch, t, level);
+		});
+	};
+
+	const auto rotate = agi::image_transform::rotation(90);
+	bench::Report("rotate 90, scalar", run(rotate, SimdLevel::None), baseline);
+	if (agi::cpu::BestSimdLevel() >= SimdLevel::SSE2)
+		bench::Report("rotate 90, SSE2", run(rotate, SimdLevel::SSE2), baseline);
+	if (agi::cpu::BestSimdLevel() >= SimdLevel::AVX2)
+		bench::Report("rotate 90, AVX2", run(rotate, SimdLevel::AVX2), baseline);
+	bench::Report("rotate 180, best", run(agi::image_transform::rotation(180), agi::cpu::BestSimdLevel()), baseline);
+	bench::Report("copy, best", run(agi::image_transform(), agi::cpu::BestSimdLevel()), baseline);
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/cpu.h>
+
+#include <cstdint>
+
+namespace util {
+/// Every SIMD level, to check each implementation against the plain one
+const agi::cpu::SimdLevel simd_levels[] = {
+	agi::cpu::SimdLevel::None, agi::cpu::SimdLevel::SSE2, agi::cpu::SimdLevel::AVX2
+};
+
+/// A linear congruential generator, for test data which is the same on every
+/// platform and standard library
+struct Pseudorandom {
+	uint32_t state;
+
+	explicit Pseudorandom(uint32_t seed = 1234) : state(seed) { }
+
+	uint32_t operator()() {
+		state = state * 1664525 + 1013904223;
+		return state;
+	}
+};
+}
@@ -0,0 +1,172 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include <simd.h>
+
+#include <libaegisub/alpha_blend.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+/// A mask with runs of transparent pixels between pseudorandom coverage
+std::vector<uint8_t> MakeMask(size_t size) {
+	util::Pseudorandom rand;
+	std::vector<uint8_t> mask(size);
+	for (size_t i = 0; i < size; ++i) {
+		if ((i / 11) % 3 == 0)
+			mask[i] = 0;
+		else if ((i / 5) % 4 == 0)
+			mask[i] = 255;
+		else
+			mask[i] = rand() >> 24;
+	}
+	return mask;
+}
+
+std::vector<uint8_t> MakeImage(size_t size) {
+	util::Pseudorandom rand(5678);
+	std::vector<uint8_t> img(size);
+	for (auto& v : img) v = rand() >> 24;
+	return img;
+}
+
+/// The blend as DrawSubtitles used to do it, other than the alpha channel
+void Reference(const uint8_t *mask, size_t mask_stride, size_t width, size_t height,
+               uint8_t *dst, ptrdiff_t dst_pitch, unsigned r, unsigned g, unsigned b, unsigned opacity) {
+	for (size_t y = 0; y < height; ++y) {
+		for (size_t x = 0; x < width; ++x) {
+			unsigned k = mask[y * mask_stride + x] * opacity / 255;
+			unsigned ck = 255 - k;
+			uint8_t *px = dst + (ptrdiff_t)y * dst_pitch + x * 4;
+			px[0] = (k * b + ck * px[0]) / 255;
+			px[1] = (k * g + ck * px[1]) / 255;
+			px[2] = (k * r + ck * px[2]) / 255;
+		}
+	}
+}
+}
+
+TEST(lagi_alpha_blend, matches_reference) {
+	// Odd widths to cover the scalar tail after the vector loops, blended at
+	// an offset into a larger image
+	const size_t img_width = 50, img_height = 9, offset = 3 * 4 + img_width * 4;
+	for (size_t width : {1, 7, 8, 9, 23, 40}) {
+		const size_t height = 7, stride = width + 5;
+		auto mask = MakeMask(stride * height);
+		for (unsigned opacity : {0, 1, 128, 254, 255}) {
+			auto expected = MakeImage(img_width * img_height * 4);
+			Reference(mask.data(), stride, width, height, expected.data() + offset, img_width * 4, 10, 200, 255, opacity);
+			for (auto level : util::simd_levels) {
+				auto img = MakeImage(img_width * img_height * 4);
+				agi::blend_mask(mask.data(), stride, width, height, img.data() + offset, img_width * 4, 10, 200, 255, opacity, level);
+				EXPECT_EQ(expected, img) << "width=" << width << " opacity=" << opacity << " level=" << (int)level;
+			}
+		}
+	}
+}
+
+TEST(lagi_alpha_blend, all_values) {
+	// Every mask value against every underlying value for each opacity
+	std::vector<uint8_t> mask(256 * 256);
+	for (size_t i = 0; i < mask.size(); ++i)
+		mask[i] = (uint8_t)(i >> 8);
+	std::vector<uint8_t> base(256 * 256 * 4);
+	for (size_t i = 0; i < base.size(); ++i)
+		base[i] = (uint8_t)(i >> 2);
+
+	for (unsigned opacity : {3, 100, 255}) {
+		auto expected = base;
+		Reference(mask.data(), 256, 256, 256, expected.data(), 256 * 4, 0, 255, 77, opacity);
+		for (auto level : util::simd_levels) {
+			auto img = base;
+			agi::blend_mask(mask.data(), 256, 256, 256, img.data(), 256 * 4, 0, 255, 77, opacity, level);
+			EXPECT_EQ(expected, img) << "opacity=" << opacity << " level=" << (int)level;
+		}
+	}
+}
+
+TEST(lagi_alpha_blend, bottom_up) {
+	const size_t width = 19, height = 4, pitch = width * 4;
+	auto mask = MakeMask(width * height);
+	auto expected = MakeImage(pitch * height);
+	Reference(mask.data(), width, width, height, expected.data() + pitch * (height - 1), -(ptrdiff_t)pitch, 1, 2, 3, 200);
+	for (auto level : util::simd_levels) {
+		auto img = MakeImage(pitch * height);
+		agi::blend_mask(mask.data(), width, width, height, img.data() + pitch * (height - 1), -(ptrdiff_t)pitch, 1, 2, 3, 200, level);
+		EXPECT_EQ(expected, img) << "level=" << (int)level;
+	}
+}
+
+TEST(lagi_alpha_blend, transparent_untouched) {
+	std::vector<uint8_t> mask(24, 0);
+	mask[20] = 255;
+	for (auto level : util::simd_levels) {
+		std::vector<uint8_t> img(24 * 4, 0x55);
+		agi::blend_mask(mask.data(), 24, 24, 1, img.data(), 24 * 4, 255, 255, 255, 255, level);
+		for (size_t i = 0; i < img.size(); ++i) {
+			if (i / 4 == 20 && i % 4 != 3)
+				EXPECT_EQ(255, img[i]) << i;
+			else
+				EXPECT_EQ(0x55, img[i]) << i;
+		}
+	}
+}
+
+TEST(lagi_alpha_blend, bands_match_sequential) {
+	// Overlapping masks which cross the band boundaries, so that blending
+	// them in the wrong order within a band would change the result
+	const int width = 64, height = 100;
+	const ptrdiff_t pitch = width * 4;
+	auto bitmap = MakeMask(40 * 70);
+	std::vector<agi::alpha_mask> masks;
+	for (int i = 0; i < 12; ++i) {
+		const int w = 10 + i * 2, h = 15 + (i * 7) % 50;
+		masks.push_back({bitmap.data(), 40, w, h, (i * 5) % (width - w), (i * 13) % (height - h),
+			(uint8_t)(i * 20), (uint8_t)(255 - i * 20), (uint8_t)(i * 7), (uint8_t)(150 + i * 8)});
+	}
+
+	auto expected = MakeImage(pitch * height);
+	for (auto const& m : masks)
+		agi::blend_mask(m.bitmap, m.stride, m.width, m.height, expected.data() + m.y * pitch + m.x * 4,
+			pitch, m.r, m.g, m.b, m.opacity);
+
+	for (int bands : {1, 3, 7, 100}) {
+		auto img = MakeImage(pitch * height);
+		const int band_rows = (height + bands - 1) / bands;
+		for (int first = 0; first < height; first += band_rows)
+			agi::blend_masks_rows(masks, img.data(), pitch, first, std::min(height, first + band_rows));
+		EXPECT_EQ(expected, img) << "bands=" << bands;
+	}
+
+	auto img = MakeImage(pitch * height);
+	agi::blend_masks(masks, img.data(), pitch, height);
+	EXPECT_EQ(expected, img);
+
+	// Bottom to top, with the first row at the end of the buffer
+	auto top_down = MakeImage(pitch * height);
+	std::vector<uint8_t> flipped(top_down.size());
+	for (int row = 0; row < height; ++row)
+		std::copy_n(&top_down[row * pitch], pitch, &flipped[(height - 1 - row) * pitch]);
+	agi::blend_masks_rows(masks, flipped.data() + pitch * (height - 1), -pitch, 0, 50);
+	agi::blend_masks_rows(masks, flipped.data() + pitch * (height - 1), -pitch, 50, height);
+	for (int row = 0; row < height; ++row) {
+		const uint8_t *a = &flipped[(height - 1 - row) * pitch];
+		const uint8_t *b = &expected[row * pitch];
+		ASSERT_TRUE(std::equal(a, a + pitch, b)) << "row=" << row;
+	}
+}
@@ -16,13 +16,17 @@
 
 #include <main.h>
 
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/audio/sample_convert.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
 #include <libaegisub/util.h>
 
 #include <boost/filesystem/fstream.hpp>
+#include <condition_variable>
+#include <mutex>
 
 namespace bfs = boost::filesystem;
 
@@ -228,6 +232,249 @@ TEST(lagi_audio, hd_cache) {
 		ASSERT_EQ(static_cast<uint16_t>((1 << 22) - 256 + i), buff[i]);
 }
 
+struct CloneableAudioProvider : TestAudioProvider<> {
+	std::unique_ptr<agi::AudioProvider> Clone() const override {
+		auto clone = agi::make_unique<CloneableAudioProvider>();
+		clone->bias = bias;
+		return std::move(clone);
+	}
+};
+
+TEST(lagi_audio, ram_cache_parallel) {
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<CloneableAudioProvider>());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	EXPECT_TRUE(provider->IsRangeDecoded(0, provider->GetNumSamples()));
+
+	uint16_t buff[512];
+	for (int64_t start : {int64_t(0), (int64_t)(1 << 22) - 256, provider->GetNumSamples() / 2, provider->GetNumSamples() - 512}) {
+		provider->GetAudio(buff, start, 512);
+		for (size_t i = 0; i < 512; ++i)
+			ASSERT_EQ(static_cast<uint16_t>(start + i), buff[i]);
+	}
+}
+
+TEST(lagi_audio, hd_cache_parallel) {
+	auto provider = agi::CreateHDAudioProvider(agi::make_unique<CloneableAudioProvider>(), agi::Path().Decode("?temp"));
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	EXPECT_TRUE(provider->IsRangeDecoded(0, provider->GetNumSamples()));
+
+	uint16_t buff[512];
+	for (int64_t start : {int64_t(0), (int64_t)65536 - 256, provider->GetNumSamples() / 2, provider->GetNumSamples() - 512}) {
+		provider->GetAudio(buff, start, 512);
+		for (size_t i = 0; i < 512; ++i)
+			ASSERT_EQ(static_cast<uint16_t>(start + i), buff[i]);
+	}
+}
+
+struct SlowAudioProvider : TestAudioProvider<> {
+	using TestAudioProvider<>::TestAudioProvider;
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		agi::util::sleep_for(10);
+		TestAudioProvider<>::FillBuffer(buf, start, count);
+	}
+};
+
+/// Records where each read starts, and holds reads back until released so
+/// that the order of the decoder's reads doesn't depend on timing
+struct GatedAudioProvider : TestAudioProvider<> {
+	mutable std::mutex mutex;
+	mutable std::condition_variable released;
+	mutable std::vector<int64_t> reads;
+	bool open = false;
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			released.wait(lock, [&] { return open; });
+			reads.push_back(start);
+		}
+		TestAudioProvider<>::FillBuffer(buf, start, count);
+	}
+
+	void Release() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			open = true;
+		}
+		released.notify_all();
+	}
+
+	std::vector<int64_t> Reads() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return reads;
+	}
+};
+
+TEST(lagi_audio, hd_cache_priority) {
+	auto source = agi::make_unique<GatedAudioProvider>();
+	auto gate = source.get();
+	auto provider = agi::CreateHDAudioProvider(std::move(source), agi::Path().Decode("?temp"));
+	const int64_t start = provider->GetNumSamples() - 48000 * 10;
+	provider->SetDecodePriority(agi::AudioProvider::DecodeHint::Viewport, start, 48000 * 10);
+	gate->Release();
+	while (!provider->IsRangeDecoded(start, 48000 * 10)) agi::util::sleep_for(0);
+
+	// The decoder may have already started on the first block before the
+	// priority was set, but everything after that should be the end
+	const int64_t block_size = 65536;
+	auto reads = gate->Reads();
+	auto read = reads.begin();
+	if (*read < start / block_size * block_size) ++read;
+
+	for (int64_t block = start / block_size * block_size; block < provider->GetNumSamples(); block += block_size) {
+		ASSERT_NE(reads.end(), read);
+		EXPECT_EQ(block, *read++);
+	}
+
+	uint16_t buff[512];
+	provider->GetAudio(buff, provider->GetNumSamples() - 512, 512);
+	for (size_t i = 0; i < 512; ++i)
+		ASSERT_EQ(static_cast<uint16_t>(provider->GetNumSamples() - 512 + i), buff[i]);
+}
+
+TEST(lagi_audio, peak_index) {
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<>>());
+	auto peaks = provider->GetPeakIndex();
+	ASSERT_NE(nullptr, peaks);
+	while (!peaks->IsComplete(0, provider->GetNumSamples())) agi::util::sleep_for(0);
+
+	for (int64_t bucket : {256, 4096, 65536}) {
+		const int64_t start = bucket * 3, count = bucket * 5;
+		std::vector<int16_t> samples(count);
+		provider->GetInt16MonoAudio(samples.data(), start, count);
+
+		int min = 0, max = 0;
+		int64_t sum_min = 0, sum_max = 0;
+		for (int16_t sample : samples) {
+			if (sample > 0) {
+				max = std::max<int>(max, sample);
+				sum_max += sample;
+			}
+			else {
+				min = std::min<int>(min, sample);
+				sum_min += sample;
+			}
+		}
+
+		agi::AudioPeak peak;
+		ASSERT_TRUE(peaks->Get(start, count, bucket, peak));
+		EXPECT_EQ(min, peak.min);
+		EXPECT_EQ(max, peak.max);
+		EXPECT_NEAR(sum_min / count, peak.avg_min, 1);
+		EXPECT_NEAR(sum_max / count, peak.avg_max, 1);
+	}
+
+	agi::AudioPeak peak;
+	EXPECT_FALSE(peaks->Get(0, 1000, 100, peak));
+}
+
+TEST(lagi_audio, peak_index_file) {
+	auto file = agi::Path().Decode("?temp/peak_index_file.peaks");
+	if (agi::fs::FileExists(file)) agi::fs::Remove(file);
+
+	agi::AudioPeakSource source;
+	source.path = "/audio/source.mkv";
+	source.size = 1234;
+	source.mtime = 5678;
+	source.fingerprint = 0xdeadbeef;
+
+	agi::AudioPeak expected;
+	{
+		auto provider = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<>>());
+		provider->SetPeakIndexFile(file, source);
+		auto peaks = provider->GetPeakIndex();
+		while (!peaks->IsComplete(0, provider->GetNumSamples())) agi::util::sleep_for(0);
+		ASSERT_TRUE(peaks->Get(0, provider->GetNumSamples(), 65536, expected));
+	}
+	ASSERT_TRUE(agi::fs::FileExists(file));
+	auto saved = agi::Path().Decode("?temp/peak_index_file.saved");
+	agi::fs::Copy(file, saved);
+
+	{
+		// Should be usable straight away, well before the slow source is decoded
+		auto provider = agi::CreateRAMAudioProvider(agi::make_unique<SlowAudioProvider>());
+		provider->SetPeakIndexFile(file, source);
+		auto peaks = provider->GetPeakIndex();
+		EXPECT_TRUE(peaks->IsComplete(0, provider->GetNumSamples()));
+		EXPECT_FALSE(provider->IsRangeDecoded(0, provider->GetNumSamples()));
+
+		agi::AudioPeak peak;
+		ASSERT_TRUE(peaks->Get(0, provider->GetNumSamples(), 65536, peak));
+		EXPECT_EQ(expected.min, peak.min);
+		EXPECT_EQ(expected.max, peak.max);
+		EXPECT_EQ(expected.avg_min, peak.avg_min);
+		EXPECT_EQ(expected.avg_max, peak.avg_max);
+	}
+
+	{
+		// Different audio shouldn't pick up the saved peaks
+		auto provider = agi::CreateRAMAudioProvider(agi::make_unique<SlowAudioProvider>(600));
+		provider->SetPeakIndexFile(file, source);
+		EXPECT_FALSE(provider->GetPeakIndex()->IsComplete(provider->GetNumSamples() - 1, 1));
+	}
+
+	// Nor should the same audio from a different or modified file. Whatever
+	// the last provider managed to index has been saved over the file, so
+	// put the original back each time.
+	auto check_mismatch = [&](agi::AudioPeakSource const& other) {
+		agi::fs::Copy(saved, file);
+		auto provider = agi::CreateRAMAudioProvider(agi::make_unique<SlowAudioProvider>());
+		provider->SetPeakIndexFile(file, other);
+		EXPECT_FALSE(provider->GetPeakIndex()->IsComplete(provider->GetNumSamples() - 1, 1));
+	};
+	auto other = source;
+	other.path = "/audio/source.mka";
+	check_mismatch(other);
+	other.path = "/audio/source.mkv2";
+	check_mismatch(other);
+	other = source;
+	other.size = 1235;
+	check_mismatch(other);
+	other = source;
+	other.mtime = 5679;
+	check_mismatch(other);
+	other = source;
+	other.fingerprint = 0;
+	check_mismatch(other);
+}
+
+TEST(lagi_audio, hd_cache_persistent) {
+	auto source = agi::Path().Decode("?temp/hd_cache_source");
+	auto dir = agi::Path().Decode("?temp/hd_cache_persistent");
+	{ bfs::ofstream s(source, std::ios_base::binary); s << "source"; }
+
+	{
+		auto provider = agi::CreateHDAudioProvider(agi::make_unique<TestAudioProvider<>>(), dir, source);
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	}
+
+	{
+		// Different samples from an unchanged source should get a new cache
+		auto src = agi::make_unique<TestAudioProvider<>>();
+		src->bias = 1;
+		auto provider = agi::CreateHDAudioProvider(std::move(src), dir, source);
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+		uint16_t sample;
+		provider->GetAudio(&sample, 100, 1);
+		EXPECT_EQ(101, sample);
+	}
+
+	{
+		auto provider = agi::CreateHDAudioProvider(agi::make_unique<TestAudioProvider<>>(), dir, source);
+		EXPECT_EQ(provider->GetNumSamples(), provider->GetDecodedSamples());
+
+		uint16_t buff[512];
+		provider->GetAudio(buff, (1 << 22) - 256, 512);
+		for (size_t i = 0; i < 512; ++i)
+			ASSERT_EQ(static_cast<uint16_t>((1 << 22) - 256 + i), buff[i]);
+	}
+
+	bfs::remove_all(dir);
+	agi::fs::Remove(source);
+}
+
 TEST(lagi_audio, convert_8bit) {
 	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<TestAudioProvider<uint8_t>>());
 
@@ -318,6 +565,47 @@ TEST(lagi_audio, stereo_downmix) {
 		EXPECT_EQ(i, samples[i]);
 }
 
+TEST(lagi_audio, downmix_cache) {
+	struct AudioProvider : agi::AudioProvider {
+		AudioProvider() {
+			channels = 6;
+			num_samples = 90 * 48000;
+			decoded_samples = num_samples;
+			sample_rate = 48000;
+			bytes_per_sample = 4;
+			float_samples = true;
+		}
+
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			auto out = static_cast<float *>(buf);
+			for (int64_t end = start + count; start < end; ++start) {
+				for (int c = 0; c < channels; ++c)
+					*out++ = (float)(start % 1000) / 1000.f;
+			}
+		}
+	};
+
+	auto provider = agi::CreateRAMAudioProvider(agi::CreateDownmixAudioProvider(agi::make_unique<AudioProvider>()));
+	EXPECT_EQ(1, provider->GetChannels());
+	EXPECT_EQ(2, provider->GetBytesPerSample());
+	EXPECT_FALSE(provider->AreSamplesFloat());
+	EXPECT_EQ(90 * 48000, provider->GetNumSamples());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	int16_t expected[1000], samples[1000];
+	AudioProvider().GetInt16MonoAudio(expected, 1 << 20, 1000);
+	provider->GetInt16MonoAudio(samples, 1 << 20, 1000);
+	for (int i = 0; i < 1000; ++i)
+		ASSERT_EQ(expected[i], samples[i]);
+}
+
+TEST(lagi_audio, downmix_already_mono) {
+	auto source = agi::make_unique<TestAudioProvider<>>();
+	auto source_ptr = source.get();
+	auto provider = agi::CreateDownmixAudioProvider(std::move(source));
+	EXPECT_EQ(source_ptr, provider.get());
+}
+
 template<typename Float>
 struct FloatAudioProvider : agi::AudioProvider {
 	FloatAudioProvider() {
@@ -358,6 +646,39 @@ TEST(lagi_audio, double_conversion) {
 		ASSERT_EQ(i + SHRT_MIN, samples[i]);
 }
 
+TEST(lagi_audio, simd_conversion) {
+	using agi::cpu::SimdLevel;
+	struct Format { int bytes_per_sample; bool float_samples; };
+	const int64_t count = 1003;
+
+	for (auto format : {Format{1, false}, Format{2, false}, Format{3, false}, Format{4, false}, Format{4, true}, Format{8, true}}) {
+		for (int channels : {1, 2, 6}) {
+			std::vector<char> src(count * channels * format.bytes_per_sample);
+			if (format.float_samples) {
+				// Deliberately include some out of range samples to test clamping
+				for (size_t i = 0; i < count * channels; ++i) {
+					double sample = (rand() % 50000 - 25000) / 20000.0;
+					if (format.bytes_per_sample == 4)
+						reinterpret_cast<float *>(src.data())[i] = (float)sample;
+					else
+						reinterpret_cast<double *>(src.data())[i] = sample;
+				}
+			}
+			else {
+				for (auto& byte : src)
+					byte = (char)rand();
+			}
+
+			std::vector<int16_t> expected(count), actual(count);
+			agi::ConvertToInt16Mono(expected.data(), src.data(), count, channels, format.bytes_per_sample, format.float_samples, SimdLevel::None);
+			for (auto level : {SimdLevel::SSE2, SimdLevel::AVX2}) {
+				agi::ConvertToInt16Mono(actual.data(), src.data(), count, channels, format.bytes_per_sample, format.float_samples, level);
+				ASSERT_EQ(expected, actual) << format.bytes_per_sample << " bytes, " << channels << " channels, level " << (int)level;
+			}
+		}
+	}
+}
+
 TEST(lagi_audio, pcm_simple) {
 	auto path = agi::Path().Decode("?temp/pcm_simple");
 	{
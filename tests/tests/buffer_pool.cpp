@@ -0,0 +1,118 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+
+#include <libaegisub/buffer_pool.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using agi::BufferPool;
+
+namespace {
+BufferPool& TestPool() {
+	static BufferPool pool(1 << 20);
+	return pool;
+}
+}
+
+TEST(lagi_buffer_pool, size_class) {
+	EXPECT_EQ(4096u, BufferPool::SizeClass(0));
+	EXPECT_EQ(4096u, BufferPool::SizeClass(4096));
+	EXPECT_EQ(4608u, BufferPool::SizeClass(4097));
+	EXPECT_EQ(8192u, BufferPool::SizeClass(8192));
+
+	for (size_t size = 1; size < (1 << 26); size = size * 3 + 1) {
+		const size_t size_class = BufferPool::SizeClass(size);
+		EXPECT_GE(size_class, size);
+		EXPECT_LE(size_class, std::max<size_t>(4096, size + size / 8));
+		EXPECT_EQ(size_class, BufferPool::SizeClass(size_class));
+	}
+
+	// A 1080p frame
+	EXPECT_EQ(8u << 20, BufferPool::SizeClass(1920 * 1080 * 4));
+}
+
+TEST(lagi_buffer_pool, reuses_buffers) {
+	BufferPool pool(1 << 20);
+	void *a = pool.Allocate(100000);
+	ASSERT_NE(nullptr, a);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(a) % BufferPool::alignment);
+	memset(a, 0xAB, 100000);
+
+	pool.Free(a, 100000);
+	EXPECT_EQ(BufferPool::SizeClass(100000), pool.GetPooledSize());
+
+	// A slightly different size in the same class gets the same buffer
+	EXPECT_EQ(a, pool.Allocate(99000));
+	EXPECT_EQ(0u, pool.GetPooledSize());
+	pool.Free(a, 99000);
+
+	void *b = pool.Allocate(200000);
+	EXPECT_NE(a, b);
+	pool.Free(b, 200000);
+	pool.Free(nullptr, 10);
+}
+
+TEST(lagi_buffer_pool, max_size) {
+	BufferPool pool(300000);
+	const size_t size_class = BufferPool::SizeClass(100000);
+
+	std::vector<void *> buffers;
+	for (int i = 0; i < 4; ++i)
+		buffers.push_back(pool.Allocate(100000));
+	for (auto buffer : buffers)
+		pool.Free(buffer, 100000);
+	EXPECT_EQ(size_class * 2, pool.GetPooledSize());
+
+	// Buffers of a different size are released first to make room
+	void *big = pool.Allocate(150000);
+	pool.Free(big, 150000);
+	EXPECT_EQ(size_class + BufferPool::SizeClass(150000), pool.GetPooledSize());
+
+	// Buffers too large for the pool are never kept
+	void *huge = pool.Allocate(400000);
+	pool.Free(huge, 400000);
+	EXPECT_EQ(size_class + BufferPool::SizeClass(150000), pool.GetPooledSize());
+
+	pool.SetMaxSize(0);
+	EXPECT_EQ(0u, pool.GetPooledSize());
+}
+
+TEST(lagi_buffer_pool, allocator) {
+	typedef std::vector<unsigned char, agi::pool_allocator<unsigned char, TestPool>> pooled_vector;
+	TestPool().SetMaxSize(1 << 20);
+
+	const unsigned char *data;
+	{
+		pooled_vector v(50000, 7);
+		EXPECT_EQ(7, v[49999]);
+		data = v.data();
+
+		pooled_vector copy(v);
+		EXPECT_EQ(v, copy);
+	}
+
+	// The most recently freed buffer comes back, and resizing doesn't
+	// overwrite its contents
+	pooled_vector v;
+	v.resize(50000);
+	EXPECT_EQ(data, v.data());
+	EXPECT_EQ(7, v[49999]);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(v.data()) % BufferPool::alignment);
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+
+#include <libaegisub/ass/event_line.h>
+
+#include <climits>
+
+using agi::ass::EventLine;
+using agi::ass::ParseEventLine;
+
+namespace {
+/// Keeps the string alive for as long as the fields which point into it
+struct parsed {
+	std::string str;
+	EventLine line;
+	bool ok;
+
+	parsed(std::string str) : str(std::move(str)) { ok = ParseEventLine(this->str, line); }
+};
+}
+
+TEST(lagi_event_line, dialogue) {
+	parsed p("Dialogue: 3,0:00:01.50,1:02:03.04,Default,Actor,10,20,30,Effect,Hello, world");
+	ASSERT_TRUE(p.ok);
+	EXPECT_FALSE(p.line.comment);
+	EXPECT_EQ(3, p.line.layer);
+	EXPECT_EQ(1500, (int)p.line.start);
+	EXPECT_EQ(3723040, (int)p.line.end);
+	EXPECT_EQ("Default", agi::str(p.line.style));
+	EXPECT_EQ("Actor", agi::str(p.line.actor));
+	EXPECT_EQ(10, p.line.margin[0]);
+	EXPECT_EQ(20, p.line.margin[1]);
+	EXPECT_EQ(30, p.line.margin[2]);
+	EXPECT_EQ("Effect", agi::str(p.line.effect));
+	EXPECT_EQ("Hello, world", agi::str(p.line.text));
+	EXPECT_TRUE(p.line.extradata_ids.empty());
+}
+
+TEST(lagi_event_line, comment) {
+	parsed p("Comment: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,text");
+	ASSERT_TRUE(p.ok);
+	EXPECT_TRUE(p.line.comment);
+	EXPECT_EQ("", agi::str(p.line.actor));
+	EXPECT_EQ("text", agi::str(p.line.text));
+}
+
+TEST(lagi_event_line, fields_are_trimmed_but_text_is_not) {
+	parsed p("Dialogue:  1 , 0:00:01.00 ,0:00:02.00, Sign , Bob ,  5 ,-5,+5, Eff ,  text  ");
+	ASSERT_TRUE(p.ok);
+	EXPECT_EQ(1, p.line.layer);
+	EXPECT_EQ(1000, (int)p.line.start);
+	EXPECT_EQ("Sign", agi::str(p.line.style));
+	EXPECT_EQ("Bob", agi::str(p.line.actor));
+	EXPECT_EQ(5, p.line.margin[0]);
+	EXPECT_EQ(-5, p.line.margin[1]);
+	EXPECT_EQ(5, p.line.margin[2]);
+	EXPECT_EQ("Eff", agi::str(p.line.effect));
+	EXPECT_EQ("  text  ", agi::str(p.line.text));
+}
+
+TEST(lagi_event_line, ssa_marked) {
+	parsed p("Dialogue: Marked=1,0:00:00.00,0:00:05.00,Default,,0000,0000,0000,,text");
+	ASSERT_TRUE(p.ok);
+	EXPECT_EQ(0, p.line.layer);
+	parsed lower("Dialogue: marked=0,0:00:00.00,0:00:05.00,Default,,0,0,0,,text");
+	ASSERT_TRUE(lower.ok);
+	EXPECT_EQ(0, lower.line.layer);
+}
+
+TEST(lagi_event_line, invalid) {
+	const char *lines[] = {
+		"",
+		"Dialogue:",
+		"Style: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,text",
+		"dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,text",
+		"Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,text",
+		"Dialogue: a,0:00:00.00,0:00:05.00,Default,,0,0,0,,text",
+		"Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,,0,,text",
+		"Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,1x,0,,text",
+		"Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,-,0,,text",
+	};
+	for (auto line : lines)
+		EXPECT_FALSE(parsed(line).ok) << line;
+}
+
+TEST(lagi_event_line, out_of_range_numbers_are_clamped) {
+	parsed p("Dialogue: 99999999999,0:00:00.00,0:00:05.00,Default,,-99999999999,0,0,,");
+	ASSERT_TRUE(p.ok);
+	EXPECT_EQ(INT_MAX, p.line.layer);
+	EXPECT_EQ(INT_MIN, p.line.margin[0]);
+	EXPECT_EQ("", agi::str(p.line.text));
+}
+
+TEST(lagi_event_line, extradata) {
+	parsed p("Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,{=1=23}{\\b1}text");
+	ASSERT_TRUE(p.ok);
+	EXPECT_EQ((std::vector<uint32_t>{1, 23}), p.line.extradata_ids);
+	EXPECT_EQ("{\\b1}text", agi::str(p.line.text));
+
+	parsed max("Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,{=4294967295}");
+	ASSERT_TRUE(max.ok);
+	EXPECT_EQ((std::vector<uint32_t>{4294967295u}), max.line.extradata_ids);
+	EXPECT_EQ("", agi::str(max.line.text));
+}
+
+TEST(lagi_event_line, not_extradata) {
+	const char *texts[] = {
+		"{=}text",
+		"{=1text",
+		"{=1=}text",
+		"{=1x}text",
+		"{==1}text",
+		"{=4294967296}text",
+		" {=1}text",
+		"{\\b1}{=1}text",
+	};
+	for (auto text : texts) {
+		parsed p(std::string("Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,") + text);
+		ASSERT_TRUE(p.ok);
+		EXPECT_TRUE(p.line.extradata_ids.empty()) << text;
+		EXPECT_EQ(text, agi::str(p.line.text));
+	}
+}
+
+TEST(lagi_event_line, reused_line_is_reset) {
+	EventLine line;
+	std::string comment = "Comment: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,{=1}text";
+	std::string dialogue = "Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,text";
+	ASSERT_TRUE(ParseEventLine(comment, line));
+	ASSERT_TRUE(ParseEventLine(dialogue, line));
+	EXPECT_FALSE(line.comment);
+	EXPECT_TRUE(line.extradata_ids.empty());
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include <simd.h>
+
+#include <libaegisub/exception.h>
+#include <libaegisub/fft.h>
+
+#include <cmath>
+#include <complex>
+
+namespace {
+std::vector<std::complex<double>> NaiveDFT(std::vector<float> const& input) {
+	const size_t n = input.size();
+	std::vector<std::complex<double>> out(n / 2 + 1);
+	for (size_t k = 0; k <= n / 2; ++k) {
+		for (size_t i = 0; i < n; ++i)
+			out[k] += std::polar<double>(input[i], -2 * M_PI * k * i / n);
+	}
+	return out;
+}
+
+std::vector<float> Noise(size_t n) {
+	std::vector<float> samples(n);
+	util::Pseudorandom rand(12345);
+	for (auto& sample : samples)
+		sample = (float)(rand() >> 8) / (1 << 23) - 1.f;
+	return samples;
+}
+}
+
+TEST(lagi_fft, rejects_bad_sizes) {
+	EXPECT_THROW(agi::RealFFT(0), agi::InternalError);
+	EXPECT_THROW(agi::RealFFT(2), agi::InternalError);
+	EXPECT_THROW(agi::RealFFT(100), agi::InternalError);
+	EXPECT_NO_THROW(agi::RealFFT(4));
+}
+
+TEST(lagi_fft, matches_dft) {
+	for (auto level : util::simd_levels) {
+		for (size_t n = 4; n <= 2048; n *= 2) {
+			auto input = Noise(n);
+			auto expected = NaiveDFT(input);
+
+			agi::RealFFT fft(n, level);
+			std::vector<float> re(n / 2 + 1), im(n / 2 + 1);
+			fft.Transform(input.data(), re.data(), im.data());
+
+			// Rounding error grows with the size and the magnitude of the sums
+			const double tolerance = 1e-5 * n;
+			for (size_t k = 0; k <= n / 2; ++k) {
+				ASSERT_NEAR(expected[k].real(), re[k], tolerance) << "n=" << n << " k=" << k;
+				ASSERT_NEAR(expected[k].imag(), im[k], tolerance) << "n=" << n << " k=" << k;
+			}
+		}
+	}
+}
+
+TEST(lagi_fft, sine_peak) {
+	const size_t n = 1024;
+	std::vector<float> input(n);
+	for (size_t i = 0; i < n; ++i)
+		input[i] = (float)sin(2 * M_PI * 100 * i / n);
+
+	agi::RealFFT fft(n);
+	std::vector<float> re(n / 2 + 1), im(n / 2 + 1);
+	fft.Transform(input.data(), re.data(), im.data());
+
+	for (size_t k = 0; k <= n / 2; ++k) {
+		const double magnitude = std::hypot(re[k], im[k]);
+		if (k == 100)
+			EXPECT_NEAR(n / 2, magnitude, 1e-2);
+		else
+			EXPECT_NEAR(0, magnitude, 1e-2) << k;
+	}
+}
+
+TEST(lagi_fft, hann_window) {
+	auto window = agi::HannWindow(8);
+	ASSERT_EQ(8u, window.size());
+	EXPECT_FLOAT_EQ(0.f, window[0]);
+	EXPECT_FLOAT_EQ(0.5f, window[2]);
+	EXPECT_FLOAT_EQ(1.f, window[4]);
+	EXPECT_FLOAT_EQ(window[1], window[7]);
+
+	// Transforming with a window is the same as transforming the windowed input
+	const size_t n = 256;
+	auto input = Noise(n);
+	window = agi::HannWindow(n);
+	std::vector<float> windowed(n);
+	for (size_t i = 0; i < n; ++i)
+		windowed[i] = input[i] * window[i];
+
+	agi::RealFFT fft(n);
+	std::vector<float> re1(n / 2 + 1), im1(n / 2 + 1), re2(n / 2 + 1), im2(n / 2 + 1);
+	fft.Transform(input.data(), re1.data(), im1.data(), window.data());
+	fft.Transform(windowed.data(), re2.data(), im2.data());
+	for (size_t k = 0; k <= n / 2; ++k) {
+		EXPECT_FLOAT_EQ(re2[k], re1[k]);
+		EXPECT_FLOAT_EQ(im2[k], im1[k]);
+	}
+}
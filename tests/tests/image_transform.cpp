@@ -0,0 +1,115 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include <simd.h>
+
+#include <libaegisub/exception.h>
+#include <libaegisub/image_transform.h>
+
+#include <vector>
+
+using agi::cpu::SimdLevel;
+
+namespace {
+/// A 32-bit image with padding at the end of each row, where every pixel
+/// holds its own coordinates
+struct TestImage {
+	size_t width, height, pitch;
+	std::vector<uint32_t> pixels;
+
+	TestImage(size_t width, size_t height)
+	: width(width), height(height), pitch(width + 3), pixels(pitch * height, 0xDEADBEEF)
+	{
+		for (size_t y = 0; y < height; ++y) {
+			for (size_t x = 0; x < width; ++x)
+				pixels[y * pitch + x] = (uint32_t)(y << 16 | x);
+		}
+	}
+
+	std::vector<uint32_t> Transform(agi::image_transform t, SimdLevel level) const {
+		const size_t out_w = t.transpose ? height : width;
+		const size_t out_h = t.transpose ? width : height;
+		std::vector<uint32_t> out(out_w * out_h, 0xAAAAAAAA);
+		agi::transform_bgra(reinterpret_cast<const uint8_t *>(pixels.data()), pitch * 4, width, height,
+			reinterpret_cast<uint8_t *>(out.data()), out_w * 4, t, level);
+		return out;
+	}
+
+	/// Transform the image a pixel at a time following the definition
+	std::vector<uint32_t> Expected(agi::image_transform t) const {
+		const size_t out_w = t.transpose ? height : width;
+		const size_t out_h = t.transpose ? width : height;
+		std::vector<uint32_t> out(out_w * out_h);
+		for (size_t y = 0; y < out_h; ++y) {
+			for (size_t x = 0; x < out_w; ++x) {
+				size_t sx = t.transpose ? y : x;
+				size_t sy = t.transpose ? x : y;
+				if (t.flip_x) sx = width - 1 - sx;
+				if (t.flip_y) sy = height - 1 - sy;
+				out[y * out_w + x] = pixels[sy * pitch + sx];
+			}
+		}
+		return out;
+	}
+};
+
+agi::image_transform Make(bool transpose, bool flip_x, bool flip_y) {
+	agi::image_transform t;
+	t.transpose = transpose;
+	t.flip_x = flip_x;
+	t.flip_y = flip_y;
+	return t;
+}
+}
+
+TEST(lagi_image_transform, all_transforms) {
+	// Sizes which cover whole tiles, partial tiles and partial blocks
+	const size_t sizes[][2] = { {1, 1}, {3, 5}, {8, 8}, {37, 23}, {64, 71}, {100, 33} };
+	for (auto size : sizes) {
+		TestImage img(size[0], size[1]);
+		for (int i = 0; i < 8; ++i) {
+			auto t = Make(i & 1, i & 2, i & 4);
+			auto expected = img.Expected(t);
+			for (auto level : util::simd_levels)
+				EXPECT_EQ(expected, img.Transform(t, level))
+					<< size[0] << "x" << size[1] << " transform " << i << " level " << (int)level;
+		}
+	}
+}
+
+TEST(lagi_image_transform, rotation) {
+	// A 2x3 image rotated clockwise
+	TestImage img(2, 3);
+	auto px = [](uint32_t x, uint32_t y) { return y << 16 | x; };
+
+	EXPECT_EQ(img.Expected(agi::image_transform()), img.Transform(agi::image_transform::rotation(0), SimdLevel::None));
+	EXPECT_EQ(img.Expected(agi::image_transform()), img.Transform(agi::image_transform::rotation(-360), SimdLevel::None));
+
+	std::vector<uint32_t> r90 = { px(0, 2), px(0, 1), px(0, 0), px(1, 2), px(1, 1), px(1, 0) };
+	EXPECT_EQ(r90, img.Transform(agi::image_transform::rotation(90), SimdLevel::None));
+	EXPECT_EQ(r90, img.Transform(agi::image_transform::rotation(-270), SimdLevel::None));
+
+	std::vector<uint32_t> r180 = { px(1, 2), px(0, 2), px(1, 1), px(0, 1), px(1, 0), px(0, 0) };
+	EXPECT_EQ(r180, img.Transform(agi::image_transform::rotation(180), SimdLevel::None));
+
+	std::vector<uint32_t> r270 = { px(1, 0), px(1, 1), px(1, 2), px(0, 0), px(0, 1), px(0, 2) };
+	EXPECT_EQ(r270, img.Transform(agi::image_transform::rotation(270), SimdLevel::None));
+	EXPECT_EQ(r270, img.Transform(agi::image_transform::rotation(-90), SimdLevel::None));
+
+	EXPECT_TRUE(agi::image_transform::rotation(720).identity());
+	EXPECT_THROW(agi::image_transform::rotation(45), agi::InternalError);
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+
+#include <libaegisub/interval_index.h>
+
+#include <random>
+
+using index_type = agi::interval_index<int>;
+using interval = index_type::interval;
+
+namespace {
+std::vector<int> containing(index_type const& index, int time) {
+	std::vector<int> ret;
+	index.containing(time, [&](interval const& i) { ret.push_back(i.value); });
+	return ret;
+}
+
+std::vector<int> overlapping(index_type const& index, int begin, int end) {
+	std::vector<int> ret;
+	index.overlapping(begin, end, [&](interval const& i) { ret.push_back(i.value); });
+	return ret;
+}
+
+// The order of intervals with the same start time isn't specified, so these
+// both return the values in sorted order
+std::vector<int> brute_force(std::vector<interval> const& intervals, int begin, int end) {
+	std::vector<int> ret;
+	for (auto const& i : intervals) {
+		if (i.start < end && i.end > begin)
+			ret.push_back(i.value);
+	}
+	std::sort(ret.begin(), ret.end());
+	return ret;
+}
+
+std::vector<int> query(index_type const& index, int begin, int end) {
+	std::vector<int> ret;
+	int last_start = INT_MIN;
+	index.overlapping(begin, end, [&](interval const& i) {
+		EXPECT_LE(last_start, i.start);
+		last_start = i.start;
+		ret.push_back(i.value);
+	});
+	std::sort(ret.begin(), ret.end());
+	return ret;
+}
+}
+
+TEST(lagi_interval_index, empty) {
+	index_type index;
+	EXPECT_TRUE(index.empty());
+	EXPECT_TRUE(containing(index, 0).empty());
+	EXPECT_TRUE(overlapping(index, INT_MIN, INT_MAX).empty());
+}
+
+TEST(lagi_interval_index, containing_is_half_open) {
+	index_type index({{100, 200, 1}});
+	EXPECT_TRUE(containing(index, 99).empty());
+	EXPECT_EQ(std::vector<int>{1}, containing(index, 100));
+	EXPECT_EQ(std::vector<int>{1}, containing(index, 199));
+	EXPECT_TRUE(containing(index, 200).empty());
+}
+
+TEST(lagi_interval_index, empty_and_backwards_intervals_contain_nothing) {
+	index_type index({{100, 100, 1}, {200, 150, 2}});
+	for (int t : {99, 100, 101, 149, 150, 175, 200, 201})
+		EXPECT_TRUE(containing(index, t).empty()) << t;
+}
+
+TEST(lagi_interval_index, results_are_in_start_order) {
+	index_type index({{30, 100, 3}, {10, 100, 1}, {20, 100, 2}, {10, 50, 4}});
+	EXPECT_EQ((std::vector<int>{1, 4, 2, 3}), containing(index, 40));
+	EXPECT_EQ((std::vector<int>{1, 2, 3}), containing(index, 60));
+}
+
+TEST(lagi_interval_index, overlapping) {
+	index_type index({{0, 10, 1}, {10, 20, 2}, {20, 30, 3}, {5, 25, 4}});
+	EXPECT_EQ((std::vector<int>{1, 4}), overlapping(index, 0, 10));
+	EXPECT_EQ((std::vector<int>{1, 4, 2}), overlapping(index, 9, 11));
+	EXPECT_EQ((std::vector<int>{4, 2, 3}), overlapping(index, 10, 30));
+	EXPECT_TRUE(overlapping(index, 30, 40).empty());
+}
+
+TEST(lagi_interval_index, extreme_times) {
+	index_type index({{INT_MIN, INT_MAX, 1}});
+	EXPECT_EQ(std::vector<int>{1}, containing(index, INT_MIN));
+	EXPECT_EQ(std::vector<int>{1}, containing(index, INT_MAX - 1));
+	EXPECT_TRUE(containing(index, INT_MAX).empty());
+}
+
+TEST(lagi_interval_index, insert_and_erase) {
+	index_type index({{0, 100, 1}, {50, 150, 2}});
+	index.insert({{25, 75, 3}, {60, 70, 4}});
+	EXPECT_EQ(4u, index.size());
+	EXPECT_EQ((std::vector<int>{1, 3, 2, 4}), containing(index, 65));
+
+	index.erase_if([](interval const& i) { return i.value % 2 == 1; });
+	EXPECT_EQ(2u, index.size());
+	EXPECT_EQ((std::vector<int>{2, 4}), containing(index, 65));
+	EXPECT_EQ((std::vector<int>{2}), containing(index, 120));
+
+	index.erase_if([](interval const&) { return true; });
+	EXPECT_TRUE(index.empty());
+	EXPECT_TRUE(containing(index, 65).empty());
+}
+
+TEST(lagi_interval_index, matches_brute_force) {
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> start_dist(0, 10000), length_dist(-10, 500);
+
+	std::vector<interval> intervals;
+	for (int i = 0; i < 1000; ++i) {
+		int start = start_dist(rng);
+		intervals.push_back({start, start + length_dist(rng), i});
+	}
+	index_type index(intervals);
+
+	for (int i = 0; i < 200; ++i) {
+		int begin = start_dist(rng), end = begin + length_dist(rng);
+		ASSERT_EQ(brute_force(intervals, begin, begin + 1), query(index, begin, begin + 1)) << begin;
+		ASSERT_EQ(brute_force(intervals, begin, end), query(index, begin, end)) << begin << " " << end;
+	}
+
+	// Replace every other interval, as an edit to many lines would
+	std::vector<interval> added;
+	for (auto& i : intervals) {
+		if (i.value % 2) continue;
+		i.start = start_dist(rng);
+		i.end = i.start + length_dist(rng);
+		added.push_back(i);
+	}
+	index.erase_if([](interval const& i) { return i.value % 2 == 0; });
+	index.insert(added);
+
+	for (int i = 0; i < 200; ++i) {
+		int begin = start_dist(rng), end = begin + length_dist(rng);
+		ASSERT_EQ(brute_force(intervals, begin, begin + 1), query(index, begin, begin + 1)) << begin;
+		ASSERT_EQ(brute_force(intervals, begin, end), query(index, begin, end)) << begin << " " << end;
+	}
+}
@@ -0,0 +1,170 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+#include <simd.h>
+
+#include <libaegisub/exception.h>
+#include <libaegisub/ycbcr_conv.h>
+
+#include <cstdlib>
+#include <vector>
+
+using agi::cpu::SimdLevel;
+
+namespace {
+const agi::ycbcr_matrix matrices[] = {
+	agi::ycbcr_matrix::bt601, agi::ycbcr_matrix::bt709, agi::ycbcr_matrix::fcc,
+	agi::ycbcr_matrix::smpte_240m, agi::ycbcr_matrix::bt2020
+};
+const agi::ycbcr_range ranges[] = { agi::ycbcr_range::tv, agi::ycbcr_range::pc };
+
+/// A planar image filled with pseudorandom 8-bit samples, stored with the
+/// given bit depth
+struct TestImage {
+	int width, height, depth, shift_x, shift_y;
+	std::vector<uint8_t> y8, cb8, cr8;
+	std::vector<uint8_t> y, cb, cr;
+	agi::ycbcr_planes planes;
+
+	TestImage(int width, int height, int depth = 8, int shift_x = 0, int shift_y = 0, bool grey = false)
+	: width(width), height(height), depth(depth), shift_x(shift_x), shift_y(shift_y)
+	{
+		const int cw = (width + (1 << shift_x) - 1) >> shift_x;
+		const int ch = (height + (1 << shift_y) - 1) >> shift_y;
+		util::Pseudorandom rand;
+		auto fill = [&](std::vector<uint8_t>& plane8, std::vector<uint8_t>& plane, size_t count) {
+			plane8.resize(count);
+			for (auto& v : plane8) v = rand() >> 24;
+			const int bytes = depth > 8 ? 2 : 1;
+			plane.resize(count * bytes);
+			for (size_t i = 0; i < count; ++i) {
+				const int v = plane8[i] << (depth - 8);
+				plane[i * bytes] = v & 0xFF;
+				if (bytes == 2) plane[i * bytes + 1] = v >> 8;
+			}
+		};
+		fill(y8, y, width * height);
+		if (!grey) {
+			fill(cb8, cb, cw * ch);
+			fill(cr8, cr, cw * ch);
+		}
+
+		const size_t bytes = depth > 8 ? 2 : 1;
+		planes.y = y.data();
+		planes.cb = grey ? nullptr : cb.data();
+		planes.cr = grey ? nullptr : cr.data();
+		planes.y_stride = width * bytes;
+		planes.c_stride = cw * bytes;
+		planes.chroma_shift_x = shift_x;
+		planes.chroma_shift_y = shift_y;
+	}
+
+	/// Convert a pixel with the floating-point converter
+	std::array<uint8_t, 3> Expected(agi::ycbcr_converter const& conv, int x, int row) const {
+		const int cw = (width + (1 << shift_x) - 1) >> shift_x;
+		const size_t ci = (row >> shift_y) * cw + (x >> shift_x);
+		return conv.ycbcr_to_rgb({{
+			y8[row * width + x],
+			cb8.empty() ? (uint8_t)128 : cb8[ci],
+			cr8.empty() ? (uint8_t)128 : cr8[ci]}});
+	}
+};
+
+std::vector<uint8_t> Convert(TestImage const& img, agi::ycbcr_matrix mat, agi::ycbcr_range range, SimdLevel level) {
+	agi::ycbcr_planar_converter conv(mat, range, img.depth, level);
+	std::vector<uint8_t> out(img.width * img.height * 4, 0xAA);
+	conv.convert_rows(img.planes, img.width, 0, img.height, out.data(), img.width * 4);
+	return out;
+}
+
+void ExpectMatches(TestImage const& img, agi::ycbcr_matrix mat, agi::ycbcr_range range) {
+	agi::ycbcr_converter reference(mat, range);
+	for (auto level : util::simd_levels) {
+		auto out = Convert(img, mat, range, level);
+		for (int row = 0; row < img.height; ++row) {
+			for (int x = 0; x < img.width; ++x) {
+				auto expected = img.Expected(reference, x, row);
+				const uint8_t *px = &out[(row * img.width + x) * 4];
+				ASSERT_NEAR(expected[2], px[0], 1) << "x=" << x << " row=" << row << " level=" << (int)level;
+				ASSERT_NEAR(expected[1], px[1], 1) << "x=" << x << " row=" << row << " level=" << (int)level;
+				ASSERT_NEAR(expected[0], px[2], 1) << "x=" << x << " row=" << row << " level=" << (int)level;
+				ASSERT_EQ(0, px[3]);
+			}
+		}
+	}
+}
+}
+
+TEST(lagi_ycbcr, rejects_bad_depth) {
+	EXPECT_THROW(agi::ycbcr_planar_converter(agi::ycbcr_matrix::bt601, agi::ycbcr_range::tv, 7), agi::InternalError);
+	EXPECT_THROW(agi::ycbcr_planar_converter(agi::ycbcr_matrix::bt601, agi::ycbcr_range::tv, 17), agi::InternalError);
+}
+
+TEST(lagi_ycbcr, matches_ycbcr_converter) {
+	// Odd width to cover the scalar tail after the vector loops
+	TestImage img(45, 3);
+	for (auto mat : matrices) {
+		for (auto range : ranges)
+			ExpectMatches(img, mat, range);
+	}
+}
+
+TEST(lagi_ycbcr, subsampled) {
+	for (int shift_x = 0; shift_x <= 2; ++shift_x) {
+		for (int shift_y = 0; shift_y <= 1; ++shift_y) {
+			TestImage img(53, 5, 8, shift_x, shift_y);
+			ExpectMatches(img, agi::ycbcr_matrix::bt709, agi::ycbcr_range::tv);
+		}
+	}
+}
+
+TEST(lagi_ycbcr, high_bit_depth) {
+	for (int depth : {10, 12, 16}) {
+		TestImage img(37, 4, depth, 1, 1);
+		for (auto range : ranges)
+			ExpectMatches(img, agi::ycbcr_matrix::bt601, range);
+	}
+	TestImage img444(37, 2, 10);
+	ExpectMatches(img444, agi::ycbcr_matrix::bt2020, agi::ycbcr_range::pc);
+}
+
+TEST(lagi_ycbcr, greyscale) {
+	TestImage img(40, 2, 8, 0, 0, true);
+	ExpectMatches(img, agi::ycbcr_matrix::bt601, agi::ycbcr_range::tv);
+	TestImage img16(40, 2, 16, 0, 0, true);
+	ExpectMatches(img16, agi::ycbcr_matrix::bt601, agi::ycbcr_range::pc);
+}
+
+TEST(lagi_ycbcr, simd_is_exact) {
+	// The vector paths use the same fixed-point arithmetic as the scalar one
+	for (int depth : {8, 10}) {
+		for (int shift_x = 0; shift_x <= 2; ++shift_x) {
+			TestImage img(67, 3, depth, shift_x, 1);
+			auto scalar = Convert(img, agi::ycbcr_matrix::bt709, agi::ycbcr_range::tv, SimdLevel::None);
+			EXPECT_EQ(scalar, Convert(img, agi::ycbcr_matrix::bt709, agi::ycbcr_range::tv, SimdLevel::SSE2));
+			EXPECT_EQ(scalar, Convert(img, agi::ycbcr_matrix::bt709, agi::ycbcr_range::tv, SimdLevel::AVX2));
+		}
+	}
+}
+
+TEST(lagi_ycbcr, parallel_convert) {
+	TestImage img(64, 100, 8, 1, 1);
+	agi::ycbcr_planar_converter conv(agi::ycbcr_matrix::bt601, agi::ycbcr_range::tv);
+	std::vector<uint8_t> out(img.width * img.height * 4);
+	conv.convert(img.planes, img.width, img.height, out.data(), img.width * 4);
+	EXPECT_EQ(Convert(img, agi::ycbcr_matrix::bt601, agi::ycbcr_range::tv, agi::cpu::BestSimdLevel()), out);
+}